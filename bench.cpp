@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include <iostream>
+
+using namespace std;
+
+#include "include/bmbench.h"
+#include "include/bufmgr.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+// Usage: minibase-bufmgr-bench [benchmark]
+//
+// Runs the named buffer manager benchmark, or all of them if no name
+// is given.
+int main (int argc, char **argv)
+{
+	BMBenchmark benchmark;
+	Status status;
+
+	minibase_globals = new SystemDefs(status, "BMBENCH.DB", 2000, NUMBUF, "Clock");
+
+	if (status != OK)
+	{
+		cerr << "Error initializing Minibase.\n";
+		exit(2);
+	}
+
+	status = benchmark.RunBenchmarks(argc > 1 ? argv[1] : NULL);
+
+	if (status != OK)
+	{
+		cout << "Error running buffer manager benchmarks\n";
+		minibase_errors.show_errors();
+		return 1;
+	}
+
+	delete minibase_globals;
+	cout << endl;
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include "../include/arc.h"
+
+ARC::ARC(int numOfBuf, Frame** frames) : Replacer(numOfBuf, frames)
+{
+	this->target = 0;
+	this->lists = new IndexLists(numOfBuf, 3);
+	this->b1 = new GhostList(numOfBuf);
+	this->b2 = new GhostList(numOfBuf);
+
+	for (int i = 0; i < numOfBuf; i++)
+	{
+		this->lists->PushBack(FREE, i);
+	}
+}
+
+
+ARC::~ARC()
+{
+	delete this->lists;
+	delete this->b1;
+	delete this->b2;
+}
+
+
+int ARC::PickVictim()
+{
+	int victimFrameIndex = this->FirstUnpinned(FREE);
+
+	if (INVALID_FRAME == victimFrameIndex)
+	{
+		int t1Size = this->lists->Size(T1);
+		int first = (t1Size > 0 && t1Size > this->target) ? T1 : T2;
+		int second = (T1 == first) ? T2 : T1;
+
+		victimFrameIndex = this->FirstUnpinned(first);
+
+		if (INVALID_FRAME == victimFrameIndex)
+		{
+			victimFrameIndex = this->FirstUnpinned(second);
+		}
+	}
+
+	return victimFrameIndex;
+}
+
+
+int ARC::NextVictims(int* frameIds, int max)
+{
+	int t1Size = this->lists->Size(T1);
+	int first = (t1Size > 0 && t1Size > this->target) ? T1 : T2;
+	int second = (T1 == first) ? T2 : T1;
+
+	int count = this->AddUnpinned(FREE, frameIds, 0, max);
+	count = this->AddUnpinned(first, frameIds, count, max);
+
+	return this->AddUnpinned(second, frameIds, count, max);
+}
+
+
+//--------------------------------------------------------------------
+// ARC::OnLoad
+//
+// A miss. Adapt the target size of T1 if the page is remembered in a
+// ghost list, and trim the ghost lists so that |T1| + |B1| <= c and
+// |T1| + |T2| + |B1| + |B2| <= 2c, where c is the number of frames.
+//--------------------------------------------------------------------
+
+void ARC::OnLoad(int frameId)
+{
+	PageID pid = (*this->frames)[frameId].GetPageID();
+	int c = this->numOfBuf;
+
+	if (INVALID_INDEX != this->b1->Find(pid))
+	{
+		int b1Size = this->b1->Size();
+		int b2Size = this->b2->Size();
+		int delta = (b1Size >= b2Size) ? 1 : b2Size / b1Size;
+
+		this->target = (this->target + delta < c) ? this->target + delta : c;
+		this->b1->Remove(pid);
+		this->lists->MoveToBack(T2, frameId);
+	}
+	else if (INVALID_INDEX != this->b2->Find(pid))
+	{
+		int b1Size = this->b1->Size();
+		int b2Size = this->b2->Size();
+		int delta = (b2Size >= b1Size) ? 1 : b1Size / b2Size;
+
+		this->target = (this->target - delta > 0) ? this->target - delta : 0;
+		this->b2->Remove(pid);
+		this->lists->MoveToBack(T2, frameId);
+	}
+	else
+	{
+		int t1Size = this->lists->Size(T1);
+		int t2Size = this->lists->Size(T2);
+
+		if (t1Size + this->b1->Size() >= c)
+		{
+			this->b1->RemoveOldest();
+		}
+		else if (t1Size + t2Size + this->b1->Size() + this->b2->Size() >= 2 * c)
+		{
+			this->b2->RemoveOldest();
+		}
+
+		this->lists->MoveToBack(T1, frameId);
+	}
+}
+
+
+void ARC::OnPin(int frameId)
+{
+	if (FREE != this->lists->ListOf(frameId))
+	{
+		this->lists->MoveToBack(T2, frameId);
+	}
+}
+
+
+void ARC::OnEvict(int frameId)
+{
+	PageID pid = (*this->frames)[frameId].GetPageID();
+
+	if (T1 == this->lists->ListOf(frameId))
+	{
+		this->b1->Insert(pid);
+	}
+	else if (T2 == this->lists->ListOf(frameId))
+	{
+		this->b2->Insert(pid);
+	}
+}
+
+
+void ARC::OnFree(int frameId)
+{
+	this->lists->MoveToBack(FREE, frameId);
+}
+
+
+int ARC::FirstUnpinned(int list)
+{
+	for (int i = this->lists->Front(list); INVALID_INDEX != i; i = this->lists->Next(i))
+	{
+		this->numOfExamined++;
+
+		if ((*this->frames)[i].NotPinned() && this->Accept(i))
+		{
+			return i;
+		}
+	}
+
+	return INVALID_FRAME;
+}
+
+
+int ARC::AddUnpinned(int list, int* frameIds, int count, int max)
+{
+	for (int i = this->lists->Front(list); INVALID_INDEX != i && count < max; i = this->lists->Next(i))
+	{
+		if ((*this->frames)[i].NotPinned())
+		{
+			frameIds[count++] = i;
+		}
+	}
+
+	return count;
+}
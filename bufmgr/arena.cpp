@@ -0,0 +1,119 @@
+#include <new>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../include/arena.h"
+
+//--------------------------------------------------------------------
+// Constructor for BufferArena
+//
+// Input   : numOfPages    - number of page images in the slab
+//           maxNumOfPages - number of page images the slab may grow to
+//           hugePages     - back the slab with transparent huge pages
+//                           if possible
+// Output  : None
+// PostCond: The first numOfPages pages are constructed.
+//--------------------------------------------------------------------
+
+BufferArena::BufferArena(int numOfPages, int maxNumOfPages, bool hugePages)
+{
+	unsigned long size = (unsigned long)maxNumOfPages * MINIBASE_PAGESIZE;
+	unsigned long alignment = hugePages ? ARENA_HUGE_PAGE_SIZE : sysconf(_SC_PAGESIZE);
+
+	this->numOfPages = numOfPages;
+	this->maxNumOfPages = maxNumOfPages;
+
+	// Round up to whole (huge) pages, and map one alignment unit more so
+	// that the slab can start on an aligned address
+	size = (size + alignment - 1) / alignment * alignment;
+	this->mappingSize = size + alignment;
+	this->mapping = (char*)mmap(NULL, this->mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (MAP_FAILED == this->mapping)
+	{
+		this->mapping = NULL;
+		this->base = NULL;
+
+		if (0 != posix_memalign((void**)&this->base, sysconf(_SC_PAGESIZE), size))
+		{
+			this->base = NULL;
+		}
+	}
+	else
+	{
+		this->base = (char*)(((unsigned long)this->mapping + alignment - 1) / alignment * alignment);
+
+#ifdef MADV_HUGEPAGE
+		if (hugePages)
+		{
+			madvise(this->base, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	for (int i = 0; NULL != this->base && i < numOfPages; i++)
+	{
+		new (this->GetPage(i)) Page();
+	}
+}
+
+
+//--------------------------------------------------------------------
+// BufferArena::Resize
+//
+// Input    : numOfPages - the new number of page images, at most
+//                         maxNumOfPages
+// Output   : None
+// Purpose  : Construct the pages the slab grows by, or destroy the ones
+//            it shrinks by and give their memory back to the system.
+//            The other pages keep their address and contents.
+//--------------------------------------------------------------------
+
+void BufferArena::Resize(int numOfPages)
+{
+	for (int i = this->numOfPages; NULL != this->base && i < numOfPages; i++)
+	{
+		new (this->GetPage(i)) Page();
+	}
+
+	for (int i = numOfPages; NULL != this->base && i < this->numOfPages; i++)
+	{
+		this->GetPage(i)->~Page();
+	}
+
+	if (NULL != this->mapping && numOfPages < this->numOfPages)
+	{
+		// Only whole system pages past the last page still in use
+		unsigned long systemPageSize = sysconf(_SC_PAGESIZE);
+		unsigned long start = (unsigned long)this->GetPage(numOfPages);
+		unsigned long end = (unsigned long)this->GetPage(this->numOfPages);
+
+		start = (start + systemPageSize - 1) / systemPageSize * systemPageSize;
+
+		if (start < end)
+		{
+			madvise((void*)start, end - start, MADV_DONTNEED);
+		}
+	}
+
+	this->numOfPages = numOfPages;
+}
+
+
+BufferArena::~BufferArena()
+{
+	for (int i = 0; NULL != this->base && i < this->numOfPages; i++)
+	{
+		this->GetPage(i)->~Page();
+	}
+
+	if (NULL != this->mapping)
+	{
+		munmap(this->mapping, this->mappingSize);
+	}
+	else
+	{
+		free(this->base);
+	}
+}
@@ -0,0 +1,2594 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <iostream>
+
+#include "../include/bufmgr.h"
+#include "../include/bmbench.h"
+
+using namespace std;
+
+//--------------------------------------------------------------------
+// Wall clock time in nanoseconds. clock() is CPU time with a coarse
+// resolution, which is not good enough to time single pins.
+//--------------------------------------------------------------------
+
+static double NowInNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------
+// Work done by one thread of the concurrent benchmark: numOfPins
+// pin/unpin pairs on pages firstPid .. firstPid + numOfPages - 1.
+// Three quarters of the pins go to the first eighth of the pages. If
+// verify is set, each page is expected to hold its own page id in its
+// first bytes, and the unpins i with (i & dirtyMask) == 0 mark the
+// page dirty.
+//--------------------------------------------------------------------
+
+struct PinWorker
+{
+	BufMgr*      bufMgr;
+	PageID       firstPid;
+	int          numOfPages;
+	int          numOfPins;
+	bool         verify;
+	int          dirtyMask;
+	unsigned int seed;
+
+	Status       status;
+	int          numOfErrors;
+};
+
+
+static void* RunPinWorker(void* arg)
+{
+	PinWorker* worker = (PinWorker*)arg;
+	int hotPages = (worker->numOfPages / 8 > 0) ? worker->numOfPages / 8 : 1;
+	unsigned int seed = worker->seed;
+	Page* pg;
+
+	worker->status = OK;
+	worker->numOfErrors = 0;
+
+	for (int i = 0; OK == worker->status && i < worker->numOfPins; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		int range = ((seed >> 4) & 3) ? hotPages : worker->numOfPages;
+		PageID pid = worker->firstPid + (seed >> 8) % range;
+
+		worker->status = worker->bufMgr->PinPage(pid, pg, !worker->verify);
+
+		if (OK == worker->status)
+		{
+			if (worker->verify && *(PageID*)pg != pid)
+			{
+				worker->numOfErrors++;
+			}
+
+			worker->status = worker->bufMgr->UnpinPage(pid, worker->verify && 0 == (i & worker->dirtyMask));
+		}
+	}
+
+	return NULL;
+}
+
+
+//--------------------------------------------------------------------
+// Allocate numOfPages pages in the database and write its own page id
+// into the first bytes of each, through the global buffer pool.
+//--------------------------------------------------------------------
+
+static Status CreateStampedPages(PageID& firstPid, int numOfPages)
+{
+	Status status = OK;
+	Page* pg;
+
+	firstPid = INVALID_PAGE;
+	status = MINIBASE_BM->NewPage(firstPid, pg, numOfPages);
+
+	if (OK == status)
+	{
+		status = MINIBASE_BM->UnpinPage(firstPid);
+	}
+
+	for (int i = 0; OK == status && i < numOfPages; i++)
+	{
+		status = MINIBASE_BM->PinPage(firstPid + i, pg, true);
+
+		if (OK == status)
+		{
+			*(PageID*)pg = firstPid + i;
+			status = MINIBASE_BM->UnpinPage(firstPid + i, true);
+		}
+	}
+
+	if (OK == status)
+	{
+		status = MINIBASE_BM->FlushAllPages();
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Pin and unpin count pages at random, nine in ten of them among the
+// first numOfHotPages, checking the contents of each. Returns the
+// misses in missNo.
+//--------------------------------------------------------------------
+
+static Status PinSkewed(BufMgr* bufMgr, PageID firstPid, int numOfPages, int numOfHotPages,
+	int count, unsigned int& seed, long& missNo)
+{
+	Status status = OK;
+	long pinNo, oldMissNo;
+	Page* pg;
+
+	bufMgr->GetStat(pinNo, oldMissNo);
+
+	for (int i = 0; OK == status && i < count; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		int range = ((seed >> 4) % 10) ? numOfHotPages : numOfPages;
+		PageID pid = firstPid + (seed >> 8) % range;
+
+		status = bufMgr->PinPage(pid, pg);
+
+		if (OK == status && *(PageID*)pg != pid)
+		{
+			cerr << "*** Page " << pid << " holds the wrong data\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			status = bufMgr->UnpinPage(pid);
+		}
+	}
+
+	bufMgr->GetStat(pinNo, missNo);
+	missNo -= oldMissNo;
+
+	return status;
+}
+
+//--------------------------------------------------------------------
+// Descend a B+tree built by PageSizeThroughput to the value of key.
+// Each page holds a count, then that many (key, value) pairs sorted
+// by key, the value of an inner entry being the page id of the child
+// whose keys start with its key.
+//--------------------------------------------------------------------
+
+static Status LookUpKey(BufMgr* bufMgr, PageID rootPid, int height, int key, int& value)
+{
+	Status status = OK;
+	PageID pid = rootPid;
+	Page* pg;
+
+	for (int level = 0; OK == status && level < height; level++)
+	{
+		status = bufMgr->PinPage(pid, pg, false, (level + 1 < height) ? PAGE_CLASS_INDEX : PAGE_CLASS_LEAF);
+
+		if (OK == status)
+		{
+			int* entries = (int*)pg;
+			int low = 0;
+			int high = entries[0] - 1;
+
+			// The last entry with a key not above key
+			while (low < high)
+			{
+				int middle = (low + high + 1) / 2;
+
+				if (entries[1 + 2 * middle] <= key)
+				{
+					low = middle;
+				}
+				else
+				{
+					high = middle - 1;
+				}
+			}
+
+			value = entries[2 + 2 * low];
+			status = bufMgr->UnpinPage(pid);
+			pid = value;
+		}
+	}
+
+	return status;
+}
+
+
+BMBenchmark::BMBenchmark()
+{
+
+}
+
+
+BMBenchmark::~BMBenchmark()
+{
+
+}
+
+
+Status BMBenchmark::RunBenchmarks(const char* name)
+{
+	Status status = OK;
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "pinhit")))
+	{
+		status = this->PinHitLatency();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "pinmiss")))
+	{
+		status = this->PinMissLatency();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "threads")))
+	{
+		status = this->ConcurrentThroughput();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "prefetch")))
+	{
+		status = this->SequentialScan();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "writer")))
+	{
+		status = this->BackgroundWriter();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "flush")))
+	{
+		status = this->FlushDirtyPool();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "pinrun")))
+	{
+		status = this->PinRunLatency();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "ring")))
+	{
+		status = this->ScanResistance();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "pools")))
+	{
+		status = this->PoolIsolation();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "resize")))
+	{
+		status = this->OnlineResize();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "compressed")))
+	{
+		status = this->CompressedTier();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "warmup")))
+	{
+		status = this->WarmUpRestart();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "pagesize")))
+	{
+		status = this->PageSizeThroughput();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "mmap")))
+	{
+		status = this->MappedScan();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "io")))
+	{
+		status = this->IOEngineThroughput();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "occupancy")))
+	{
+		status = this->EmptyPoolMisses();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "guard")))
+	{
+		status = this->PageGuardLatency();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "wal")))
+	{
+		status = this->GroupCommit();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "mrc")))
+	{
+		status = this->MissRatioEstimates();
+	}
+
+	if (OK == status && (NULL == name || 0 == strcmp(name, "priority")))
+	{
+		status = this->EvictionPriorities();
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::PinHitLatency
+//
+// Fill buffer pools of increasing size with empty pages, then time
+// PinPage/UnpinPage pairs on randomly chosen resident pages. Every
+// pin is a hit, so the cost measured is that of finding the frame.
+// With a constant time page table the latency should stay flat as
+// the pool grows (apart from cache effects on very large pools).
+//--------------------------------------------------------------------
+
+Status BMBenchmark::PinHitLatency()
+{
+	const int poolSizes[] = { 50, 500, 5000, 50000, 100000 };
+	const int numOfPoolSizes = sizeof(poolSizes) / sizeof(poolSizes[0]);
+	const int numOfPins = 2000000;
+
+	Status status = OK;
+	Page* pg;
+
+	cout << "\n  Pin hit latency as the buffer pool grows:\n";
+	cout << "    frames      ns/(pin+unpin)\n";
+
+	// At most 100 MB of frames, whatever the page size
+	for (int s = 0; OK == status && s < numOfPoolSizes && (long)poolSizes[s] * MINIBASE_PAGESIZE <= 100000L * 1024; s++)
+	{
+		int bufSize = poolSizes[s];
+		BufMgr* bufMgr = new BufMgr(bufSize);
+
+		// Make every page resident. The pages are empty, so no I/O happens.
+		for (PageID pid = 0; OK == status && pid < bufSize; pid++)
+		{
+			status = bufMgr->PinPage(pid, pg, true);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		// Pick pages with a linear congruential generator so that the
+		// accesses are spread over the whole pool.
+		unsigned int seed = 12345;
+		double start = NowInNanoseconds();
+
+		for (int i = 0; OK == status && i < numOfPins; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			PageID pid = (seed >> 8) % bufSize;
+
+			status = bufMgr->PinPage(pid, pg);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+
+		if (OK == status)
+		{
+			printf("    %-10d  %8.1f\n", bufSize, elapsed / numOfPins);
+		}
+		else
+		{
+			cerr << "*** Pin hit benchmark failed for " << bufSize << " frames\n";
+		}
+
+		delete bufMgr;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::PinMissLatency
+//
+// Time PinPage/UnpinPage pairs that all miss: a full pool of clean,
+// empty pages is cycled through pages that are not resident, so each
+// pin has to pick a victim. The pages are empty and never dirtied, so
+// no I/O is involved and the time is that of victim selection and
+// page table maintenance.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::PinMissLatency()
+{
+	const int poolSizes[] = { 50, 500, 5000, 50000, 100000 };
+	const int numOfPoolSizes = sizeof(poolSizes) / sizeof(poolSizes[0]);
+	const int numOfPins = 1000000;
+
+	Status status = OK;
+	Page* pg;
+
+	cout << "\n  Pin miss latency as the buffer pool grows:\n";
+	cout << "    frames      ns/(pin+unpin)\n";
+
+	// At most 100 MB of frames, whatever the page size
+	for (int s = 0; OK == status && s < numOfPoolSizes && (long)poolSizes[s] * MINIBASE_PAGESIZE <= 100000L * 1024; s++)
+	{
+		int bufSize = poolSizes[s];
+		BufMgr* bufMgr = new BufMgr(bufSize);
+		PageID pid = 0;
+
+		for (; OK == status && pid < bufSize; pid++)
+		{
+			status = bufMgr->PinPage(pid, pg, true);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double start = NowInNanoseconds();
+
+		for (int i = 0; OK == status && i < numOfPins; i++, pid++)
+		{
+			status = bufMgr->PinPage(pid, pg, true);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+
+		if (OK == status)
+		{
+			printf("    %-10d  %8.1f\n", bufSize, elapsed / numOfPins);
+		}
+		else
+		{
+			cerr << "*** Pin miss benchmark failed for " << bufSize << " frames\n";
+		}
+
+		delete bufMgr;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::ConcurrentThroughput
+//
+// Run PinWorkers on 1, 2, 4, ... threads, up to the number of cores
+// (and at least 4, so that the latching is exercised even on small
+// machines), and report the total throughput for two workloads:
+//
+//   hits   - all pages are resident and empty: no I/O at all, so this
+//            measures how well page table and replacer latching scale.
+//   misses - a pool of 100 frames over 1000 pages stamped with their
+//            page ids on disk. Pins miss, read, evict and write back
+//            dirty pages concurrently; the stamp of every pinned page
+//            is checked, and any mismatch fails the benchmark.
+//
+// The pools use Clock, the policy of the shared pool.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::ConcurrentThroughput()
+{
+	const int numOfPages = 1000;
+	const int poolSize = 100;
+	const int numOfPins = 200000;
+
+	long numOfCores = sysconf(_SC_NPROCESSORS_ONLN);
+	int maxThreads = (numOfCores > 4) ? (int)numOfCores : 4;
+
+	Page* pg;
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Concurrent PinPage/UnpinPage throughput (" << numOfCores << " cores):\n";
+	cout << "    threads    hits Mpins/s    misses Mpins/s    miss ratio\n";
+
+	PinWorker* workers = new PinWorker[maxThreads];
+	pthread_t* threads = new pthread_t[maxThreads];
+
+	// Double the number of threads, but make sure the number of cores
+	// itself is measured
+	for (int numOfThreads = 1; OK == status && numOfThreads <= maxThreads;
+		numOfThreads = (numOfThreads < maxThreads && 2 * numOfThreads > maxThreads) ? maxThreads : 2 * numOfThreads)
+	{
+		double throughput[2];
+		double missRatio = 0;
+
+		for (int verify = 0; OK == status && verify <= 1; verify++)
+		{
+			BufMgr* bufMgr = new BufMgr(verify ? poolSize : numOfPages, "Clock");
+
+			// Make every page resident for the hit workload
+			for (int i = 0; OK == status && !verify && i < numOfPages; i++)
+			{
+				status = bufMgr->PinPage(firstPid + i, pg, true);
+
+				if (OK == status)
+				{
+					status = bufMgr->UnpinPage(firstPid + i);
+				}
+			}
+
+			bufMgr->ResetStat();
+			double start = NowInNanoseconds();
+
+			for (int t = 0; OK == status && t < numOfThreads; t++)
+			{
+				workers[t].bufMgr = bufMgr;
+				workers[t].firstPid = firstPid;
+				workers[t].numOfPages = numOfPages;
+				workers[t].numOfPins = numOfPins;
+				workers[t].verify = verify;
+				workers[t].dirtyMask = 7;
+				workers[t].seed = 12345 + 7919 * t;
+
+				pthread_create(&threads[t], NULL, RunPinWorker, &workers[t]);
+			}
+
+			int numOfErrors = 0;
+			for (int t = 0; OK == status && t < numOfThreads; t++)
+			{
+				pthread_join(threads[t], NULL);
+
+				numOfErrors += workers[t].numOfErrors;
+				if (OK != workers[t].status)
+				{
+					cerr << "*** Pin failed in thread " << t << "\n";
+					status = FAIL;
+				}
+			}
+
+			double elapsed = NowInNanoseconds() - start;
+			throughput[verify] = (double)numOfThreads * numOfPins / elapsed * 1e3;
+
+			if (numOfErrors > 0)
+			{
+				cerr << "*** " << numOfErrors << " pins returned the wrong page\n";
+				status = FAIL;
+			}
+
+			if (verify)
+			{
+				long pinNo, missNo;
+				bufMgr->GetStat(pinNo, missNo);
+				missRatio = (double)missNo / pinNo;
+			}
+
+			delete bufMgr;
+		}
+
+		if (OK == status)
+		{
+			printf("    %-7d    %13.2f    %15.2f    %9.1f%%\n", numOfThreads, throughput[0], throughput[1], 100 * missRatio);
+		}
+	}
+
+	delete[] workers;
+	delete[] threads;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::SequentialScan
+//
+// Scan 1500 pages through a pool of 100 frames, spending some time on
+// each page as a scan or join consumer would. Reported, like the join
+// tests do, are the pin requests, pin misses and duration of a scan
+//
+//   sync      - with read-ahead turned off: every page is read in by
+//               PinPage, in the scanning thread;
+//   readahead - with the default automatic read-ahead;
+//   prefetch  - with read-ahead off, but the scan calling Prefetch for
+//               the next 16 pages every 16 pages.
+//
+// The pages are checked to hold their own page id.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::SequentialScan()
+{
+	const char* modes[] = { "sync", "readahead", "prefetch" };
+	const int numOfPages = 1500;
+	const int poolSize = 100;
+	const int batch = 16;
+
+	Page* pg;
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Sequential scan of " << numOfPages << " pages through " << poolSize << " frames:\n";
+	cout << "    mode         pins    misses  prefetched   duration (ms)\n";
+
+	for (int m = 0; OK == status && m < 3; m++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize);
+		unsigned int checksum = 0;
+		int numOfErrors = 0;
+
+		bufMgr->SetReadAhead(1 == m ? BUF_READ_AHEAD_PAGES : 0);
+		bufMgr->ResetStat();
+
+		double start = NowInNanoseconds();
+
+		for (int i = 0; OK == status && i < numOfPages; i++)
+		{
+			PageID pid = firstPid + i;
+
+			if (2 == m && 0 == i % batch)
+			{
+				bufMgr->Prefetch(pid + batch, batch);
+			}
+
+			status = bufMgr->PinPage(pid, pg);
+
+			if (OK == status)
+			{
+				if (*(PageID*)pg != pid)
+				{
+					numOfErrors++;
+				}
+
+				// Work on the page for a while
+				for (int pass = 0; pass < 8; pass++)
+				{
+					for (int b = 0; b < MINIBASE_PAGESIZE; b++)
+					{
+						checksum = checksum * 31 + ((unsigned char*)pg)[b];
+					}
+				}
+
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+
+		if (numOfErrors > 0)
+		{
+			cerr << "*** " << numOfErrors << " pins returned the wrong page\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			long pinNo, missNo;
+			bufMgr->GetStat(pinNo, missNo);
+
+			printf("    %-10s %6ld  %8ld  %10ld  %14.2f\n", modes[m], pinNo, missNo, bufMgr->GetNumOfPrefetches(), elapsed / 1e6);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::BackgroundWriter
+//
+// Random pins over 1500 pages through 100 frames, three quarters of
+// them to the first eighth of the pages, every other one unpinned
+// dirty. Reported are the misses, the dirty pages written by the pins
+// themselves (foreground) and by the background writer, and the time
+// taken, with the background writer off and on. The pages are checked
+// to hold their own page id.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::BackgroundWriter()
+{
+	const int numOfPages = 1500;
+	const int poolSize = 100;
+	const int numOfPins = 200000;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Dirty page writes with and without the background writer:\n";
+	cout << "    writer      misses  foreground  background   duration (ms)\n";
+
+	for (int on = 0; OK == status && on <= 1; on++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize);
+		bufMgr->SetReadAhead(0);
+		bufMgr->SetBackgroundWriter(on ? BUF_CLEAN_PERCENT : 0);
+
+		PinWorker worker;
+		worker.bufMgr = bufMgr;
+		worker.firstPid = firstPid;
+		worker.numOfPages = numOfPages;
+		worker.numOfPins = numOfPins;
+		worker.verify = true;
+		worker.dirtyMask = 1;
+		worker.seed = 12345;
+
+		double start = NowInNanoseconds();
+		RunPinWorker(&worker);
+		double elapsed = NowInNanoseconds() - start;
+
+		status = worker.status;
+
+		if (worker.numOfErrors > 0)
+		{
+			cerr << "*** " << worker.numOfErrors << " pins returned the wrong page\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			long pinNo, missNo, foregroundWrites, backgroundWrites;
+			bufMgr->GetStat(pinNo, missNo);
+			bufMgr->GetWriteStat(foregroundWrites, backgroundWrites);
+
+			printf("    %-9s %8ld  %10ld  %10ld  %14.2f\n", on ? "on" : "off", missNo, foregroundWrites, backgroundWrites, elapsed / 1e6);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::FlushDirtyPool
+//
+// Dirty every page of a pool of 1500 frames, loading the pages in
+// random order, then time writing them back with one FlushPage per
+// page in the order they were loaded against a single FlushAllPages,
+// which writes them sorted by page id in coalesced runs.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::FlushDirtyPool()
+{
+	const int numOfPages = 1500;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	// Shuffle the pages
+	PageID* order = new PageID[numOfPages];
+	unsigned int seed = 12345;
+
+	for (int i = 0; i < numOfPages; i++)
+	{
+		order[i] = firstPid + i;
+	}
+
+	for (int i = numOfPages - 1; i > 0; i--)
+	{
+		seed = seed * 1103515245 + 12345;
+		int j = (seed >> 8) % (i + 1);
+		PageID pid = order[i];
+		order[i] = order[j];
+		order[j] = pid;
+	}
+
+	cout << "\n  Writing back a fully dirty pool of " << numOfPages << " frames:\n";
+	cout << "    method                  duration (ms)\n";
+
+	for (int sorted = 0; OK == status && sorted <= 1; sorted++)
+	{
+		BufMgr* bufMgr = new BufMgr(numOfPages);
+		bufMgr->SetReadAhead(0);
+		bufMgr->SetBackgroundWriter(0);
+
+		for (int i = 0; OK == status && i < numOfPages; i++)
+		{
+			Page* pg;
+			status = bufMgr->PinPage(order[i], pg);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(order[i], true);
+			}
+		}
+
+		double start = NowInNanoseconds();
+
+		if (sorted)
+		{
+			status = bufMgr->FlushAllPages();
+		}
+
+		for (int i = 0; OK == status && !sorted && i < numOfPages; i++)
+		{
+			status = bufMgr->FlushPage(order[i]);
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+
+		if (OK == status)
+		{
+			printf("    %-21s %15.2f\n", sorted ? "FlushAllPages" : "FlushPage per page", elapsed / 1e6);
+		}
+
+		delete bufMgr;
+	}
+
+	delete[] order;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::PinRunLatency
+//
+// Read 1500 pages from disk into an empty pool, in runs of increasing
+// length, with one PinRun per run and with one PinPage per page.
+// Read-ahead is off, so that every page is read by the pinning call.
+// The pages are checked to hold their own page id.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::PinRunLatency()
+{
+	const int numOfPages = 1500;
+	const int runSizes[] = { 1, 8, 64 };
+	const int numOfRunSizes = sizeof(runSizes) / sizeof(runSizes[0]);
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+	Page** pages = new Page*[numOfPages];
+
+	cout << "\n  Reading " << numOfPages << " pages into an empty pool:\n";
+	cout << "    run length    PinPage (ms)     PinRun (ms)\n";
+
+	for (int r = 0; OK == status && r < numOfRunSizes; r++)
+	{
+		double elapsed[2];
+
+		for (int useRun = 0; OK == status && useRun <= 1; useRun++)
+		{
+			BufMgr* bufMgr = new BufMgr(numOfPages);
+			bufMgr->SetReadAhead(0);
+
+			double start = NowInNanoseconds();
+
+			for (int first = 0; OK == status && first < numOfPages; first += runSizes[r])
+			{
+				int count = (numOfPages - first < runSizes[r]) ? numOfPages - first : runSizes[r];
+
+				if (useRun)
+				{
+					status = bufMgr->PinRun(firstPid + first, count, pages + first);
+				}
+
+				for (int i = 0; OK == status && !useRun && i < count; i++)
+				{
+					status = bufMgr->PinPage(firstPid + first + i, pages[first + i]);
+				}
+			}
+
+			elapsed[useRun] = NowInNanoseconds() - start;
+
+			for (int i = 0; OK == status && i < numOfPages; i++)
+			{
+				if (*(PageID*)pages[i] != firstPid + i)
+				{
+					cerr << "*** Page " << firstPid + i << " holds the wrong data\n";
+					status = FAIL;
+				}
+			}
+
+			for (int i = 0; OK == status && i < numOfPages; i++)
+			{
+				status = bufMgr->UnpinPage(firstPid + i);
+			}
+
+			delete bufMgr;
+		}
+
+		if (OK == status)
+		{
+			printf("    %10d  %14.2f  %14.2f\n", runSizes[r], elapsed[0] / 1e6, elapsed[1] / 1e6);
+		}
+	}
+
+	delete[] pages;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::ScanResistance
+//
+// A pool of 200 frames holds a hot set of 100 pages (think B+ tree
+// inner pages). A full scan of 1300 other pages runs, then the hot set
+// is read again. Reported are the misses of the second pass over the
+// hot set and the time the scan took, scanning through plain PinPage
+// and through a BufferRing of BUF_RING_FRAMES frames.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::ScanResistance()
+{
+	const int numOfPages = 1400;
+	const int numOfHotPages = 100;
+	const int poolSize = 200;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Hot set misses after a scan of " << numOfPages - numOfHotPages << " pages:\n";
+	cout << "    scan        hot misses    scan (ms)\n";
+
+	for (int useRing = 0; OK == status && useRing <= 1; useRing++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize);
+		BufferRing* ring = useRing ? new BufferRing() : NULL;
+		Page* pg;
+		long pinNo, missNo, oldMissNo;
+
+		bufMgr->SetReadAhead(0);
+
+		for (int i = 0; OK == status && i < numOfHotPages; i++)
+		{
+			status = bufMgr->PinPage(firstPid + i, pg);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(firstPid + i);
+			}
+		}
+
+		double start = NowInNanoseconds();
+
+		for (PageID pid = firstPid + numOfHotPages; OK == status && pid < firstPid + numOfPages; pid++)
+		{
+			status = bufMgr->PinPage(pid, pg, false, PAGE_CLASS_DATA, ring);
+
+			if (OK == status && *(PageID*)pg != pid)
+			{
+				cerr << "*** Page " << pid << " holds the wrong data\n";
+				status = FAIL;
+			}
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+		bufMgr->GetStat(pinNo, oldMissNo);
+
+		for (int i = 0; OK == status && i < numOfHotPages; i++)
+		{
+			status = bufMgr->PinPage(firstPid + i, pg);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(firstPid + i);
+			}
+		}
+
+		bufMgr->GetStat(pinNo, missNo);
+
+		if (OK == status)
+		{
+			printf("    %-10s %11ld %12.2f\n", useRing ? "ring" : "PinPage", missNo - oldMissNo, elapsed / 1e6);
+		}
+
+		delete ring;
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::PoolIsolation
+//
+// The same workload as ScanResistance, with 200 frames either in one
+// pool or split into two pools of 100, the hot set being bound to an
+// "index" pool. Reported are the misses of the second pass over the
+// hot set, and the time a pin of a hot page takes then, which includes
+// looking up the pool of the page.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::PoolIsolation()
+{
+	const int numOfPages = 1400;
+	const int numOfHotPages = 100;
+	const int poolSize = 200;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Hot set misses after a scan of " << numOfPages - numOfHotPages << " pages:\n";
+	cout << "    pools       hot misses    hot pin (ns)\n";
+
+	for (int split = 0; OK == status && split <= 1; split++)
+	{
+		BufMgr* bufMgr = new BufMgr(split ? poolSize / 2 : poolSize);
+		BufMgr* hotPool = bufMgr;
+		Page* pg;
+		long pinNo, missNo, oldMissNo;
+
+		bufMgr->SetReadAhead(0);
+
+		if (split)
+		{
+			status = bufMgr->AddPool("index", poolSize / 2);
+
+			if (OK == status)
+			{
+				hotPool = bufMgr->GetPool("index");
+				hotPool->SetReadAhead(0);
+				status = bufMgr->BindPages(firstPid, numOfHotPages, "index");
+			}
+		}
+
+		for (int i = 0; OK == status && i < numOfHotPages; i++)
+		{
+			status = bufMgr->PinPage(firstPid + i, pg);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(firstPid + i);
+			}
+		}
+
+		for (PageID pid = firstPid + numOfHotPages; OK == status && pid < firstPid + numOfPages; pid++)
+		{
+			status = bufMgr->PinPage(pid, pg, false, PAGE_CLASS_DATA);
+
+			if (OK == status && *(PageID*)pg != pid)
+			{
+				cerr << "*** Page " << pid << " holds the wrong data\n";
+				status = FAIL;
+			}
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		hotPool->GetStat(pinNo, oldMissNo);
+		double start = NowInNanoseconds();
+
+		for (int i = 0; OK == status && i < numOfHotPages; i++)
+		{
+			status = bufMgr->PinPage(firstPid + i, pg);
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(firstPid + i);
+			}
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+		hotPool->GetStat(pinNo, missNo);
+
+		if (OK == status)
+		{
+			printf("    %-10s %11ld %15.1f\n", split ? "index+heap" : "one", missNo - oldMissNo, elapsed / numOfHotPages);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::OnlineResize
+//
+// Four threads pin and unpin (and dirty) pages of a pool of 100 frames
+// over 1000 pages, checking the contents of each page, while the pool
+// is resized to each size in turn. Reported are the time each resize
+// took (a shrink waits for the frames that go away to be unpinned, and
+// writes their pages back) and the miss ratio at each size.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::OnlineResize()
+{
+	const int numOfPages = 1000;
+	const int numOfThreads = 4;
+	const int numOfPins = 50000;
+	const int sizes[] = { 400, 50, 200, 25, 100 };
+	const int numOfSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Resizing a pool of 100 frames under " << numOfThreads << " threads:\n";
+	cout << "    size    resize (ms)    miss ratio\n";
+
+	BufMgr* bufMgr = new BufMgr(100);
+	PinWorker workers[numOfThreads];
+	pthread_t threads[numOfThreads];
+
+	for (int s = 0; OK == status && s < numOfSizes; s++)
+	{
+		// Resize while the threads of the previous round are running
+		double start = NowInNanoseconds();
+		Status resized = bufMgr->Resize(sizes[s]);
+		double elapsed = NowInNanoseconds() - start;
+
+		for (int t = 0; t < numOfThreads && s > 0; t++)
+		{
+			pthread_join(threads[t], NULL);
+		}
+
+		bufMgr->ResetStat();
+
+		for (int t = 0; t < numOfThreads; t++)
+		{
+			workers[t].bufMgr = bufMgr;
+			workers[t].firstPid = firstPid;
+			workers[t].numOfPages = numOfPages;
+			workers[t].numOfPins = numOfPins;
+			workers[t].verify = true;
+			workers[t].dirtyMask = 7;
+			workers[t].seed = 12345 + 7919 * t + s;
+
+			pthread_create(&threads[t], NULL, RunPinWorker, &workers[t]);
+		}
+
+		if (OK != resized)
+		{
+			cerr << "*** Could not resize the pool to " << sizes[s] << " frames\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			// Let the threads run at the new size before the next one
+			usleep(20000);
+
+			long pinNo, missNo;
+			bufMgr->GetStat(pinNo, missNo);
+			printf("    %-7d %11.3f %12.1f%%\n", sizes[s], elapsed / 1e6, pinNo ? 100.0 * missNo / pinNo : 0.0);
+		}
+	}
+
+	int numOfErrors = 0;
+	for (int t = 0; t < numOfThreads; t++)
+	{
+		pthread_join(threads[t], NULL);
+
+		numOfErrors += workers[t].numOfErrors;
+		if (OK != workers[t].status)
+		{
+			cerr << "*** Pin failed in thread " << t << "\n";
+			status = FAIL;
+		}
+	}
+
+	if (numOfErrors > 0)
+	{
+		cerr << "*** " << numOfErrors << " pins returned the wrong page\n";
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		status = bufMgr->FlushAllPages();
+	}
+
+	delete bufMgr;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+//--------------------------------------------------------------------
+// BMBenchmark::CompressedTier
+//
+// Random pins over 1000 stamped (and otherwise empty) pages through a
+// pool of 100 frames, without a second tier and with compressed caches
+// of increasing size. Reported are the share of the misses served by
+// the compressed cache, the pages still read from disk, and the time
+// a pin takes on average.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::CompressedTier()
+{
+	const int numOfPages = 1000;
+	const int poolSize = 100;
+	const int numOfPins = 100000;
+	const int budgets[] = { 0, 16 * 1024, 64 * 1024, 256 * 1024 };
+	const int numOfBudgets = sizeof(budgets) / sizeof(budgets[0]);
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Random pins over " << numOfPages << " pages, " << poolSize << " frames:\n";
+	cout << "    tier 2 (KB)    tier 2 hits    disk reads    pin (ns)\n";
+
+	for (int b = 0; OK == status && b < numOfBudgets; b++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize);
+		BufStats stats;
+		Page* pg;
+
+		bufMgr->SetReadAhead(0);
+
+		if (budgets[b] > 0)
+		{
+			status = bufMgr->EnableCompressedCache(budgets[b]);
+		}
+
+		unsigned int seed = 12345;
+		double start = NowInNanoseconds();
+
+		for (int i = 0; OK == status && i < numOfPins; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			PageID pid = firstPid + (seed >> 8) % numOfPages;
+
+			status = bufMgr->PinPage(pid, pg);
+
+			if (OK == status && *(PageID*)pg != pid)
+			{
+				cerr << "*** Page " << pid << " holds the wrong data\n";
+				status = FAIL;
+			}
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double elapsed = NowInNanoseconds() - start;
+		bufMgr->GetStats(stats);
+
+		if (OK == status)
+		{
+			long misses = stats.GetMisses();
+			printf("    %-14d %10.1f%% %13ld %11.1f\n", budgets[b] / 1024,
+				misses ? 100.0 * stats.compressedHits / misses : 0.0,
+				misses - stats.compressedHits, elapsed / numOfPins);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::WarmUpRestart
+//
+// A pool of 150 frames runs a skewed workload over 1200 pages until
+// its hit ratio is steady, and is destroyed, saving its warm-up list.
+// A new pool then runs the same workload, once cold and once warming
+// up from the list, in bursts of 500 pins 1 ms apart. Reported are
+// the hit ratio of the first burst, and the pins and time it takes
+// to get within 5% of the steady hit ratio.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::WarmUpRestart()
+{
+	const int numOfPages = 1200;
+	const int numOfHotPages = 135;
+	const int poolSize = 150;
+	const int window = 500;
+	const int maxWindows = 100;
+	const char* warmUpFile = "BMBENCH.DB.warm";
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+	unsigned int seed = 12345;
+	long missNo = 0;
+	double steady = 0;
+
+	BufMgr* bufMgr = new BufMgr(poolSize);
+	bufMgr->SetReadAhead(0);
+	bufMgr->SetWarmUpFile(warmUpFile);
+
+	if (OK == status)
+	{
+		status = PinSkewed(bufMgr, firstPid, numOfPages, numOfHotPages, 20 * window, seed, missNo);
+	}
+
+	if (OK == status)
+	{
+		status = PinSkewed(bufMgr, firstPid, numOfPages, numOfHotPages, 20 * window, seed, missNo);
+		steady = 1.0 - (double)missNo / (20 * window);
+	}
+
+	// Saves the list
+	delete bufMgr;
+
+	printf("\n  Restarting a pool of %d frames, steady hit ratio %.1f%%:\n", poolSize, 100 * steady);
+	cout << "    start      first burst     pins to steady    ms to steady\n";
+
+	for (int warm = 0; OK == status && warm <= 1; warm++)
+	{
+		bufMgr = new BufMgr(poolSize);
+		bufMgr->SetReadAhead(0);
+
+		double start = NowInNanoseconds();
+
+		if (warm)
+		{
+			bufMgr->SetWarmUpFile(warmUpFile);
+			status = bufMgr->WarmUp();
+		}
+
+		double firstHitRatio = 0;
+		double elapsed = 0;
+		int numOfWindows = 0;
+		bool isSteady = false;
+
+		// The same pins for both
+		seed = 54321;
+
+		while (OK == status && !isSteady && numOfWindows < maxWindows)
+		{
+			// Queries come in bursts, leaving the prefetcher time
+			usleep(1000);
+
+			status = PinSkewed(bufMgr, firstPid, numOfPages, numOfHotPages, window, seed, missNo);
+
+			double hitRatio = 1.0 - (double)missNo / window;
+			if (0 == numOfWindows)
+			{
+				firstHitRatio = hitRatio;
+			}
+
+			numOfWindows++;
+			isSteady = (hitRatio >= 0.95 * steady);
+			elapsed = NowInNanoseconds() - start;
+		}
+
+		if (OK == status)
+		{
+			printf("    %-10s %11.1f%% %17d %15.3f\n", warm ? "warm-up" : "cold", 100 * firstHitRatio,
+				numOfWindows * window, elapsed / 1e6);
+		}
+
+		delete bufMgr;
+	}
+
+	unlink(warmUpFile);
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+//--------------------------------------------------------------------
+// BMBenchmark::PageSizeThroughput
+//
+// Scan and B+tree lookup throughput at the page size Minibase is built
+// with; build with -DMINIBASE_PAGE_SIZE=n to compare page sizes. The
+// pool has 256 KiB of frames whatever the page size. The scan reads
+// 1 MiB of pages in order, eight times, with read-ahead. The lookups
+// go down a B+tree of 100000 keys packed into full pages, for random
+// keys. Reported are the throughput and the pages read per scan or
+// lookup.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::PageSizeThroughput()
+{
+	const int poolSize = 256 * 1024 / MINIBASE_PAGESIZE;
+	const int numOfScanPages = 1024 * 1024 / MINIBASE_PAGESIZE;
+	const int numOfScans = 8;
+	const int numOfKeys = 100000;
+	const int numOfLookUps = 20000;
+	const int fanout = (MINIBASE_PAGESIZE / (int)sizeof(int) - 1) / 2;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfScanPages);
+	BufMgr* bufMgr = new BufMgr(poolSize);
+	long pinNo, missNo;
+	Page* pg;
+
+	printf("\n  Throughput with %d byte pages, %d frames:\n", MINIBASE_PAGESIZE, poolSize);
+	cout << "    workload         pages    height      per second    reads each\n";
+
+	double start = NowInNanoseconds();
+
+	for (int s = 0; OK == status && s < numOfScans; s++)
+	{
+		for (PageID pid = firstPid; OK == status && pid < firstPid + numOfScanPages; pid++)
+		{
+			status = bufMgr->PinPage(pid, pg, false, PAGE_CLASS_DATA);
+
+			if (OK == status && *(PageID*)pg != pid)
+			{
+				cerr << "*** Page " << pid << " holds the wrong data\n";
+				status = FAIL;
+			}
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+	}
+
+	double elapsed = NowInNanoseconds() - start;
+	bufMgr->GetStat(pinNo, missNo);
+
+	if (OK == status)
+	{
+		printf("    %-12s %9d %9s %12.1f MB %12.1f\n", "scan", numOfScanPages, "-",
+			numOfScans / (elapsed / 1e9), (double)(missNo + bufMgr->GetNumOfPrefetches()) / numOfScans);
+	}
+
+	delete bufMgr;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfScanPages);
+	}
+
+	// Size the levels of the tree, leaves first
+	int levelSizes[8];
+	int height = 0;
+	int numOfTreePages = 0;
+
+	for (int n = numOfKeys; 0 == height || n > 1; height++)
+	{
+		n = (n + fanout - 1) / fanout;
+		levelSizes[height] = n;
+		numOfTreePages += n;
+	}
+
+	firstPid = INVALID_PAGE;
+
+	if (OK == status)
+	{
+		status = MINIBASE_BM->NewPage(firstPid, pg, numOfTreePages);
+
+		if (OK == status)
+		{
+			status = MINIBASE_BM->UnpinPage(firstPid);
+		}
+	}
+
+	// Fill the levels bottom up, each in consecutive pages. Leaves map
+	// key k to 3k; an inner entry starts with the first key of its
+	// child, that is j times fanout to the level for the j-th entry.
+	PageID levelPid = firstPid;
+	int numOfEntries = numOfKeys;
+
+	for (int level = 0; OK == status && level < height; level++)
+	{
+		for (int i = 0; OK == status && i < levelSizes[level]; i++)
+		{
+			status = MINIBASE_BM->PinPage(levelPid + i, pg, true);
+
+			if (OK == status)
+			{
+				int* entries = (int*)pg;
+				int first = i * fanout;
+				int count = (numOfEntries - first < fanout) ? numOfEntries - first : fanout;
+
+				entries[0] = count;
+				for (int e = 0; e < count; e++)
+				{
+					int key = first + e;
+					for (int l = 0; l < level; l++)
+					{
+						key *= fanout;
+					}
+
+					entries[1 + 2 * e] = key;
+					entries[2 + 2 * e] = (0 == level) ? 3 * key : levelPid - levelSizes[level - 1] + first + e;
+				}
+
+				status = MINIBASE_BM->UnpinPage(levelPid + i, true);
+			}
+		}
+
+		numOfEntries = levelSizes[level];
+		levelPid += levelSizes[level];
+	}
+
+	if (OK == status)
+	{
+		status = MINIBASE_BM->FlushAllPages();
+	}
+
+	PageID rootPid = levelPid - 1;
+	bufMgr = new BufMgr(poolSize);
+	unsigned int seed = 12345;
+
+	start = NowInNanoseconds();
+
+	for (int i = 0; OK == status && i < numOfLookUps; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		int key = (seed >> 8) % numOfKeys;
+		int value;
+
+		status = LookUpKey(bufMgr, rootPid, height, key, value);
+
+		if (OK == status && value != 3 * key)
+		{
+			cerr << "*** Key " << key << " looked up as " << value << "\n";
+			status = FAIL;
+		}
+	}
+
+	elapsed = NowInNanoseconds() - start;
+	bufMgr->GetStat(pinNo, missNo);
+
+	if (OK == status)
+	{
+		printf("    %-12s %9d %9d %15.0f %12.2f\n", "lookup", numOfTreePages, height,
+			numOfLookUps / (elapsed / 1e9), (double)missNo / numOfLookUps);
+	}
+
+	delete bufMgr;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfTreePages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::MappedScan
+//
+// Read-mostly scans of 1500 pages that fit in memory, through a pool
+// of 1600 frames and through the mapping of the database. Each scan
+// checks the stamp of every page, and rewrites that of every 64th one
+// before unpinning it dirty. Reported are the first scan, which reads
+// the pages in, the following ones, per pin, and the FlushAllPages
+// that writes the modified pages back.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::MappedScan()
+{
+	const int numOfPages = 1500;
+	const int poolSize = 1600;
+	const int numOfScans = 20;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Read-mostly scans of " << numOfPages << " pages that fit in memory:\n";
+	cout << "    mode       first scan (ns/pin)    next scans (ns/pin)    flush (ms)\n";
+
+	for (int mapped = 0; OK == status && mapped <= 1; mapped++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize);
+		double firstScan = 0;
+		Page* pg;
+
+		bufMgr->SetReadAhead(0);
+
+		if (mapped)
+		{
+			status = bufMgr->UseMapping();
+		}
+
+		double start = NowInNanoseconds();
+
+		for (int s = 0; OK == status && s < numOfScans; s++)
+		{
+			for (PageID pid = firstPid; OK == status && pid < firstPid + numOfPages; pid++)
+			{
+				status = bufMgr->PinPage(pid, pg, false, PAGE_CLASS_DATA);
+
+				if (OK == status && *(PageID*)pg != pid)
+				{
+					cerr << "*** Page " << pid << " holds the wrong data\n";
+					status = FAIL;
+				}
+
+				bool dirty = (0 == pid % 64);
+				if (OK == status && dirty)
+				{
+					*(PageID*)pg = pid;
+				}
+
+				if (OK == status)
+				{
+					status = bufMgr->UnpinPage(pid, dirty);
+				}
+			}
+
+			if (0 == s)
+			{
+				firstScan = NowInNanoseconds() - start;
+				start = NowInNanoseconds();
+			}
+		}
+
+		double nextScans = NowInNanoseconds() - start;
+
+		start = NowInNanoseconds();
+		if (OK == status)
+		{
+			status = bufMgr->FlushAllPages();
+		}
+		double flush = NowInNanoseconds() - start;
+
+		if (OK == status)
+		{
+			printf("    %-10s %17.1f %22.1f %13.3f\n", mapped ? "mmap" : "frames", firstScan / numOfPages,
+				nextScans / ((numOfScans - 1) * numOfPages), flush / 1e6);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::IOEngineThroughput
+//
+// Page I/O with many requests in flight, through DB::ReadPage and
+// DB::WritePage (sync) and through each I/O engine, buffered and with
+// O_DIRECT. Reported are
+//
+//   prefetch - the time to bring 1500 pages into an empty pool of 1600
+//              frames by prefetching them in random order, 200 at a
+//              time, waiting for each lot;
+//   flush    - the time FlushAllPages takes to write back every other
+//              one of the pages, dirtied in random order, so that
+//              there are no runs to coalesce.
+//
+// The pages are checked to hold their own page id afterwards.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::IOEngineThroughput()
+{
+	const char* engines[] = { "sync", "threads", "threads", "io_uring", "io_uring" };
+	const bool  direct[]  = { false,  false,     true,      false,      true };
+	const int numOfPages = 1500;
+	const int poolSize = 1600;
+	const int lot = 200;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	// Shuffle the pages
+	PageID* order = new PageID[numOfPages];
+	unsigned int seed = 12345;
+
+	for (int i = 0; i < numOfPages; i++)
+	{
+		order[i] = firstPid + i;
+	}
+
+	for (int i = numOfPages - 1; i > 0; i--)
+	{
+		seed = seed * 1103515245 + 12345;
+		int j = (seed >> 8) % (i + 1);
+		PageID pid = order[i];
+		order[i] = order[j];
+		order[j] = pid;
+	}
+
+	cout << "\n  Random prefetches and scattered write-back of " << numOfPages << " pages:\n";
+	cout << "    engine     direct   prefetch (ms)   misses   flush (ms)\n";
+
+	for (int e = 0; OK == status && e < 5; e++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize);
+		bufMgr->SetReadAhead(0);
+		bufMgr->SetBackgroundWriter(0);
+
+		if (0 != strcmp(engines[e], "sync"))
+		{
+			status = bufMgr->SetIOEngine(engines[e], direct[e]);
+		}
+
+		double start = NowInNanoseconds();
+
+		for (int first = 0; OK == status && first < numOfPages; first += lot)
+		{
+			long expected = bufMgr->GetNumOfPrefetches();
+
+			for (int i = first; i < first + lot && i < numOfPages; i++)
+			{
+				bufMgr->Prefetch(order[i]);
+				expected++;
+			}
+
+			// Give up on pages the prefetcher skipped after a while
+			for (int wait = 0; wait < 5000 && bufMgr->GetNumOfPrefetches() < expected; wait++)
+			{
+				usleep(100);
+			}
+		}
+
+		double prefetchTime = NowInNanoseconds() - start;
+		long pinNo, missNo;
+		int numOfErrors = 0;
+
+		bufMgr->ResetStat();
+
+		// Check the pages, and dirty every other one
+		for (int i = 0; OK == status && i < numOfPages; i++)
+		{
+			Page* pg;
+			status = bufMgr->PinPage(order[i], pg);
+
+			if (OK == status)
+			{
+				if (*(PageID*)pg != order[i])
+				{
+					numOfErrors++;
+				}
+
+				status = bufMgr->UnpinPage(order[i], 0 == (order[i] - firstPid) % 2);
+			}
+		}
+
+		bufMgr->GetStat(pinNo, missNo);
+
+		start = NowInNanoseconds();
+
+		if (OK == status)
+		{
+			status = bufMgr->FlushAllPages();
+		}
+
+		double flushTime = NowInNanoseconds() - start;
+
+		if (numOfErrors > 0)
+		{
+			cerr << "*** " << numOfErrors << " pins returned the wrong page\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			printf("    %-10s %-6s %15.2f %8ld %12.2f\n", bufMgr->GetIOEngineName(), direct[e] ? "yes" : "no",
+				   prefetchTime / 1e6, missNo, flushTime / 1e6);
+		}
+
+		delete bufMgr;
+	}
+
+	delete[] order;
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::EmptyPoolMisses
+//
+// Read 1500 pages into a fresh pool of 32768 frames, under each
+// replacement policy, then ask for the number of unpinned frames and
+// for the pool statistics. Reported are the time per miss, the frames
+// the replacer looked at per miss, and the time of each query.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::EmptyPoolMisses()
+{
+	const char* policies[] = { "LRU", "Clock", "LRU-K", "2Q", "ARC" };
+	const int numOfPages = 1500;
+	const int poolSize = 32768;
+	const int numOfQueries = 1000;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Misses into an empty pool of " << poolSize << " frames:\n";
+	cout << "    policy     ns/miss   examined/miss   unpinned (ns)   stats (ns)\n";
+
+	for (int p = 0; OK == status && p < 5; p++)
+	{
+		BufMgr* bufMgr = new BufMgr(poolSize, policies[p]);
+		bufMgr->SetReadAhead(0);
+		bufMgr->ResetStat();
+
+		double start = NowInNanoseconds();
+
+		for (int i = 0; OK == status && i < numOfPages; i++)
+		{
+			Page* pg;
+			PageID pid = firstPid + i;
+			status = bufMgr->PinPage(pid, pg);
+
+			if (OK == status && *(PageID*)pg != pid)
+			{
+				cerr << "*** Page " << pid << " holds the wrong data\n";
+				status = FAIL;
+			}
+
+			if (OK == status)
+			{
+				status = bufMgr->UnpinPage(pid);
+			}
+		}
+
+		double missTime = NowInNanoseconds() - start;
+		unsigned int numOfUnpinnedFrames = 0;
+
+		start = NowInNanoseconds();
+		for (int i = 0; i < numOfQueries; i++)
+		{
+			numOfUnpinnedFrames += bufMgr->GetNumOfUnpinnedFrames();
+		}
+		double unpinnedTime = NowInNanoseconds() - start;
+
+		BufStats stats;
+
+		start = NowInNanoseconds();
+		for (int i = 0; i < numOfQueries; i++)
+		{
+			bufMgr->GetStats(stats);
+		}
+		double statsTime = NowInNanoseconds() - start;
+
+		if (OK == status && (numOfUnpinnedFrames != (unsigned int)poolSize * numOfQueries || stats.numOfValidFrames != numOfPages))
+		{
+			cerr << "*** Wrong occupancy: " << numOfUnpinnedFrames / numOfQueries << " unpinned, "
+				 << stats.numOfValidFrames << " valid frames\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			printf("    %-8s %9.0f %15.1f %15.0f %12.0f\n", policies[p], missTime / numOfPages,
+				(double)stats.victimSearchLength / numOfPages, unpinnedTime / numOfQueries, statsTime / numOfQueries);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::PageGuardLatency
+//
+// Pin and unpin 1000 resident pages over and over, unpinning by page
+// id with UnpinPage against releasing a PageGuard, which unpins
+// through the frame without a second lookup. Measured in a pool of its
+// own, and with the pages bound to a named pool, where UnpinPage also
+// has to find the pool again. Reported is the time per pin and unpin.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::PageGuardLatency()
+{
+	const int numOfPages = 1000;
+	const int numOfRounds = 200;
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+
+	cout << "\n  Pin and unpin of " << numOfPages << " resident pages (ns):\n";
+	cout << "    pool       UnpinPage   PageGuard\n";
+
+	for (int bound = 0; OK == status && bound <= 1; bound++)
+	{
+		BufMgr* bufMgr = new BufMgr(numOfPages + 100);
+		bufMgr->SetReadAhead(0);
+
+		if (bound)
+		{
+			status = bufMgr->AddPool("heap", numOfPages + 100);
+
+			if (OK == status)
+			{
+				status = bufMgr->BindPages(firstPid, numOfPages, "heap");
+			}
+		}
+
+		// Load the pages
+		for (int i = 0; OK == status && i < numOfPages; i++)
+		{
+			PageGuard guard;
+			status = bufMgr->PinPage(firstPid + i, guard);
+		}
+
+		double elapsed[2] = { 0, 0 };
+
+		for (int useGuard = 0; OK == status && useGuard <= 1; useGuard++)
+		{
+			double start = NowInNanoseconds();
+
+			for (int round = 0; OK == status && round < numOfRounds; round++)
+			{
+				for (int i = 0; OK == status && i < numOfPages; i++)
+				{
+					PageID pid = firstPid + i;
+
+					if (useGuard)
+					{
+						PageGuard guard;
+						status = bufMgr->PinPage(pid, guard);
+
+						if (OK == status)
+						{
+							status = guard.Release();
+						}
+					}
+					else
+					{
+						Page* pg;
+						status = bufMgr->PinPage(pid, pg);
+
+						if (OK == status)
+						{
+							status = bufMgr->UnpinPage(pid);
+						}
+					}
+				}
+			}
+
+			elapsed[useGuard] = NowInNanoseconds() - start;
+		}
+
+		if (OK == status && bufMgr->GetNumOfUnpinnedFrames() != (unsigned int)numOfPages + 100)
+		{
+			cerr << "*** Pages were left pinned\n";
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			printf("    %-8s %11.1f %11.1f\n", bound ? "named" : "own",
+				elapsed[0] / numOfPages / numOfRounds, elapsed[1] / numOfPages / numOfRounds);
+		}
+
+		delete bufMgr;
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Work done by one thread of the commit benchmark: numOfCommits
+// transactions, each changing 64 bytes of four random pages among its
+// own numOfPages pages. With the log, the changes are logged and the
+// commit waits for the log; without, the commit writes the pages back
+// and syncs the database file itself.
+//--------------------------------------------------------------------
+
+struct CommitWorker
+{
+	BufMgr*      bufMgr;
+	PageID       firstPid;
+	int          numOfPages;
+	int          numOfCommits;
+	bool         useLog;
+	unsigned int seed;
+
+	Status       status;
+};
+
+
+static void* RunCommitWorker(void* arg)
+{
+	CommitWorker* worker = (CommitWorker*)arg;
+	unsigned int seed = worker->seed;
+	int fd = worker->useLog ? -1 : open(MINIBASE_DB->GetName(), O_RDONLY);
+	char before[64];
+
+	worker->status = OK;
+
+	for (int i = 0; OK == worker->status && i < worker->numOfCommits; i++)
+	{
+		PageID pids[4];
+		int txnId = 0;
+
+		if (worker->useLog)
+		{
+			worker->status = worker->bufMgr->BeginTransaction(txnId);
+		}
+
+		for (int j = 0; OK == worker->status && j < 4; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			pids[j] = worker->firstPid + (seed >> 8) % worker->numOfPages;
+			int offset = 64 + (seed >> 4) % 8 * 64;
+
+			PageGuard guard;
+			worker->status = worker->bufMgr->PinPage(pids[j], guard);
+
+			if (OK == worker->status)
+			{
+				char* data = (char*)guard.GetPage() + offset;
+
+				memcpy(before, data, sizeof(before));
+				memset(data, i, sizeof(before));
+
+				if (worker->useLog)
+				{
+					worker->status = worker->bufMgr->LogUpdate(txnId, guard, offset, sizeof(before), before);
+				}
+				else
+				{
+					guard.DirtyIt();
+				}
+			}
+		}
+
+		if (OK == worker->status && worker->useLog)
+		{
+			worker->status = worker->bufMgr->CommitTransaction(txnId);
+		}
+
+		for (int j = 0; OK == worker->status && !worker->useLog && j < 4; j++)
+		{
+			// The same page may have been changed twice
+			bool repeated = false;
+			for (int k = 0; k < j; k++)
+			{
+				repeated |= (pids[k] == pids[j]);
+			}
+
+			if (!repeated)
+			{
+				worker->status = worker->bufMgr->FlushPage(pids[j]);
+			}
+		}
+
+		if (OK == worker->status && !worker->useLog && 0 != fdatasync(fd))
+		{
+			worker->status = FAIL;
+		}
+	}
+
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+//--------------------------------------------------------------------
+// Log a change of length bytes at offset in the page, filled with
+// value, in a new transaction, which is committed if commit is set and
+// left active otherwise.
+//--------------------------------------------------------------------
+
+static Status ChangeLogged(BufMgr* bufMgr, PageID pid, int offset, int length, char value, bool commit, int& txnId)
+{
+	char before[MINIBASE_PAGESIZE];
+	PageGuard guard;
+
+	Status status = bufMgr->BeginTransaction(txnId);
+
+	if (OK == status)
+	{
+		status = bufMgr->PinPage(pid, guard);
+	}
+
+	if (OK == status)
+	{
+		memcpy(before, (char*)guard.GetPage() + offset, length);
+		memset((char*)guard.GetPage() + offset, value, length);
+		status = bufMgr->LogUpdate(txnId, guard, offset, length, before);
+	}
+
+	if (OK == status)
+	{
+		status = guard.Release();
+	}
+
+	if (OK == status && commit)
+	{
+		status = bufMgr->CommitTransaction(txnId);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Check that the page holds length bytes of value at offset.
+//--------------------------------------------------------------------
+
+static bool HoldsBytes(BufMgr* bufMgr, PageID pid, int offset, int length, char value)
+{
+	PageGuard guard;
+	bool holds = (OK == bufMgr->PinPage(pid, guard));
+
+	for (int i = offset; holds && i < offset + length; i++)
+	{
+		holds = (value == ((char*)guard.GetPage())[i]);
+	}
+
+	return holds;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::GroupCommit
+//
+// First a crash is staged: a transaction commits a change, another
+// one changes a page that is then written back before it commits, and
+// a third is aborted. The database pages and the log are copied as
+// they are on disk, the pool is destroyed, and the copies are put back
+// as if the machine had gone down at that point. Enabling the log on
+// a new pool must redo the committed change and undo the others.
+//
+// Then threads commit small transactions of four pages as fast as they
+// can, each on pages of its own. Forcing the pages at commit takes four
+// page writes and a sync per commit; with the log, commits append
+// their records and wait for the log, and those that arrive while the
+// log is being synced share the next sync.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::GroupCommit()
+{
+	const int numOfPages = 64;
+	const int numOfCommits = 400;
+	const int poolSize = 128;
+	const char* logFile = "BMBENCH.log";
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfPages);
+	int txnId = 0;
+
+	unlink(logFile);
+	BufMgr* bufMgr = new BufMgr(poolSize);
+
+	if (OK == status)
+	{
+		status = bufMgr->EnableLog(logFile, 100);
+	}
+
+	for (int i = 0; OK == status && i < 3; i++)
+	{
+		status = ChangeLogged(bufMgr, firstPid + i, 100, 50, 0, true, txnId);
+	}
+
+	// Committed, left in the pool
+	if (OK == status)
+	{
+		status = ChangeLogged(bufMgr, firstPid, 100, 50, 'c', true, txnId);
+	}
+
+	// Active, and written back
+	if (OK == status)
+	{
+		status = ChangeLogged(bufMgr, firstPid + 1, 100, 50, 'u', false, txnId);
+	}
+
+	if (OK == status)
+	{
+		status = bufMgr->FlushPage(firstPid + 1);
+	}
+
+	// Rolled back
+	if (OK == status)
+	{
+		status = ChangeLogged(bufMgr, firstPid + 2, 100, 50, 'a', false, txnId);
+	}
+
+	if (OK == status)
+	{
+		status = bufMgr->AbortTransaction(txnId);
+	}
+
+	bool recovered = (OK == status && HoldsBytes(bufMgr, firstPid + 2, 100, 50, 0));
+
+	// Take the crash image
+	Page* pages = new Page[3];
+	char* log = new char[LOG_BUFFER_SIZE];
+	int logSize = 0;
+
+	for (int i = 0; OK == status && i < 3; i++)
+	{
+		status = MINIBASE_DB->ReadPage(firstPid + i, &pages[i]);
+	}
+
+	if (OK == status)
+	{
+		int fd = open(logFile, O_RDONLY);
+		logSize = (fd >= 0) ? read(fd, log, LOG_BUFFER_SIZE) : -1;
+		status = (logSize > 0) ? OK : FAIL;
+		close(fd);
+	}
+
+	delete bufMgr;
+
+	for (int i = 0; OK == status && i < 3; i++)
+	{
+		status = MINIBASE_DB->WritePage(firstPid + i, &pages[i]);
+	}
+
+	if (OK == status)
+	{
+		int fd = open(logFile, O_WRONLY | O_TRUNC);
+		status = (fd >= 0 && write(fd, log, logSize) == logSize) ? OK : FAIL;
+		close(fd);
+	}
+
+	delete[] pages;
+	delete[] log;
+
+	bufMgr = new BufMgr(poolSize);
+
+	if (OK == status)
+	{
+		status = bufMgr->EnableLog(logFile, 100);
+	}
+
+	recovered &= (OK == status);
+	recovered &= HoldsBytes(bufMgr, firstPid, 100, 50, 'c');
+	recovered &= HoldsBytes(bufMgr, firstPid + 1, 100, 50, 0);
+	recovered &= HoldsBytes(bufMgr, firstPid + 2, 100, 50, 0);
+
+	delete bufMgr;
+
+	cout << "\n  Recovery after a staged crash: " << (recovered ? "ok" : "FAILED") << endl;
+
+	if (OK == status && !recovered)
+	{
+		status = FAIL;
+	}
+
+	cout << "\n  " << numOfCommits << " commits per thread (commits/s):\n";
+	cout << "    threads    force page   log     commits per sync\n";
+
+	for (int numOfThreads = 1; OK == status && numOfThreads <= 8; numOfThreads *= 2)
+	{
+		double rate[2] = { 0, 0 };
+		double commitsPerSync = 0;
+
+		for (int useLog = 0; OK == status && useLog <= 1; useLog++)
+		{
+			unlink(logFile);
+			bufMgr = new BufMgr(poolSize);
+			bufMgr->SetReadAhead(0);
+
+			if (useLog)
+			{
+				status = bufMgr->EnableLog(logFile, 1000);
+			}
+
+			CommitWorker workers[8];
+			pthread_t threads[8];
+			double start = NowInNanoseconds();
+
+			for (int i = 0; OK == status && i < numOfThreads; i++)
+			{
+				workers[i].bufMgr = bufMgr;
+				workers[i].firstPid = firstPid + i * numOfPages / numOfThreads;
+				workers[i].numOfPages = numOfPages / numOfThreads;
+				workers[i].numOfCommits = numOfCommits;
+				workers[i].useLog = useLog;
+				workers[i].seed = 1000 + i;
+
+				pthread_create(&threads[i], NULL, RunCommitWorker, &workers[i]);
+			}
+
+			for (int i = 0; OK == status && i < numOfThreads; i++)
+			{
+				pthread_join(threads[i], NULL);
+			}
+
+			double elapsed = NowInNanoseconds() - start;
+
+			for (int i = 0; OK == status && i < numOfThreads; i++)
+			{
+				status = workers[i].status;
+			}
+
+			if (OK == status)
+			{
+				BufStats stats;
+				bufMgr->GetStats(stats);
+
+				rate[useLog] = numOfThreads * numOfCommits / (elapsed / 1e9);
+				commitsPerSync = (stats.logSyncs > 0) ? (double)stats.commits / stats.logSyncs : 0;
+			}
+
+			delete bufMgr;
+		}
+
+		if (OK == status)
+		{
+			printf("    %-10d %10.0f %8.0f %12.2f\n", numOfThreads, rate[0], rate[1], commitsPerSync);
+		}
+	}
+
+	unlink(logFile);
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Replay a trace against an LRU pool of poolSize frames, pinning the
+// pages empty so that nothing is read or written, with page 0 of the
+// trace at firstPid. Outputs the pool's statistics.
+//--------------------------------------------------------------------
+
+static Status ReplayEmpty(Trace* trace, PageID firstPid, int poolSize, BufStats& stats)
+{
+	Status status = OK;
+	TraceEntry* entries = trace->GetEntries();
+	BufMgr* bufMgr = new BufMgr(poolSize, "LRU");
+	Page* pg;
+
+	bufMgr->SetReadAhead(0);
+
+	for (int i = 0; OK == status && i < trace->GetCount(); i++)
+	{
+		status = bufMgr->PinPage(firstPid + entries[i].page, pg, true);
+
+		if (OK == status)
+		{
+			status = bufMgr->UnpinPage(firstPid + entries[i].page);
+		}
+	}
+
+	bufMgr->GetStats(stats);
+	delete bufMgr;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::MissRatioEstimates
+//
+// Replay a Zipfian and a scan plus lookups trace over 40000 pages
+// against an LRU pool of 4000 frames, and compare the hit ratios the
+// pool estimates from its sampled pins for 2000, 4000, 8000 and 16000
+// frames with those of LRU pools of these sizes. At this size one page
+// in eight is sampled, the most MRCEstimator samples.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::MissRatioEstimates()
+{
+	const int numOfPages = 40000;
+	const int poolSize = 4000;
+	const int numOfAccesses = 1000000;
+
+	Status status = OK;
+	Trace* traces[2];
+
+	traces[0] = Trace::Zipf(numOfPages, numOfAccesses, 0.9, 0, 12345);
+	traces[1] = Trace::ScanPoint(numOfPages, numOfAccesses, 12345);
+
+	for (int t = 0; OK == status && t < 2; t++)
+	{
+		BufStats stats;
+		status = ReplayEmpty(traces[t], 0, poolSize, stats);
+
+		if (OK == status)
+		{
+			cout << "\n  Estimated against actual LRU hit ratio, " << traces[t]->GetName() << " trace ("
+				 << stats.mrcSamples << " of " << stats.GetPins() << " pins sampled):\n";
+			cout << "    frames    estimated    actual\n";
+		}
+
+		for (int i = 0; OK == status && i < MRC_POINTS; i++)
+		{
+			BufStats actual;
+			status = ReplayEmpty(traces[t], 0, stats.mrcSizes[i], actual);
+
+			if (OK == status)
+			{
+				printf("    %-6d    %8.1f%%   %6.1f%%\n", stats.mrcSizes[i], 100 * stats.mrcHitRatios[i],
+					100.0 * (actual.GetPins() - actual.GetMisses()) / actual.GetPins());
+			}
+		}
+	}
+
+	delete traces[0];
+	delete traces[1];
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BMBenchmark::EvictionPriorities
+//
+// A pool of 200 frames holds 100 index pages, looked up at random
+// every other page of a full scan of 1300 data pages through plain
+// PinPage. The scan runs with the index pages given high priority, as
+// by default, and with their priority set to normal, under LRU and
+// Clock. Reported are the misses of the lookups and the time a lookup
+// took on average.
+//--------------------------------------------------------------------
+
+Status BMBenchmark::EvictionPriorities()
+{
+	const int numOfIndexPages = 100;
+	const int numOfDataPages = 1300;
+	const int poolSize = 200;
+	const char* policies[] = { "LRU", "Clock" };
+
+	PageID firstPid;
+	Status status = CreateStampedPages(firstPid, numOfIndexPages + numOfDataPages);
+
+	cout << "\n  Index lookups during a scan of " << numOfDataPages << " pages, "
+		 << numOfIndexPages << " index pages, " << poolSize << " frames:\n";
+	cout << "    policy    index priority    lookup misses    ns per lookup\n";
+
+	for (int p = 0; OK == status && p < 2; p++)
+	{
+		for (int priority = PRIORITY_HIGH; OK == status && priority >= PRIORITY_NORMAL; priority--)
+		{
+			BufMgr* bufMgr = new BufMgr(poolSize, policies[p]);
+			unsigned int seed = 12345;
+			long lookUps = 0;
+			long lookUpMisses = 0;
+			double lookUpTime = 0;
+			Page* pg;
+
+			bufMgr->SetReadAhead(0);
+			status = bufMgr->SetPriority(PAGE_CLASS_INDEX, priority);
+
+			for (int i = 0; OK == status && i < numOfIndexPages; i++)
+			{
+				status = bufMgr->PinPage(firstPid + i, pg, false, PAGE_CLASS_INDEX);
+
+				if (OK == status)
+				{
+					status = bufMgr->UnpinPage(firstPid + i);
+				}
+			}
+
+			for (int i = 0; OK == status && i < numOfDataPages; i++)
+			{
+				PageID pid = firstPid + numOfIndexPages + i;
+
+				status = bufMgr->PinPage(pid, pg, false, PAGE_CLASS_DATA);
+
+				if (OK == status)
+				{
+					status = bufMgr->UnpinPage(pid);
+				}
+
+				if (OK == status && 0 == (i & 1))
+				{
+					BufStats stats;
+					long oldMisses;
+
+					seed = seed * 1103515245 + 12345;
+					pid = firstPid + (seed >> 8) % numOfIndexPages;
+
+					bufMgr->GetStats(stats);
+					oldMisses = stats.misses[PAGE_CLASS_INDEX];
+					double start = NowInNanoseconds();
+
+					status = bufMgr->PinPage(pid, pg, false, PAGE_CLASS_INDEX);
+
+					if (OK == status && *(PageID*)pg != pid)
+					{
+						cerr << "*** Page " << pid << " holds the wrong data\n";
+						status = FAIL;
+					}
+
+					if (OK == status)
+					{
+						status = bufMgr->UnpinPage(pid);
+					}
+
+					lookUpTime += NowInNanoseconds() - start;
+					bufMgr->GetStats(stats);
+					lookUpMisses += stats.misses[PAGE_CLASS_INDEX] - oldMisses;
+					lookUps++;
+				}
+			}
+
+			if (OK == status)
+			{
+				printf("    %-9s %-17s %13ld %16.0f\n", policies[p], (PRIORITY_HIGH == priority) ? "high" : "normal",
+					lookUpMisses, lookUpTime / lookUps);
+			}
+
+			delete bufMgr;
+		}
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfIndexPages + numOfDataPages);
+	}
+
+	return status;
+}
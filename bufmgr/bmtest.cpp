@@ -9,9 +9,14 @@
 #include "../include/bufmgr.h"
 #include "../include/db.h"
 #include "../include/bmtest.h"
+#include "../include/tracebench.h"
 
 using namespace std;
 
+// The replacement policies Test4 and Test5 are run with
+static const char* replacementPolicies[] = { "LRU", "Clock", "LRU-K", "2Q", "ARC" };
+static const int numOfReplacementPolicies = sizeof(replacementPolicies) / sizeof(replacementPolicies[0]);
+
 BMTester::BMTester() : TestDriver( "buftest" )
 {
 
@@ -107,6 +112,47 @@ int BMTester::Test1()
         }
     }
 
+	//
+	// The same through page guards, which unpin on the way out
+	//
+	if ( status == OK )
+		cout << "  - Read it back again through page guards\n";
+
+	for ( pid=firstPid; status == OK && pid < lastPid; ++pid )
+	{
+		PageGuard guard;
+		status = MINIBASE_BM->PinPage( pid, guard );
+		if ( status != OK )
+		{
+			cerr << "*** Could not pin page " << pid << endl;
+		}
+		else
+		{
+			memcpy( &data, (void*)guard.GetPage(), sizeof data );
+			if ( data != pid + 99999 )
+			{
+				status = FAIL;
+				cerr << "*** Read wrong data back from page " << pid << endl;
+			}
+
+			// Hand the pin on; only the last guard unpins
+			PageGuard moved( static_cast<PageGuard&&>( guard ) );
+			if ( guard.IsPinned() || !moved.IsPinned() || moved.GetPageID() != pid )
+			{
+				status = FAIL;
+				cerr << "*** Moving the guard of page " << pid << " did not move the pin\n";
+			}
+			moved.DirtyIt();
+		}
+	}
+
+	if ( status == OK && MINIBASE_BM->GetNumOfUnpinnedFrames() != (unsigned)NUMBUF )
+	{
+		status = FAIL;
+		cerr << "*** Page guards left " << NUMBUF - MINIBASE_BM->GetNumOfUnpinnedFrames()
+			 << " pages pinned\n";
+	}
+
     if ( status == OK ) 
 		cout << "  - Free the pages again\n";
 
@@ -207,7 +253,58 @@ int BMTester::Test2()
         }
     }
 
+    if ( status == OK )
+    {
+        cout << "  - Try to allocate a new page in a pool with no more room\n";
 
+        // In a buffer manager of its own, so that the pool does not
+        // outlive the test
+        MINIBASE_BM->FlushAllPages();
+        BufMgr* sharedBufMgr = MINIBASE_BM;
+        MINIBASE_BM = new BufMgr( NUMBUF );
+
+        status = MINIBASE_BM->AddPool( "full", 1 );
+        if ( status == OK )
+            status = MINIBASE_BM->UsePool( "full" );
+
+        // The first page takes the only frame of the pool
+        if ( status == OK )
+        {
+            status = MINIBASE_BM->NewPage( firstPid, pg );
+            if ( status != OK )
+                cerr << "*** Could not allocate a new page in the pool\n";
+        }
+
+        if ( status == OK )
+        {
+            pg = NULL;
+            status = MINIBASE_BM->NewPage( pid, pg );
+            if ( status == OK && pg == NULL )
+                cerr << "*** Allocating a page in a full pool returned OK without a page\n";
+            TestFailure( status, FAIL, "Allocating a page in a full pool" );
+        }
+
+        MINIBASE_BM->UsePool( NULL );
+
+        // The pages of the failed allocation are not bound to the pool,
+        // so they can be allocated again in the main one
+        if ( status == OK )
+        {
+            cout << "  - Allocate a new page after the failure\n";
+            status = MINIBASE_BM->NewPage( pid, pg );
+            if ( status != OK )
+                cerr << "*** Could not allocate a new page after the failure\n";
+            else
+                status = MINIBASE_BM->FreePage( pid );
+        }
+
+        if ( status == OK )
+            status = MINIBASE_BM->FreePage( firstPid );
+
+        MINIBASE_BM->FlushAllPages();
+        delete MINIBASE_BM;
+        MINIBASE_BM = sharedBufMgr;
+    }
 
     if ( status == OK )
         cout << "  Test 2 completed successfully.\n";
@@ -310,6 +407,13 @@ int BMTester::Test3()
 }
 
 int BMTester::Test4()
+{
+	cout << "\n  Test 4 tests relation between buffer size and pinpage request miss/hit:\n";
+
+	return this->RunWithEachPolicy(&BMTester::Test4Workload);
+}
+
+int BMTester::Test4Workload(long& pinRequests, long& pinMisses)
 {	//
 	//  A test on relation between buffer size and pinpage request miss/hit.
 	//
@@ -319,8 +423,6 @@ int BMTester::Test4()
 	int data, times;
 	clock_t initTime, endTime;
 
-	cout << "\n  Test 4 tests relation between buffer size and pinpage request miss/hit:\n";
-
 	// The number of pages will be allocated for this test
 	const int numPages = 200; //change back to 200 
 
@@ -406,6 +508,7 @@ int BMTester::Test4()
     				     
 	// record the end time
 	endTime = clock();
+	MINIBASE_BM->GetStat(pinRequests, pinMisses);
 
     for (int index=0; index < numPages; index++ )
     {
@@ -437,6 +540,13 @@ int BMTester::Test4()
 }
 
 int BMTester::Test5()
+{
+	cout << "\n  Test 5 tests locality\n";
+
+	return this->RunWithEachPolicy(&BMTester::Test5Workload);
+}
+
+int BMTester::Test5Workload(long& pinRequests, long& pinMisses)
 {
 	//
 	//  A test on locality.
@@ -447,8 +557,6 @@ int BMTester::Test5()
 	int data, times;
 	clock_t initTime, endTime;
 
-	cout << "\n  Test 5 tests locality\n";
-
 	// The number of pages will be allocated for this test
 	const int numPages = 400; 
 
@@ -538,6 +646,7 @@ int BMTester::Test5()
     				     
 	// record the end time
 	endTime = clock();
+	MINIBASE_BM->GetStat(pinRequests, pinMisses);
 
     for (int index=0; index < numPages; index++ )
     {
@@ -563,12 +672,449 @@ int BMTester::Test5()
     return true;
 }
 
+/**
+ * Runs workload once for every replacement policy, each time against a
+ * fresh buffer pool of NUMBUF frames that temporarily replaces
+ * MINIBASE_BM, then compares the hit ratios.
+ */
+int BMTester::RunWithEachPolicy(workloadFunction workload)
+{
+	long pinRequests[numOfReplacementPolicies];
+	long pinMisses[numOfReplacementPolicies];
+	int result = true;
+
+	// Write back everything the shared pool holds, so that the private
+	// pools read up to date pages (the space map in particular).
+	MINIBASE_BM->FlushAllPages();
+	BufMgr* sharedBufMgr = MINIBASE_BM;
+
+	for (int i = 0; i < numOfReplacementPolicies; i++)
+	{
+		cout << "  - Replacement policy " << replacementPolicies[i] << endl;
+
+		MINIBASE_BM = new BufMgr(NUMBUF, replacementPolicies[i]);
+
+		// Compare the policies alone, without prefetched pages or a
+		// preference for clean victims
+		MINIBASE_BM->SetReadAhead(0);
+		MINIBASE_BM->SetBackgroundWriter(0);
+
+		result = (this->*workload)(pinRequests[i], pinMisses[i]) && result;
+
+		MINIBASE_BM->FlushAllPages();
+		delete MINIBASE_BM;
+	}
+
+	MINIBASE_BM = sharedBufMgr;
+
+	cout << "  - Hit ratio per replacement policy\n";
+	for (int i = 0; i < numOfReplacementPolicies; i++)
+	{
+		long hits = pinRequests[i] - pinMisses[i];
+		double hitRatio = (pinRequests[i] > 0) ? (100.0 * hits) / pinRequests[i] : 0.0;
+
+		printf("      %-6s %6ld requests %6ld misses   hit ratio %5.1f%%\n",
+			replacementPolicies[i], pinRequests[i], pinMisses[i], hitRatio);
+	}
+
+	return result;
+}
+
 /**
  * Assumptions: Database starts out empty
  */
 int BMTester::Test6()
 {
-	return true;
+	cout << "\n  Test 6 pins runs of consecutive pages:\n";
+
+	minibase_errors.clear_errors();
+
+	int numPages = MINIBASE_BM->GetNumOfUnpinnedFrames() / 2;
+	Page** pages = new Page*[2 * numPages + 1];
+	PageID pid, firstPid;
+	BufStats stats;
+	int data;
+
+	cout << "  - Allocate and pin a run of new pages\n";
+	Status status = MINIBASE_BM->NewRun( firstPid, pages, numPages );
+	if ( status != OK )
+	{
+		cerr << "*** Could not allocate " << numPages << " new pages in the database.\n";
+		delete[] pages;
+		return false;
+	}
+
+	for ( int i = 0; status == OK && i < numPages; i++ )
+	{
+		data = firstPid + i + 99999;
+		memcpy( (void*)pages[i], &data, sizeof (int) );
+		status = MINIBASE_BM->UnpinPage( firstPid + i, true );
+		if ( status != OK )
+			cerr << "*** Could not unpin dirty page " << firstPid + i << endl;
+	}
+
+	if ( status == OK )
+	{
+		cout << "  - Read the run back from disk in one call\n";
+		status = MINIBASE_BM->FlushAllPages();
+
+		// Keep the prefetcher from adding reads of its own
+		MINIBASE_BM->SetReadAhead( 0 );
+		MINIBASE_BM->ResetStat();
+	}
+
+	if ( status == OK )
+	{
+		status = MINIBASE_BM->PinRun( firstPid, numPages, pages, false, PAGE_CLASS_DATA );
+		if ( status != OK )
+			cerr << "*** Could not pin the run of " << numPages << " pages\n";
+	}
+
+	if ( status == OK )
+	{
+		MINIBASE_BM->GetStats( stats );
+		if ( stats.misses[PAGE_CLASS_DATA] != numPages || stats.GetMisses() != numPages )
+		{
+			status = FAIL;
+			cerr << "*** Pinning the run missed " << stats.GetMisses()
+				 << " times instead of " << numPages << endl;
+		}
+		else if ( stats.numOfPinnedFrames != numPages || stats.readLatency.GetCount() != 1 )
+		{
+			status = FAIL;
+			cerr << "*** The run was not read in with a single read\n";
+		}
+	}
+
+	for ( int i = 0; status == OK && i < numPages; i++ )
+	{
+		memcpy( &data, (void*)pages[i], sizeof data );
+		if ( data != firstPid + i + 99999 )
+		{
+			status = FAIL;
+			cerr << "*** Read wrong data back from page " << firstPid + i << endl;
+		}
+	}
+
+	for ( int i = 0; status == OK && i < numPages; i++ )
+	{
+		status = MINIBASE_BM->UnpinPage( firstPid + i );
+	}
+
+	if ( status == OK )
+	{
+		cout << "  - Pin a run with every other page in the buffer\n";
+		status = MINIBASE_BM->FlushAllPages();
+	}
+
+	for ( pid = firstPid; status == OK && pid < firstPid + numPages; pid += 2 )
+	{
+		status = MINIBASE_BM->PinPage( pid, pages[0] );
+		if ( status == OK )
+			status = MINIBASE_BM->UnpinPage( pid );
+	}
+
+	if ( status == OK )
+	{
+		status = MINIBASE_BM->PinRun( firstPid, numPages, pages );
+		if ( status != OK )
+			cerr << "*** Could not pin the run of " << numPages << " pages\n";
+	}
+
+	for ( int i = 0; status == OK && i < numPages; i++ )
+	{
+		memcpy( &data, (void*)pages[i], sizeof data );
+		if ( data != firstPid + i + 99999 )
+		{
+			status = FAIL;
+			cerr << "*** Read wrong data back from page " << firstPid + i << endl;
+		}
+	}
+
+	for ( int i = 0; status == OK && i < numPages; i++ )
+	{
+		status = MINIBASE_BM->UnpinPage( firstPid + i );
+	}
+
+	if ( status == OK )
+	{
+		cout << "  - Pin a run of pages of an unknown class\n";
+		status = MINIBASE_BM->FlushAllPages();
+		MINIBASE_BM->ResetStat();
+	}
+
+	if ( status == OK )
+	{
+		status = MINIBASE_BM->PinRun( firstPid, numPages, pages, false, NUM_OF_PAGE_CLASSES + 1000 );
+		if ( status != OK )
+			cerr << "*** Could not pin the run of " << numPages << " pages\n";
+	}
+
+	if ( status == OK )
+	{
+		MINIBASE_BM->GetStats( stats );
+		if ( stats.pins[PAGE_CLASS_OTHER] != numPages || stats.misses[PAGE_CLASS_OTHER] != numPages
+			 || stats.GetPins() != numPages )
+		{
+			status = FAIL;
+			cerr << "*** The run was not counted as pins of other pages\n";
+		}
+	}
+
+	for ( int i = 0; status == OK && i < numPages; i++ )
+	{
+		status = MINIBASE_BM->UnpinPage( firstPid + i );
+	}
+
+	if ( status == OK )
+	{
+		cout << "  - Try to pin a run longer than there are frames\n";
+		status = MINIBASE_BM->PinRun( firstPid, 2 * numPages + 1, pages, true );
+		TestFailure( status, FAIL, "Pinning too long a run" );
+	}
+
+	if ( status == OK && MINIBASE_BM->GetNumOfUnpinnedFrames() != (unsigned)NUMBUF )
+	{
+		status = FAIL;
+		cerr << "*** The failed run left pages pinned\n";
+	}
+
+	for ( pid = firstPid; pid < firstPid + numPages; ++pid )
+	{
+		Status freeStatus = MINIBASE_BM->FreePage( pid );
+		if ( status == OK && freeStatus != OK )
+		{
+			status = freeStatus;
+			cerr << "*** Error freeing page " << pid << endl;
+		}
+	}
+
+	MINIBASE_BM->SetReadAhead( BUF_READ_AHEAD_PAGES );
+	delete[] pages;
+
+	if ( status == OK )
+		cout << "  Test 6 completed successfully.\n";
+
+	return status == OK;
+}
+
+
+// Fill a page as Test7 compresses it: kind 0 is random bytes, 1 .. 4
+// repeat a random period of kind * kind + kind bytes, 5 alternates
+// runs of random bytes with copies of earlier stretches of the page,
+// 6 has random bytes in its first half and zeros in the second.
+static void FillTestPage( char* page, int kind, unsigned int& seed )
+{
+	int period = kind * kind + kind;
+
+	memset( page, 0, MINIBASE_PAGESIZE );
+
+	for ( int i = 0; i < MINIBASE_PAGESIZE; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+
+		if ( 0 == kind || ( 6 == kind && i < MINIBASE_PAGESIZE / 2 ) )
+			page[i] = (char)( seed >> 16 );
+		else if ( kind <= 4 )
+			page[i] = ( i < period ) ? (char)( seed >> 16 ) : page[i - period];
+	}
+
+	for ( int i = 0; 5 == kind && i < MINIBASE_PAGESIZE; )
+	{
+		seed = seed * 1103515245 + 12345;
+		int literals = 1 + ( seed >> 8 ) % 300;
+		seed = seed * 1103515245 + 12345;
+		int copied = 4 + ( seed >> 8 ) % 700;
+
+		for ( int j = 0; j < literals && i < MINIBASE_PAGESIZE; j++, i++ )
+		{
+			seed = seed * 1103515245 + 12345;
+			page[i] = (char)( seed >> 16 );
+		}
+
+		// From anywhere before, so that the copy may overlap itself
+		seed = seed * 1103515245 + 12345;
+		int from = ( seed >> 8 ) % i;
+
+		for ( int j = 0; j < copied && i < MINIBASE_PAGESIZE; j++, i++ )
+			page[i] = page[from + j];
+	}
+}
+
+
+int BMTester::Test7()
+{
+	cout << "\n  Test 7 compresses and decompresses pages for the compressed tier:\n";
+
+	const char* kinds[] = { "random bytes", "a period of 2 bytes", "a period of 6 bytes",
+		"a period of 12 bytes", "a period of 20 bytes", "literals and matches", "half random, half zeros" };
+	const int numOfKinds = sizeof(kinds) / sizeof(kinds[0]);
+
+	char* page = new char[MINIBASE_PAGESIZE];
+	char* decompressed = new char[MINIBASE_PAGESIZE];
+	char* compressed = new char[COMP_CACHE_MAX_SIZE];
+	unsigned int seed = 12345;
+	Status status = OK;
+
+	for ( int kind = 0; status == OK && kind < numOfKinds; kind++ )
+	{
+		cout << "  - Pages of " << kinds[kind] << "\n";
+
+		for ( int n = 0; status == OK && n < 4; n++ )
+		{
+			FillTestPage( page, kind, seed );
+			int size = CompressedCache::Compress( page, compressed );
+
+			if ( 0 == kind )
+			{
+				if ( size != 0 )
+				{
+					status = FAIL;
+					cerr << "*** A page of random bytes was compressed into " << size << " bytes\n";
+				}
+				continue;
+			}
+
+			if ( size <= 0 || size > COMP_CACHE_MAX_SIZE )
+			{
+				status = FAIL;
+				cerr << "*** Could not compress a page of " << kinds[kind] << endl;
+			}
+			else if ( !CompressedCache::Decompress( compressed, size, decompressed )
+					  || memcmp( page, decompressed, MINIBASE_PAGESIZE ) != 0 )
+			{
+				status = FAIL;
+				cerr << "*** A page of " << kinds[kind] << " did not decompress to itself\n";
+			}
+
+			// Any prefix of the compressed page must be rejected
+			for ( int cut = 0; status == OK && cut < size; cut++ )
+			{
+				if ( CompressedCache::Decompress( compressed, cut, decompressed ) )
+				{
+					status = FAIL;
+					cerr << "*** The first " << cut << " of " << size << " compressed bytes"
+						 << " decompressed into a page\n";
+				}
+			}
+		}
+	}
+
+	delete[] page;
+	delete[] decompressed;
+	delete[] compressed;
+
+	if ( status == OK )
+		cout << "  Test 7 completed successfully.\n";
+
+	return status == OK;
+}
+
+
+// The misses of OPT over the trace, the slow way: on a miss with a full
+// pool, look ahead for the next access of each resident page, and evict
+// the one accessed furthest in the future, or never again.
+static long BruteForceOPT( Trace* trace, int poolSize )
+{
+	TraceEntry* entries = trace->GetEntries();
+	int count = trace->GetCount();
+	int* resident = new int[poolSize];
+	int numOfResident = 0;
+	long misses = 0;
+
+	for ( int i = 0; i < count; i++ )
+	{
+		int page = entries[i].page;
+		int r = 0;
+
+		while ( r < numOfResident && resident[r] != page )
+			r++;
+
+		if ( r < numOfResident )
+			continue;
+
+		misses++;
+
+		if ( numOfResident < poolSize )
+		{
+			resident[numOfResident++] = page;
+			continue;
+		}
+
+		int victim = 0;
+		int furthest = -1;
+
+		for ( r = 0; r < numOfResident; r++ )
+		{
+			int next = i + 1;
+
+			while ( next < count && entries[next].page != resident[r] )
+				next++;
+
+			if ( next > furthest )
+			{
+				furthest = next;
+				victim = r;
+			}
+		}
+
+		resident[victim] = page;
+	}
+
+	delete[] resident;
+
+	return misses;
+}
+
+
+int BMTester::Test8()
+{
+	cout << "\n  Test 8 checks the OPT simulation of minibase-bufmgr-trace:\n";
+
+	const int numOfTraces = 40;
+	const int count = 400;
+	unsigned int seed = 12345;
+	Status status = OK;
+
+	cout << "  - Compare it with a brute force OPT on " << numOfTraces << " random traces\n";
+
+	for ( int t = 0; status == OK && t < numOfTraces; t++ )
+	{
+		// From 1 to 20 pages, half of the accesses to the first quarter
+		Trace trace( "random" );
+		int numOfPages = 1 + t % 20;
+		int numOfHotPages = ( numOfPages + 3 ) / 4;
+
+		for ( int i = 0; i < count; i++ )
+		{
+			seed = seed * 1103515245 + 12345;
+			int range = ( ( seed >> 4 ) & 1 ) ? numOfHotPages : numOfPages;
+			trace.Add( ( seed >> 8 ) % range, false, PAGE_CLASS_DATA );
+		}
+
+		int* nextUses = new int[count];
+		TraceBenchmark::GetNextUses( &trace, nextUses );
+
+		for ( int poolSize = 1; status == OK && poolSize <= numOfPages + 1; poolSize++ )
+		{
+			long misses = TraceBenchmark::SimulateOPT( &trace, nextUses, poolSize );
+			long expected = BruteForceOPT( &trace, poolSize );
+
+			if ( misses != expected )
+			{
+				status = FAIL;
+				cerr << "*** OPT missed " << misses << " times instead of " << expected
+					 << " over " << numOfPages << " pages with " << poolSize << " frames\n";
+			}
+		}
+
+		delete[] nextUses;
+	}
+
+	if ( status == OK )
+		cout << "  Test 8 completed successfully.\n";
+
+	return status == OK;
 }
 
 
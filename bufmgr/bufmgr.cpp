@@ -1,23 +1,153 @@
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "../include/bufmgr.h"
 #include "../include/frame.h"
-#include "../include/lru.h"
+#include "../include/replacer.h"
+#include "../include/hash.h"
 #include "../include/db.h"
 
+// DB::AllocatePage and DB::DeallocatePage update the space map without
+// any latching of their own, so they are serialized here.
+static pthread_mutex_t spaceMapLatch = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* pageClassNames[NUM_OF_PAGE_CLASSES] =
+	{ "Other", "Data", "Directory", "Index", "Leaf", "Space Map" };
+
+// The eviction priority of each page class until SetPriority: the few,
+// much used pages that lead to the others are kept longer
+static const int defaultPriorities[NUM_OF_PAGE_CLASSES] =
+	{ PRIORITY_NORMAL, PRIORITY_NORMAL, PRIORITY_HIGH, PRIORITY_HIGH, PRIORITY_NORMAL, PRIORITY_HIGH };
+
+static long NowInNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+// Order page ids, for qsort
+static int ComparePageIDs(const void* pid1, const void* pid2)
+{
+	return (*(PageID*)pid1 > *(PageID*)pid2) - (*(PageID*)pid1 < *(PageID*)pid2);
+}
+
 //--------------------------------------------------------------------
 // Constructor for BufMgr
 //
-// Input   : bufSize  - number of pages in the this buffer manager
+// Input   : bufSize           - number of pages in the this buffer
+//                                 manager
+//            replacementPolicy - (optional) name of the replacement
+//                                 policy, see Replacer::Create. LRU
+//                                 if NULL or unknown.
 // Output  : None
 // PostCond: All frames are empty.
 //--------------------------------------------------------------------
 
-BufMgr::BufMgr(int bufSize)
+BufMgr::BufMgr(int bufSize, const char* replacementPolicy)
 {
 	this->numOfBuf = bufSize;
-	this->frames = new Frame[bufSize];
+	this->maxNumOfBuf = BUF_MAX_GROWTH * bufSize;
+	this->frames = new Frame[this->maxNumOfBuf];
+	this->arena = new BufferArena(bufSize, this->maxNumOfBuf, BUF_HUGE_PAGES);
+	this->freeFrames = new IndexLists(this->maxNumOfBuf, 1);
+	this->frameCounters.numOfValid = 0;
+	this->frameCounters.numOfPinned = 0;
+	this->frameCounters.numOfDirty = 0;
+
+	for (int i = 0; i < this->maxNumOfBuf; i++)
+	{
+		this->frames[i].SetPage(this->arena->GetPage(i));
+		this->frames[i].SetCounters(&this->frameCounters);
+	}
+
+	for (int i = 0; i < this->numOfBuf; i++)
+	{
+		this->freeFrames->PushBack(FREE_FRAMES, i);
+	}
+
+	this->replacer = Replacer::Create(replacementPolicy, this->numOfBuf, &this->frames);
+	if (NULL == this->replacer)
+	{
+		cerr << "Unknown replacement policy " << replacementPolicy << ", using LRU" << endl;
+		this->replacer = Replacer::Create(NULL, this->numOfBuf, &this->frames);
+	}
+	this->latchFreeHooks = this->replacer->HasLatchFreeHooks();
+
+	this->partitions = new Partition[BUF_PARTITIONS];
+	for (int i = 0; i < BUF_PARTITIONS; i++)
+	{
+		pthread_mutex_init(&this->partitions[i].latch, NULL);
+		this->partitions[i].pageTable = new HashTable(this->numOfBuf / BUF_PARTITIONS + 1);
+	}
+
+	this->ioLatches = new IOLatch[BUF_IO_LATCHES];
+	for (int i = 0; i < BUF_IO_LATCHES; i++)
+	{
+		pthread_mutex_init(&this->ioLatches[i].latch, NULL);
+		pthread_cond_init(&this->ioLatches[i].done, NULL);
+	}
+
+	pthread_mutex_init(&this->replacerLatch, NULL);
+	pthread_mutex_init(&this->resizeLatch, NULL);
+
+	this->prefetcherRunning = false;
+	this->prefetcherStop = false;
+	pthread_mutex_init(&this->prefetchLatch, NULL);
+	pthread_cond_init(&this->prefetchQueued, NULL);
+	this->prefetchHead = 0;
+	this->prefetchCount = 0;
+	this->warmUpPids = NULL;
+	this->warmUpCount = 0;
+	this->warmUpNext = 0;
+	this->warmUpEvictions = 0;
+	this->warmUpFile = NULL;
+
+	this->lastReadPid = INVALID_PAGE;
+	this->sequentialReads = 0;
+	this->readAheadEnd = INVALID_PAGE;
+	this->SetReadAhead(BUF_READ_AHEAD_PAGES);
+
+	this->writerRunning = false;
+	this->writerStop = false;
+	pthread_mutex_init(&this->writerLatch, NULL);
+	pthread_cond_init(&this->writerWake, NULL);
+	this->SetBackgroundWriter(BUF_CLEAN_PERCENT);
+
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		this->priorities[i] = defaultPriorities[i];
+	}
+
+	this->pinStart = new long[this->maxNumOfBuf];
+	this->mrc = new MRCEstimator(bufSize);
+	this->pageLSNs = new LSN[this->maxNumOfBuf];
+	this->recLSNs = new LSN[this->maxNumOfBuf];
+	for (int i = 0; i < this->maxNumOfBuf; i++)
+	{
+		this->pinStart[i] = 0;
+		this->pageLSNs[i] = INVALID_LSN;
+		this->recLSNs[i] = INVALID_LSN;
+	}
+
+	this->compressedCache = NULL;
+	this->mapping = NULL;
+	this->ioEngine = NULL;
+	this->log = NULL;
+	this->checkpointing = false;
+	this->recorder = NULL;
 
-	this->replacer = new LRU(this->numOfBuf, &this->frames);
+	this->numOfPools = 0;
+	this->allocationPool = INVALID_FRAME;
+	this->poolOfPage = new HashTable(this->numOfBuf);
+	pthread_rwlock_init(&this->poolLatch, NULL);
 
 	this->ResetStat();
 }
@@ -32,10 +162,89 @@ BufMgr::BufMgr(int bufSize)
 
 BufMgr::~BufMgr()
 {
+	if (NULL != this->warmUpFile)
+	{
+		this->SaveWarmUpList();
+	}
+
+	// Stop the I/O thread before the frames go away
+	pthread_mutex_lock(&this->prefetchLatch);
+	this->prefetcherStop = true;
+	pthread_cond_broadcast(&this->prefetchQueued);
+	pthread_mutex_unlock(&this->prefetchLatch);
+
+	if (this->prefetcherRunning)
+	{
+		pthread_join(this->prefetcher, NULL);
+	}
+
+	pthread_mutex_destroy(&this->prefetchLatch);
+	pthread_cond_destroy(&this->prefetchQueued);
+	delete[] this->warmUpPids;
+	delete[] this->warmUpFile;
+
+	pthread_mutex_lock(&this->writerLatch);
+	this->writerStop = true;
+	pthread_cond_broadcast(&this->writerWake);
+	pthread_mutex_unlock(&this->writerLatch);
+
+	if (this->writerRunning)
+	{
+		pthread_join(this->writer, NULL);
+	}
+
+	pthread_mutex_destroy(&this->writerLatch);
+	pthread_cond_destroy(&this->writerWake);
+
+	// The frames below and those of the named pools write their dirty
+	// pages back as they go, so everything logged goes out first
+	if (NULL != this->log)
+	{
+		this->log->Flush(this->log->GetEndLSN());
+	}
+
 	delete this->replacer;
 
+	for (int i = 0; i < BUF_PARTITIONS; i++)
+	{
+		pthread_mutex_destroy(&this->partitions[i].latch);
+		delete this->partitions[i].pageTable;
+	}
+	delete[] this->partitions;
+
+	for (int i = 0; i < BUF_IO_LATCHES; i++)
+	{
+		pthread_mutex_destroy(&this->ioLatches[i].latch);
+		pthread_cond_destroy(&this->ioLatches[i].done);
+	}
+	delete[] this->ioLatches;
+
+	pthread_mutex_destroy(&this->replacerLatch);
+	pthread_mutex_destroy(&this->resizeLatch);
+
+	for (int i = 0; i < this->numOfPools; i++)
+	{
+		this->pools[i]->log = NULL;
+		this->pools[i]->recorder = NULL;
+		delete this->pools[i];
+		delete[] this->poolNames[i];
+	}
+	delete this->poolOfPage;
+	pthread_rwlock_destroy(&this->poolLatch);
+
 	// Frame destructor is responsible for flushing the frame to disk if it was dirty.
 	delete[] this->frames;
+	delete this->arena;
+	delete this->freeFrames;
+	delete[] this->pinStart;
+	delete this->mrc;
+	delete[] this->pageLSNs;
+	delete[] this->recLSNs;
+	delete this->compressedCache;
+	delete this->mapping;
+	delete this->ioEngine;
+	delete this->log;
+	delete this->recorder;
 }
 
 //--------------------------------------------------------------------
@@ -61,41 +270,186 @@ BufMgr::~BufMgr()
 
 Status BufMgr::PinPage(PageID pid, Page*& page, bool isEmpty)
 {
+	return this->PinPage(pid, page, isEmpty, PAGE_CLASS_OTHER);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::PinPage
+//
+// As above, with pageClass telling what kind of page is pinned, one
+// of PageClass. The pin is counted under that class in the statistics.
+// Sequential, use-once readers pass a BufferRing as ring: a miss then
+// reuses a frame of the ring rather than a victim from the whole pool,
+// and does not trigger read-ahead, which would bring pages into frames
+// outside the ring.
+//--------------------------------------------------------------------
+
+Status BufMgr::PinPage(PageID pid, Page*& page, bool isEmpty, int pageClass, BufferRing* ring)
+{
+	BufMgr* pool;
+	int frameId;
+
+	return this->PinFrame(pid, isEmpty, pageClass, ring, page, pool, frameId);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::PinPage
+//
+// As above, with the pin taken into guard, which unpins the page when
+// it is released or destroyed. A pin the guard held before is released
+// first. On failure the guard is left empty.
+//--------------------------------------------------------------------
+
+Status BufMgr::PinPage(PageID pid, PageGuard& guard, bool isEmpty, int pageClass, BufferRing* ring)
+{
+	Page* page;
+	BufMgr* pool;
+	int frameId;
+
+	guard.Release();
+
+	Status status = this->PinFrame(pid, isEmpty, pageClass, ring, page, pool, frameId);
+
+	if (OK == status)
+	{
+		guard.bufMgr = pool;
+		guard.pid = pid;
+		guard.frameId = frameId;
+		guard.page = page;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::PinFrame
+//
+// Input    : pid, isEmpty, pageClass, ring - as for PinPage
+// Output   : page    - the page in the buffer pool (NULL if fail)
+//            pool    - the pool the page was pinned in
+//            frameId - the frame the page is in; INVALID_FRAME in
+//                      mapped mode
+// Purpose  : Pin the page, see PinPage.
+// Return   : OK if operation is successful.  FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::PinFrame(PageID pid, bool isEmpty, int pageClass, BufferRing* ring, Page*& page, BufMgr*& pool, int& frameId)
+{
+	pool = this->PoolOf(pid);
+	if (pool != this)
+	{
+		return pool->PinFrame(pid, isEmpty, pageClass, ring, page, pool, frameId);
+	}
+
+	frameId = INVALID_FRAME;
+
+	if (pageClass < 0 || pageClass >= NUM_OF_PAGE_CLASSES)
+	{
+		pageClass = PAGE_CLASS_OTHER;
+	}
+
+	TraceRecorder* recorder = __atomic_load_n(&this->recorder, __ATOMIC_ACQUIRE);
+	if (NULL != recorder)
+	{
+		recorder->Record(TRACE_PIN, pid, pageClass, false);
+	}
+
 	// Collect stats
-	totalCall++;
+	long numOfPins = __atomic_add_fetch(&this->stats.pins[pageClass], 1, __ATOMIC_RELAXED);
+
+	// In mapped mode the page is always there
+	if (NULL != this->mapping)
+	{
+		return this->mapping->Pin(pid, page);
+	}
+
+	if (this->mrc->IsSampled(pid))
+	{
+		this->mrc->Access(pid);
+	}
 
 	Status status = OK;
 	page = NULL;
 
-	// Check if the buffer contains the page "pid"
-	int frameId = this->FindFrame(pid);
-
-	if (INVALID_FRAME == frameId)
+	while (OK == status && INVALID_FRAME == frameId)
 	{
-		totalMiss++;
-
-		// Find a victim
-		frameId = replacer->PickVictim();
+		Partition* partition = this->PartitionOf(pid);
 
-		if (INVALID_FRAME == frameId)
+		// Check if the buffer contains the page "pid". The pin is taken
+		// under the partition latch, so the frame cannot be reused.
+		pthread_mutex_lock(&partition->latch);
+		frameId = partition->pageTable->LookUp(pid);
+		if (INVALID_FRAME != frameId)
 		{
-			status = FAIL;
+			this->frames[frameId].Pin();
+
+			if (this->latchFreeHooks)
+			{
+				if (PAGE_CLASS_OTHER != pageClass)
+				{
+					this->replacer->SetPriority(frameId, __atomic_load_n(&this->priorities[pageClass], __ATOMIC_RELAXED));
+				}
+				this->replacer->OnPin(frameId);
+			}
 		}
+		pthread_mutex_unlock(&partition->latch);
 
-		if (OK == status)
+		if (INVALID_FRAME != frameId)
+		{
+			if (!this->latchFreeHooks)
+			{
+				pthread_mutex_lock(&this->replacerLatch);
+				if (PAGE_CLASS_OTHER != pageClass)
+				{
+					this->replacer->SetPriority(frameId, __atomic_load_n(&this->priorities[pageClass], __ATOMIC_RELAXED));
+				}
+				this->replacer->OnPin(frameId);
+				pthread_mutex_unlock(&this->replacerLatch);
+			}
+
+			// Another thread may still be reading the page in
+			this->WaitForIO(frameId);
+
+			if (!this->frames[frameId].HasPageID(pid))
+			{
+				// ... and the read failed
+				this->ReleaseFrame(frameId);
+				frameId = INVALID_FRAME;
+				status = FAIL;
+			}
+			else if (this->frames[frameId].TakePrefetched() && NULL == ring)
+			{
+				// The prefetch paid off, keep reading ahead
+				this->ReadAhead(pid);
+			}
+		}
+		else
 		{
-			Frame& victimFrame = this->frames[frameId];
-			this->FlushFrame(frameId);
+			// Leaves frameId invalid if another thread loaded the page
+			// first, in which case the lookup is repeated
+			status = this->LoadPage(pid, isEmpty, false, ring, frameId);
 
-			if (OK == status)
+			if (OK == status && INVALID_FRAME != frameId)
 			{
-				if (isEmpty)
+				// Frames are loaded with normal priority; the replacer
+				// reads it when the frame is unpinned
+				int priority = __atomic_load_n(&this->priorities[pageClass], __ATOMIC_RELAXED);
+				if (PAGE_CLASS_OTHER != pageClass && PRIORITY_NORMAL != priority)
 				{
-					victimFrame.SetPageID(pid);
+					pthread_mutex_lock(&this->replacerLatch);
+					this->replacer->SetPriority(frameId, priority);
+					pthread_mutex_unlock(&this->replacerLatch);
 				}
-				else
+
+				// Collect stats
+				__atomic_add_fetch(&this->stats.misses[pageClass], 1, __ATOMIC_RELAXED);
+
+				if (!isEmpty && NULL == ring)
 				{
-					status = victimFrame.Read(pid);
+					this->ReadAhead(pid);
 				}
 			}
 		}
@@ -103,11 +457,14 @@ Status BufMgr::PinPage(PageID pid, Page*& page, bool isEmpty)
 
 	if (OK == status)
 	{
-		// Increment the pin count
-		this->frames[frameId].Pin();
-
 		// Set the return value for page
 		page = this->frames[frameId].GetPage();
+
+		// Time how long the frame stays pinned, for a sample of pins
+		if (0 == (numOfPins & (BUF_PIN_SAMPLE - 1)) && 0 == __atomic_load_n(&this->pinStart[frameId], __ATOMIC_RELAXED))
+		{
+			__atomic_store_n(&this->pinStart[frameId], NowInNanoseconds(), __ATOMIC_RELAXED);
+		}
 	}
 
 	return status;
@@ -131,27 +488,90 @@ Status BufMgr::PinPage(PageID pid, Page*& page, bool isEmpty)
 
 Status BufMgr::UnpinPage(PageID pid, bool dirty)
 {
+	BufMgr* pool = this->PoolOf(pid);
+	if (pool != this)
+	{
+		return pool->UnpinPage(pid, dirty);
+	}
+
+	// The mapping is written back by the operating system, or Flush
+	if (NULL != this->mapping)
+	{
+		return this->mapping->Unpin(pid);
+	}
+
+	return this->UnpinFrame(this->FindFrame(pid), pid, dirty);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::UnpinFrame
+//
+// Input    : frameId - the frame pid was pinned in, as found by PinFrame
+//            pid     - the page
+//            dirty   - whether the page was changed
+// Output   : None
+// Purpose  : Unpin the page without looking it up: the pin keeps the
+//            frame from being reused, so that it still holds pid.
+// Return   : OK if operation is successful.  FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::UnpinFrame(int frameId, PageID pid, bool dirty)
+{
+	TraceRecorder* recorder = __atomic_load_n(&this->recorder, __ATOMIC_ACQUIRE);
+	if (NULL != recorder)
+	{
+		recorder->Record(TRACE_UNPIN, pid, PAGE_CLASS_OTHER, dirty);
+	}
+
+	if (NULL != this->mapping)
+	{
+		return this->mapping->Unpin(pid);
+	}
+
 	Status status = OK;
 
-	int frameId = this->FindFrame(pid);
-	if (INVALID_FRAME == frameId)
+	if (INVALID_FRAME == frameId || frameId >= this->maxNumOfBuf
+		|| !this->frames[frameId].HasPageID(pid) || this->frames[frameId].NotPinned())
 	{
 		status = FAIL;
 	}
 
 	if (OK == status)
 	{
-		this->frames[frameId].Unpin();
-
 		if (dirty)
 		{
-			this->frames[frameId].DirtyIt();
+			this->MarkDirty(frameId, pid);
 		}
+
+		status = this->ReleaseFrame(frameId);
 	}
 
 	return status;
 }
 
+
+//--------------------------------------------------------------------
+// BufMgr::MarkDirty
+//
+// Mark the page in a frame the caller has pinned dirty. This has to
+// happen while the page is still pinned: an unpinned clean page may be
+// evicted without being written.
+//--------------------------------------------------------------------
+
+void BufMgr::MarkDirty(int frameId, PageID pid)
+{
+	if (NULL == this->mapping && INVALID_FRAME != frameId && this->frames[frameId].HasPageID(pid))
+	{
+		this->frames[frameId].DirtyIt();
+
+		if (!__atomic_load_n(&this->writerRunning, __ATOMIC_ACQUIRE))
+		{
+			this->StartWriter();
+		}
+	}
+}
+
 //--------------------------------------------------------------------
 // BufMgr::NewPage
 //
@@ -175,6 +595,38 @@ Status BufMgr::UnpinPage(PageID pid, bool dirty)
 
 Status BufMgr::NewPage (PageID& firstPid, Page*& firstPage, int howMany)
 {
+	PageGuard guard;
+	Status status = this->NewPage(firstPid, guard, howMany);
+
+	// The caller unpins the page by page id
+	firstPage = guard.Detach();
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::NewPage
+//
+// As above, with the first page pinned into guard.
+//--------------------------------------------------------------------
+
+Status BufMgr::NewPage(PageID& firstPid, PageGuard& guard, int howMany)
+{
+	int poolIndex = __atomic_load_n(&this->allocationPool, __ATOMIC_ACQUIRE);
+	if (poolIndex >= 0)
+	{
+		Status status = this->pools[poolIndex]->NewPage(firstPid, guard, howMany);
+
+		// The pages are deallocated again if the pin failed
+		if (OK == status && guard.IsPinned())
+		{
+			this->Route(firstPid, howMany, poolIndex);
+		}
+
+		return status;
+	}
+
 	Status status = OK;
 
 	if (howMany < 1)
@@ -184,16 +636,20 @@ Status BufMgr::NewPage (PageID& firstPid, Page*& firstPage, int howMany)
 
 	if (OK == status)
 	{
+		pthread_mutex_lock(&spaceMapLatch);
 		status = MINIBASE_DB->AllocatePage(firstPid, howMany);
+		pthread_mutex_unlock(&spaceMapLatch);
 	}
 
 	if (OK == status)
 	{
-		status = this->PinPage(firstPid, firstPage, true);
+		status = this->PinPage(firstPid, guard, true);
 
-		if (status != OK)
+		if (OK != status)
 		{
-			status = MINIBASE_DB->DeallocatePage(firstPid, howMany);
+			pthread_mutex_lock(&spaceMapLatch);
+			MINIBASE_DB->DeallocatePage(firstPid, howMany);
+			pthread_mutex_unlock(&spaceMapLatch);
 		}
 	}
 
@@ -201,203 +657,3606 @@ Status BufMgr::NewPage (PageID& firstPid, Page*& firstPage, int howMany)
 }
 
 //--------------------------------------------------------------------
-// BufMgr::FreePage
+// BufMgr::PinRun
 //
-// Input    : pid     - page id of a particular page 
-// Output   : None
-// Purpose  : Free the memory allocated for the page with 
-//            page id = pid  
-// Condition: Either the page is already in the buffer and is pinned
-//            no more than once, or the page is not in the buffer.
-// PostCond : The page is unpinned, and the frame where it resides in
-//            the buffer pool is freed.  Also the page is deallocated
-//            from the database. 
-// Return   : OK if operation is successful.  FAIL otherwise.
-// Note     : You can call MINIBASE_DB->DeallocatePage(pid) to
-//            deallocate a page.
+// Input    : firstPid - page id of the first page of the run
+//            count    - number of consecutive pages to pin
+//            isEmpty  - (optional, default to false) if true indicate
+//                       that the pages to be pinned are empty pages.
+//            pageClass - (optional) the PageClass of the pages
+// Output   : pages - pointers to the count pages in the buffer pool.
+//            (all NULL if fail)
+// Purpose  : Pin the pages firstPid .. firstPid + count - 1, as count
+//            calls to PinPage would. Each stretch of the run that is
+//            not in the buffer is installed in victim frames as a
+//            whole and read in with a single multi-page read.
+// Condition: There are at least as many frames available as there
+//            are pages of the run not in the buffer.
+// PostCond : The pages reside in the buffer and are pinned one more
+//            time each.
+// Return   : OK if operation is successful.  FAIL otherwise, in which
+//            case none of the pages is left pinned by the call.
 //--------------------------------------------------------------------
 
-
-Status BufMgr::FreePage(PageID pid)
+Status BufMgr::PinRun(PageID firstPid, int count, Page** pages, bool isEmpty, int pageClass)
 {
-	Status status = OK;
-
-	int frameId = this->FindFrame(pid);
-	if (INVALID_FRAME != frameId)
+	if (pageClass < 0 || pageClass >= NUM_OF_PAGE_CLASSES)
 	{
-		status = this->frames[frameId].Free();
+		pageClass = PAGE_CLASS_OTHER;
 	}
-	else
+
+	BufMgr* pool = this->PoolOf(firstPid);
+	if (pool != this)
 	{
-		status = MINIBASE_DB->DeallocatePage(pid); // Deallocate the page even if it was not in the buffer
+		return pool->PinRun(firstPid, count, pages, isEmpty, pageClass);
 	}
 
-	return status;
-}
-
-
-//--------------------------------------------------------------------
-// BufMgr::FlushPage
-//
-// Input    : pid  - page id of a particular page 
-// Output   : None
-// Purpose  : Flush the page with the given pid to disk.
-// Condition: The page with page id = pid must be in the buffer,
-//            and is not pinned. pid cannot be INVALID_PAGE.
-// PostCond : The page with page id = pid is written to disk if it's dirty. 
-//            The frame where the page resides is empty.
-// Return   : OK if operation is successful.  FAIL otherwise.
-//--------------------------------------------------------------------
-
+	if (NULL != this->mapping)
+	{
+		return this->PinMappedRun(firstPid, count, pages, pageClass);
+	}
 
-Status BufMgr::FlushPage(PageID pid, bool ignorePinned)
-{
 	Status status = OK;
+	int numOfPinned = 0;
 
-	if (INVALID_PAGE == pid)
+	if (INVALID_PAGE == firstPid || firstPid < 0 || count < 1)
 	{
 		status = FAIL;
 	}
 
-	int frameId = INVALID_FRAME;
-	if (OK == status)
+	int* frameIds = (OK == status) ? new int[count] : NULL;
+	Frame** run = (OK == status) ? new Frame*[count] : NULL;
+
+	while (OK == status && numOfPinned < count)
 	{
-		frameId = this->FindFrame(pid);
+		// Install the pages that are not in the buffer, up to the next
+		// one that is
+		int numOfInstalled = 0;
+		bool installed = true;
 
-		if (INVALID_FRAME == frameId)
+		while (OK == status && installed && numOfPinned + numOfInstalled < count)
 		{
-			status = FAIL;
-		}
-	}
-
-	status = this->FlushFrame(frameId, ignorePinned);
+			PageID pid = firstPid + numOfPinned + numOfInstalled;
+			int frameId = INVALID_FRAME;
 
-	return status;
-}
+			if (INVALID_FRAME == this->FindFrame(pid))
+			{
+				status = this->InstallPage(pid, false, NULL, frameId);
+			}
 
+			// The run is read from disk; a compressed copy would go stale
+			CompressedCache* cache = __atomic_load_n(&this->compressedCache, __ATOMIC_ACQUIRE);
+			if (INVALID_FRAME != frameId && NULL != cache)
+			{
+				cache->Remove(pid);
+			}
+
+			installed = (INVALID_FRAME != frameId);
+
+			if (installed)
+			{
+				frameIds[numOfPinned + numOfInstalled] = frameId;
+				run[numOfInstalled++] = &this->frames[frameId];
+			}
+		}
+
+		if (numOfInstalled > 0)
+		{
+			Status readStatus = status;
+
+			if (OK == readStatus && !isEmpty)
+			{
+				long start = NowInNanoseconds();
+				readStatus = Frame::ReadFrames(run, numOfInstalled, this->GetIOEngine());
+				this->stats.readLatency.Add(NowInNanoseconds() - start);
+			}
+
+			for (int i = 0; i < numOfInstalled; i++)
+			{
+				this->FinishLoad(frameIds[numOfPinned + i], readStatus);
+			}
+
+			if (OK == readStatus)
+			{
+				// Collect stats
+				__atomic_add_fetch(&this->stats.pins[pageClass], numOfInstalled, __ATOMIC_RELAXED);
+				__atomic_add_fetch(&this->stats.misses[pageClass], numOfInstalled, __ATOMIC_RELAXED);
+
+				// Installed with normal priority, as by LoadPage
+				int priority = __atomic_load_n(&this->priorities[pageClass], __ATOMIC_RELAXED);
+				if (PAGE_CLASS_OTHER != pageClass && PRIORITY_NORMAL != priority)
+				{
+					pthread_mutex_lock(&this->replacerLatch);
+					for (int i = 0; i < numOfInstalled; i++)
+					{
+						this->replacer->SetPriority(frameIds[numOfPinned + i], priority);
+					}
+					pthread_mutex_unlock(&this->replacerLatch);
+				}
+
+				TraceRecorder* recorder = __atomic_load_n(&this->recorder, __ATOMIC_ACQUIRE);
+
+				for (int i = 0; i < numOfInstalled; i++, numOfPinned++)
+				{
+					pages[numOfPinned] = this->frames[frameIds[numOfPinned]].GetPage();
+
+					if (NULL != recorder)
+					{
+						recorder->Record(TRACE_PIN, firstPid + numOfPinned, pageClass, false);
+					}
+
+					// Counted in the pins, so sampled as PinFrame would
+					if (this->mrc->IsSampled(firstPid + numOfPinned))
+					{
+						this->mrc->Access(firstPid + numOfPinned);
+					}
+
+					if (!isEmpty)
+					{
+						this->ReadAhead(firstPid + numOfPinned);
+					}
+				}
+			}
+
+			status = readStatus;
+		}
+		else if (OK == status)
+		{
+			// The page is in the buffer, or was brought in meanwhile
+			status = this->PinPage(firstPid + numOfPinned, pages[numOfPinned], isEmpty, pageClass);
+
+			if (OK == status)
+			{
+				numOfPinned++;
+			}
+		}
+	}
+
+	if (OK != status)
+	{
+		for (int i = 0; i < numOfPinned; i++)
+		{
+			this->UnpinPage(firstPid + i);
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			pages[i] = NULL;
+		}
+	}
+
+	delete[] frameIds;
+	delete[] run;
+
+	return status;
+}
+
+//--------------------------------------------------------------------
+// BufMgr::NewRun
+//
+// Input    : howMany - how many pages to allocate.
+// Output   : firstPid - the page id of the first page allocated.
+//            pages    - pointers to the howMany pages in memory.
+// Purpose  : Allocate howMany pages, and pin all of them into the
+//            buffer with PinRun.
+// Condition: howMany > 0 and there are at least howMany frames
+//            available.
+// PostCond : The pages are pinned into the buffer.
+// Return   : OK if operation is successful.  FAIL otherwise, in which
+//            case the pages are deallocated again.
+//--------------------------------------------------------------------
+
+Status BufMgr::NewRun(PageID& firstPid, Page** pages, int howMany)
+{
+	int poolIndex = __atomic_load_n(&this->allocationPool, __ATOMIC_ACQUIRE);
+	if (poolIndex >= 0)
+	{
+		Status status = this->pools[poolIndex]->NewRun(firstPid, pages, howMany);
+
+		if (OK == status)
+		{
+			this->Route(firstPid, howMany, poolIndex);
+		}
+
+		return status;
+	}
+
+	Status status = OK;
+
+	if (howMany < 1)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		pthread_mutex_lock(&spaceMapLatch);
+		status = MINIBASE_DB->AllocatePage(firstPid, howMany);
+		pthread_mutex_unlock(&spaceMapLatch);
+	}
+
+	if (OK == status)
+	{
+		status = this->PinRun(firstPid, howMany, pages, true);
+
+		if (OK != status)
+		{
+			pthread_mutex_lock(&spaceMapLatch);
+			MINIBASE_DB->DeallocatePage(firstPid, howMany);
+			pthread_mutex_unlock(&spaceMapLatch);
+		}
+	}
+
+	return status;
+}
+
+//--------------------------------------------------------------------
+// BufMgr::FreePage
+//
+// Input    : pid     - page id of a particular page 
+// Output   : None
+// Purpose  : Free the memory allocated for the page with 
+//            page id = pid  
+// Condition: Either the page is already in the buffer and is pinned
+//            no more than once, or the page is not in the buffer.
+// PostCond : The page is unpinned, and the frame where it resides in
+//            the buffer pool is freed.  Also the page is deallocated
+//            from the database. 
+// Return   : OK if operation is successful.  FAIL otherwise.
+// Note     : You can call MINIBASE_DB->DeallocatePage(pid) to
+//            deallocate a page.
+//--------------------------------------------------------------------
+
+
+Status BufMgr::FreePage(PageID pid)
+{
+	BufMgr* pool = this->PoolOf(pid);
+	if (pool != this)
+	{
+		Status status = pool->FreePage(pid);
+
+		if (OK == status)
+		{
+			this->Route(pid, 1, INVALID_FRAME);
+		}
+
+		return status;
+	}
+
+	Status status = OK;
+
+	// A mapped page is freed if it is not pinned
+	if (NULL != this->mapping && (!this->mapping->IsValid(pid) || this->mapping->GetPinCount(pid) > 0))
+	{
+		return FAIL;
+	}
+
+	Partition* partition = this->PartitionOf(pid);
+
+	pthread_mutex_lock(&partition->latch);
+	int frameId = partition->pageTable->LookUp(pid);
+
+	// Let a read in progress, or an eviction of the page, finish first
+	while (INVALID_FRAME != frameId && this->frames[frameId].IsIOInProgress())
+	{
+		pthread_mutex_unlock(&partition->latch);
+		this->WaitForIO(frameId);
+		pthread_mutex_lock(&partition->latch);
+		frameId = partition->pageTable->LookUp(pid);
+	}
+
+	if (INVALID_FRAME != frameId)
+	{
+		status = this->frames[frameId].Free();
+
+		if (OK == status)
+		{
+			partition->pageTable->Delete(pid);
+			__atomic_store_n(&this->pinStart[frameId], 0, __ATOMIC_RELAXED);
+			__atomic_store_n(&this->recLSNs[frameId], INVALID_LSN, __ATOMIC_RELEASE);
+
+			pthread_mutex_lock(&this->replacerLatch);
+			this->replacer->OnFree(frameId);
+			this->freeFrames->MoveToBack(FREE_FRAMES, frameId);
+			pthread_mutex_unlock(&this->replacerLatch);
+		}
+	}
+	pthread_mutex_unlock(&partition->latch);
+
+	// Deallocate the page even if it was not in the buffer. This pins the
+	// space map, which may reuse the frame that has just been emptied.
+	if (OK == status)
+	{
+		CompressedCache* cache = __atomic_load_n(&this->compressedCache, __ATOMIC_ACQUIRE);
+		if (NULL != cache)
+		{
+			cache->Remove(pid);
+		}
+
+		pthread_mutex_lock(&spaceMapLatch);
+		status = MINIBASE_DB->DeallocatePage(pid);
+		pthread_mutex_unlock(&spaceMapLatch);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::FlushPage
+//
+// Input    : pid  - page id of a particular page 
+// Output   : None
+// Purpose  : Flush the page with the given pid to disk.
+// Condition: The page with page id = pid must be in the buffer,
+//            and is not pinned. pid cannot be INVALID_PAGE.
+// PostCond : The page with page id = pid is written to disk if it's dirty. 
+//            The frame where the page resides is empty.
+// Return   : OK if operation is successful.  FAIL otherwise.
+//--------------------------------------------------------------------
+
+
+Status BufMgr::FlushPage(PageID pid, bool ignorePinned)
+{
+	BufMgr* pool = this->PoolOf(pid);
+	if (pool != this)
+	{
+		return pool->FlushPage(pid, ignorePinned);
+	}
+
+	Status status = OK;
+
+	if (NULL != this->mapping)
+	{
+		if (this->mapping->IsValid(pid) && this->mapping->GetPinCount(pid) > 0 && !ignorePinned)
+		{
+			return FAIL;
+		}
+
+		return this->mapping->Flush(pid);
+	}
+
+	if (INVALID_PAGE == pid)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		Partition* partition = this->PartitionOf(pid);
+
+		pthread_mutex_lock(&partition->latch);
+		int frameId = partition->pageTable->LookUp(pid);
+
+		if (INVALID_FRAME == frameId)
+		{
+			status = FAIL;
+		}
+
+		if (OK == status)
+		{
+			status = this->FlushFrame(frameId, ignorePinned);
+		}
+		pthread_mutex_unlock(&partition->latch);
+	}
+
+	return status;
+}
+
+
+
+
+//--------------------------------------------------------------------
+// BufMgr::FlushAllPages
+//
+// Input    : None
+// Output   : None
+// Purpose  : Flush all pages in this buffer pool to disk.
+// Condition: All pages in the buffer pool must not be pinned.
+// PostCond : All dirty pages in the buffer pool are written to 
+//            disk (even if some pages are pinned). All frames are empty.
+//            The unpinned dirty pages are written first, sorted by page
+//            id and with runs of consecutive pages coalesced, so that a
+//            large flush turns into sequential I/O.
+// Return   : OK if operation is successful.  FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::FlushAllPages()
+{
+	bool success = true;
+
+	// Keep the list of the pages in use before the pool is emptied. It
+	// is only a hint, so failing to save it does not fail the flush.
+	if (NULL != this->warmUpFile)
+	{
+		this->SaveWarmUpList();
+	}
+
+	// Drop pending prefetches, and let reads already started finish
+	pthread_mutex_lock(&this->prefetchLatch);
+	this->prefetchCount = 0;
+	this->warmUpNext = this->warmUpCount;
+	pthread_mutex_unlock(&this->prefetchLatch);
+
+	// In mapped mode the frames are not used
+	if (NULL != this->mapping)
+	{
+		success &= (0 == this->mapping->GetNumOfPinnedPages());
+		success &= (this->mapping->Flush(0, this->mapping->GetNumOfPages()) == OK);
+	}
+
+	// Claim the unpinned dirty frames and write them back together
+	Frame** dirtyFrames = new Frame*[this->maxNumOfBuf];
+	int numOfDirtyFrames = 0;
+
+	for (int i = 0; i < this->numOfBuf; i++)
+	{
+		if (this->frames[i].IsDirty() && this->ClaimFrame(i))
+		{
+			if (this->frames[i].IsDirty())
+			{
+				dirtyFrames[numOfDirtyFrames++] = &this->frames[i];
+			}
+			else
+			{
+				this->UnclaimFrame(i);
+			}
+		}
+	}
+
+	long start = NowInNanoseconds();
+	int numOfWrites = 0;
+	if (OK == this->ForceLog(dirtyFrames, numOfDirtyFrames))
+	{
+		numOfWrites = Frame::WriteFrames(dirtyFrames, numOfDirtyFrames, this->GetIOEngine());
+	}
+	success &= (numOfWrites == numOfDirtyFrames);
+
+	// Collect stats
+	if (numOfDirtyFrames > 0)
+	{
+		this->stats.writeLatency.Add(NowInNanoseconds() - start);
+	}
+	__atomic_add_fetch(&this->stats.foregroundWrites, numOfWrites, __ATOMIC_RELAXED);
+
+	for (int i = 0; i < numOfDirtyFrames; i++)
+	{
+		this->UnclaimFrame(dirtyFrames[i] - this->frames);
+	}
+
+	delete[] dirtyFrames;
+
+	// Empty the frames, writing the pages dirtied (or pinned) meanwhile
+
+	for (int i = 0; i < this->numOfBuf; i++)
+	{
+		this->WaitForIO(i);
+
+		PageID pid = this->frames[i].GetPageID();
+
+		if (INVALID_PAGE != pid)
+		{
+			Partition* partition = this->PartitionOf(pid);
+
+			pthread_mutex_lock(&partition->latch);
+			if (this->frames[i].HasPageID(pid))
+			{
+				success &= this->frames[i].NotPinned();
+				success &= (this->FlushFrame(i, true) == OK);
+			}
+			pthread_mutex_unlock(&partition->latch);
+		}
+	}
+
+	for (int i = 0; i < this->numOfPools; i++)
+	{
+		success &= (this->pools[i]->FlushAllPages() == OK);
+	}
+
+	return success ? OK : FAIL;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::Prefetch
+//
+// Input    : pid   - page id of the first page to prefetch
+//            count - (optional, default to 1) number of consecutive
+//                    pages to prefetch
+// Output   : None
+// Purpose  : Ask the I/O thread to read the pages into unpinned frames,
+//            so that a later PinPage finds them in the buffer without
+//            waiting for the disk. Pages that are already in the
+//            buffer or beyond the end of the database are skipped.
+//            This is only a hint: requests that do not fit in the
+//            queue are dropped, and a prefetched page may be replaced
+//            again before it is pinned.
+// Condition: None
+// PostCond : None
+// Return   : OK if the request was accepted.  FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::Prefetch(PageID pid, int count)
+{
+	BufMgr* pool = this->PoolOf(pid);
+	if (pool != this)
+	{
+		return pool->Prefetch(pid, count);
+	}
+
+	Status status = OK;
+
+	if (NULL != this->mapping)
+	{
+		this->mapping->Prefetch(pid, count);
+
+		return this->mapping->IsValid(pid) ? OK : FAIL;
+	}
+
+	if (INVALID_PAGE == pid || pid < 0 || count < 1)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		int numOfPages = MINIBASE_DB->GetNumOfPages();
+
+		pthread_mutex_lock(&this->prefetchLatch);
+
+		if (!this->prefetcherRunning && !this->prefetcherStop)
+		{
+			this->prefetcherRunning = (0 == pthread_create(&this->prefetcher, NULL, BufMgr::RunPrefetcher, this));
+		}
+
+		if (!this->prefetcherRunning)
+		{
+			status = FAIL;
+		}
+
+		for (PageID i = pid; OK == status && i < pid + count && i < numOfPages; i++)
+		{
+			if (BUF_PREFETCH_QUEUE == this->prefetchCount)
+			{
+				break;
+			}
+
+			if (INVALID_FRAME == this->FindFrame(i))
+			{
+				this->prefetchQueue[(this->prefetchHead + this->prefetchCount) % BUF_PREFETCH_QUEUE] = i;
+				this->prefetchCount++;
+			}
+		}
+
+		pthread_cond_signal(&this->prefetchQueued);
+		pthread_mutex_unlock(&this->prefetchLatch);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::SetReadAhead
+//
+// Input    : numOfPages - how far to read ahead of a sequential reader,
+//                         0 to turn read-ahead off
+// Output   : None
+// Purpose  : Tune the automatic read-ahead. The distance is capped at
+//            a quarter of the pool, so that read-ahead cannot push out
+//            the pages being worked on.
+//--------------------------------------------------------------------
+
+void BufMgr::SetReadAhead(int numOfPages)
+{
+	pthread_mutex_lock(&this->prefetchLatch);
+
+	this->readAheadPages = (numOfPages < this->numOfBuf / 4) ? numOfPages : this->numOfBuf / 4;
+	if (this->readAheadPages < 0)
+	{
+		this->readAheadPages = 0;
+	}
+
+	pthread_mutex_unlock(&this->prefetchLatch);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::SetBackgroundWriter
+//
+// Input    : cleanPercent - share of the pool the background writer
+//                           keeps clean, 0 to turn it off
+// Output   : None
+// Purpose  : Tune the background writer. It keeps the next cleanPercent
+//            of the frames to be replaced (all of them unpinned) clean,
+//            and PinPage looks among as many candidates for a clean
+//            victim before it settles for a dirty one that has to be
+//            written first.
+//--------------------------------------------------------------------
+
+void BufMgr::SetBackgroundWriter(int cleanPercent)
+{
+	if (cleanPercent < 0)
+	{
+		cleanPercent = 0;
+	}
+	else if (cleanPercent > 100)
+	{
+		cleanPercent = 100;
+	}
+
+	__atomic_store_n(&this->cleanPercent, cleanPercent, __ATOMIC_RELAXED);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::SetPriority
+//
+// Input    : pageClass - one of PageClass, other than PAGE_CLASS_OTHER
+//            priority  - one of EvictionPriority
+// Output   : None
+// Purpose  : Have the frames pinned for pages of the class from now on
+//            replaced with the priority. Named pools keep priorities
+//            of their own, set through GetPool.
+// Return   : FAIL if either argument is out of range.
+//--------------------------------------------------------------------
+
+Status BufMgr::SetPriority(int pageClass, int priority)
+{
+	Status status = OK;
+
+	if (pageClass <= PAGE_CLASS_OTHER || pageClass >= NUM_OF_PAGE_CLASSES
+		|| priority < 0 || priority >= NUM_OF_PRIORITIES)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		__atomic_store_n(&this->priorities[pageClass], priority, __ATOMIC_RELAXED);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::EnableCompressedCache
+//
+// Input    : numOfBytes - memory for the compressed pages
+// Output   : None
+// Purpose  : Add a second tier below the pool. Clean pages replaced
+//            from now on are compressed into it, as many as fit in
+//            numOfBytes, and a miss on one of them is served from it.
+// Return   : FAIL if the budget is not positive or the tier is
+//            already enabled.
+//--------------------------------------------------------------------
+
+Status BufMgr::EnableCompressedCache(int numOfBytes)
+{
+	Status status = OK;
+
+	if (numOfBytes <= 0)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		CompressedCache* cache = new CompressedCache(numOfBytes);
+		CompressedCache* none = NULL;
+
+		if (!__atomic_compare_exchange_n(&this->compressedCache, &none, cache, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+			delete cache;
+			status = FAIL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::SetIOEngine
+//
+// Input    : name   - "io_uring", or "threads" for a pool of I/O
+//                     threads; "io_uring" falls back to threads if the
+//                     kernel does not have it
+//            direct - if true, bypass the page cache with O_DIRECT
+//                     where the file system supports it
+// Output   : None
+// Purpose  : Do page I/O through an I/O engine from now on instead of
+//            DB::ReadPage and DB::WritePage, so that the prefetcher and
+//            the write-back of dirty pages have many reads and writes
+//            in flight at once. Named pools keep their own setting.
+// Return   : FAIL if the name is unknown or an engine is already set.
+//--------------------------------------------------------------------
+
+Status BufMgr::SetIOEngine(const char* name, bool direct)
+{
+	Status status = OK;
+
+	if (0 != strcmp(name, "io_uring") && 0 != strcmp(name, "threads"))
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		IOEngine* engine = new IOEngine(name, direct);
+		IOEngine* none = NULL;
+
+		if (!__atomic_compare_exchange_n(&this->ioEngine, &none, engine, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+			delete engine;
+			status = FAIL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::GetIOEngineName
+//
+// Returns the I/O engine in use: "io_uring", "threads", or "sync" for
+// DB::ReadPage and DB::WritePage.
+//--------------------------------------------------------------------
+
+const char* BufMgr::GetIOEngineName()
+{
+	IOEngine* engine = this->GetIOEngine();
+
+	return (NULL != engine) ? engine->GetName() : "sync";
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::SetWarmUpFile
+//
+// Input    : fileName - where to keep the list of resident pages, NULL
+//                       to stop keeping it
+// Output   : None
+// Purpose  : Name the file SaveWarmUpList writes, when the pool is
+//            flushed or destroyed, and WarmUp reads. Meant to be called
+//            once, before the pool is used.
+// Return   : OK
+//--------------------------------------------------------------------
+
+Status BufMgr::SetWarmUpFile(const char* fileName)
+{
+	delete[] this->warmUpFile;
+	this->warmUpFile = NULL;
+
+	if (NULL != fileName)
+	{
+		this->warmUpFile = new char[strlen(fileName) + 1];
+		strcpy(this->warmUpFile, fileName);
+	}
+
+	return OK;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::SaveWarmUpList
+//
+// Input    : None
+// Output   : None
+// Purpose  : Write the ids of the pages in this pool and its named
+//            pools to the warm-up file, each with its recency rank in
+//            its pool: 0 for the most recently used page, pinned pages
+//            first. The file is written aside and renamed, so that a
+//            crash leaves the previous list. If no page is resident,
+//            say right after FlushAllPages, the previous list is kept.
+//
+//            The file holds BUF_WARM_UP_MAGIC, the number of pages n,
+//            then n page ids and n ranks, as ints.
+// Return   : FAIL if no warm-up file is set or it cannot be written.
+//--------------------------------------------------------------------
+
+Status BufMgr::SaveWarmUpList()
+{
+	Status status = OK;
+	PageID* pids = NULL;
+	int* ranks = NULL;
+	int count = 0;
+
+	if (NULL == this->warmUpFile)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		pthread_rwlock_rdlock(&this->poolLatch);
+
+		int max = this->maxNumOfBuf;
+		for (int i = 0; i < this->numOfPools; i++)
+		{
+			max += this->pools[i]->maxNumOfBuf;
+		}
+
+		pids = new PageID[max];
+		ranks = new int[max];
+
+		count = this->ListResidentPages(pids, ranks, max);
+		for (int i = 0; i < this->numOfPools; i++)
+		{
+			count += this->pools[i]->ListResidentPages(pids + count, ranks + count, max - count);
+		}
+
+		pthread_rwlock_unlock(&this->poolLatch);
+	}
+
+	if (OK == status && count > 0)
+	{
+		char* tempName = new char[strlen(this->warmUpFile) + 5];
+		sprintf(tempName, "%s.new", this->warmUpFile);
+
+		int header[2] = { BUF_WARM_UP_MAGIC, count };
+		FILE* file = fopen(tempName, "wb");
+		bool written = (NULL != file);
+
+		written = written && 2 == fwrite(header, sizeof(int), 2, file);
+		written = written && count == (int)fwrite(pids, sizeof(PageID), count, file);
+		written = written && count == (int)fwrite(ranks, sizeof(int), count, file);
+
+		if (NULL != file && 0 != fclose(file))
+		{
+			written = false;
+		}
+
+		if (!written || 0 != rename(tempName, this->warmUpFile))
+		{
+			unlink(tempName);
+			status = FAIL;
+		}
+
+		delete[] tempName;
+	}
+
+	delete[] pids;
+	delete[] ranks;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::WarmUp
+//
+// Input    : None
+// Output   : None
+// Purpose  : Read the list SaveWarmUpList left in the warm-up file and
+//            have the prefetcher of each pool read its pages back, in
+//            PageID order, whenever it has no other prefetch to do,
+//            until pages start being replaced.
+//            Returns at once; the pool may be used meanwhile. Pages
+//            that no longer exist are left out, and so are the least
+//            recently used ones if their pool has fewer frames now.
+// Return   : FAIL if there is no warm-up file or it cannot be read.
+//--------------------------------------------------------------------
+
+Status BufMgr::WarmUp()
+{
+	Status status = OK;
+	FILE* file = NULL;
+	int header[2] = { 0, 0 };
+	PageID* pids = NULL;
+	int* ranks = NULL;
+	BufMgr** owners = NULL;
+	int count = 0;
+
+	if (NULL == this->warmUpFile)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		file = fopen(this->warmUpFile, "rb");
+
+		if (NULL == file)
+		{
+			status = FAIL;
+		}
+	}
+
+	if (OK == status && (2 != fread(header, sizeof(int), 2, file) || BUF_WARM_UP_MAGIC != header[0] || header[1] < 0))
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		pids = new PageID[header[1]];
+		ranks = new int[header[1]];
+		owners = new BufMgr*[header[1]];
+
+		if (header[1] != (int)fread(pids, sizeof(PageID), header[1], file) ||
+			header[1] != (int)fread(ranks, sizeof(int), header[1], file))
+		{
+			status = FAIL;
+		}
+	}
+
+	if (NULL != file)
+	{
+		fclose(file);
+	}
+
+	if (OK == status)
+	{
+		int numOfPages = MINIBASE_DB->GetNumOfPages();
+
+		for (int i = 0; i < header[1]; i++)
+		{
+			BufMgr* pool = (pids[i] >= 0 && pids[i] < numOfPages) ? this->PoolOf(pids[i]) : NULL;
+
+			if (NULL != pool && ranks[i] < pool->numOfBuf)
+			{
+				pids[count++] = pids[i];
+			}
+		}
+
+		qsort(pids, count, sizeof(PageID), ComparePageIDs);
+
+		for (int i = 0; i < count; i++)
+		{
+			owners[i] = this->PoolOf(pids[i]);
+		}
+
+		// Hand each pool its own pages, still in order
+		pthread_rwlock_rdlock(&this->poolLatch);
+
+		for (int p = -1; OK == status && p < this->numOfPools; p++)
+		{
+			BufMgr* pool = (p < 0) ? this : this->pools[p];
+			PageID* poolPids = new PageID[count];
+			int poolCount = 0;
+
+			for (int i = 0; i < count; i++)
+			{
+				if (owners[i] == pool)
+				{
+					poolPids[poolCount++] = pids[i];
+				}
+			}
+
+			status = pool->QueueWarmUp(poolPids, poolCount);
+		}
+
+		pthread_rwlock_unlock(&this->poolLatch);
+	}
+
+	delete[] pids;
+	delete[] ranks;
+	delete[] owners;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::UseMapping
+//
+// Input    : None
+// Output   : None
+// Purpose  : Switch the pool to mapped mode: write back and drop the
+//            pages in the frames, map the database file, and from then
+//            on hand out pointers into the mapping. Pages modified in
+//            place reach the file when the operating system writes them
+//            back, at FlushPage or FlushAllPages at the latest. Named
+//            pools keep their frames. Meant to be called once the
+//            database is open, before the pool is shared.
+// Return   : FAIL if the pool is mapped already, a page is pinned, or
+//            the file cannot be mapped.
+//--------------------------------------------------------------------
+
+Status BufMgr::UseMapping()
+{
+	Status status = OK;
+
+	// The operating system writes mapped pages back whenever it likes,
+	// ahead of the log
+	if (NULL != this->mapping || NULL != this->log)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		status = this->FlushAllPages();
+	}
+
+	if (OK == status)
+	{
+		MappedDB* mapping = new MappedDB(MINIBASE_DB->GetName(), MINIBASE_DB->GetNumOfPages(), status);
+
+		if (OK == status)
+		{
+			this->mapping = mapping;
+		}
+		else
+		{
+			delete mapping;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::EnableLog
+//
+// Input    : fileName   - the log file
+//            maxLogSize - the most pages' worth of bytes the log may
+//                         hold, as passed to SystemDefs
+// Output   : None
+// Purpose  : Start logging changes made by transactions, in this pool
+//            and its named pools. If the log holds records, recover
+//            first: redo every change in it, undo those of the
+//            transactions that did not commit, write the pages back
+//            and empty the log. Meant to be called once the database
+//            is open, before the pool is shared.
+// Return   : FAIL if a log is enabled already, the pool (or a named
+//            pool) is mapped, or the log cannot be opened or recovered.
+//--------------------------------------------------------------------
+
+Status BufMgr::EnableLog(const char* fileName, int maxLogSize)
+{
+	Status status = OK;
+
+	if (NULL != this->log || NULL != this->mapping || NULL == fileName || maxLogSize <= 0)
+	{
+		status = FAIL;
+	}
+
+	pthread_rwlock_wrlock(&this->poolLatch);
+	for (int i = 0; OK == status && i < this->numOfPools; i++)
+	{
+		if (NULL != this->pools[i]->mapping)
+		{
+			status = FAIL;
+		}
+	}
+
+	if (OK == status)
+	{
+		LogManager* log = new LogManager(fileName, (long)maxLogSize * MINIBASE_PAGESIZE, status);
+
+		if (OK == status)
+		{
+			this->log = log;
+			for (int i = 0; i < this->numOfPools; i++)
+			{
+				this->pools[i]->log = log;
+			}
+		}
+		else
+		{
+			delete log;
+		}
+	}
+	pthread_rwlock_unlock(&this->poolLatch);
+
+	if (OK == status)
+	{
+		status = this->Recover();
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::BeginTransaction
+//
+// Input    : None
+// Output   : txnId - the id of the new transaction
+// Purpose  : Start a transaction, whose changes are then logged with
+//            LogUpdate.
+// Return   : FAIL if no log is enabled or too many transactions are
+//            active. OK otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::BeginTransaction(int& txnId)
+{
+	return (NULL == this->log) ? FAIL : this->log->Begin(txnId);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::LogUpdate
+//
+// Input    : txnId  - an active transaction
+//            guard  - the pin on the page changed
+//            offset - where the change starts in the page
+//            length - the number of bytes changed
+//            before - the bytes as they were before the change
+// Output   : None
+// Purpose  : Log a change the transaction has just made to the page,
+//            the after image being taken from the page itself. The
+//            page is marked dirty and stamped with the LSN of the
+//            record, so that the record is flushed before the page is
+//            written. Transactions running at the same time must not
+//            change the same bytes.
+// Return   : FAIL if no log is enabled, the guard holds no pin, the
+//            range is outside the page, or the log is full. OK
+//            otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::LogUpdate(int txnId, PageGuard& guard, int offset, int length, const char* before)
+{
+	Status status = OK;
+	BufMgr* pool = guard.bufMgr;
+	LSN lsn = INVALID_LSN;
+
+	if (NULL == this->log || NULL == pool || INVALID_FRAME == guard.frameId
+		|| offset < 0 || length <= 0 || offset + length > MINIBASE_PAGESIZE)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		// Dirtied before the record is appended, so that a checkpoint
+		// either finds the page dirty or the record after its start
+		pool->MarkDirty(guard.frameId, guard.pid);
+
+		status = this->log->Append(txnId, LOG_UPDATE, guard.pid, offset, length, before, (char*)guard.page + offset, lsn);
+	}
+
+	if (OK == status)
+	{
+		pool->StampPage(guard.frameId, lsn);
+		guard.DirtyIt();
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::CommitTransaction
+//
+// Input    : txnId - an active transaction
+// Output   : None
+// Purpose  : Log the commit and wait until it is durable. Threads
+//            committing at the same time share the log writes, see
+//            LogManager::Flush. Once the log is half full, take a
+//            checkpoint.
+// Return   : OK if the transaction committed. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::CommitTransaction(int txnId)
+{
+	Status status = OK;
+	LSN lsn = INVALID_LSN;
+
+	if (NULL == this->log)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		status = this->log->End(txnId, LOG_COMMIT, lsn);
+	}
+
+	if (OK == status)
+	{
+		status = this->log->Flush(lsn);
+	}
+
+	// Make room once the log is half full, one thread at a time. The
+	// transaction has committed whatever comes of it.
+	if (OK == status && this->log->GetSize() > this->log->GetCapacity() / 2
+		&& !__atomic_exchange_n(&this->checkpointing, true, __ATOMIC_ACQUIRE))
+	{
+		this->Checkpoint();
+		__atomic_store_n(&this->checkpointing, false, __ATOMIC_RELEASE);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::AbortTransaction
+//
+// Input    : txnId - an active transaction
+// Output   : None
+// Purpose  : Undo the changes of the transaction, latest first, by
+//            putting the before images back, and log the abort. Each
+//            undo is logged as a compensation, so that it is redone
+//            after a crash like any other change.
+// Return   : OK if the transaction was rolled back. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::AbortTransaction(int txnId)
+{
+	Status status = OK;
+	LSN lsn = INVALID_LSN;
+
+	if (NULL == this->log)
+	{
+		status = FAIL;
+	}
+
+	// The records are read back from the file
+	if (OK == status)
+	{
+		lsn = this->log->GetLastLSN(txnId);
+		status = this->log->Flush(lsn);
+	}
+
+	while (OK == status && INVALID_LSN != lsn)
+	{
+		LogRecord record;
+		char* data = NULL;
+
+		status = this->log->ReadRecord(lsn, record, data);
+
+		if (OK == status)
+		{
+			if (LOG_UPDATE == record.type)
+			{
+				status = this->ApplyImage(record.pid, record.offset, record.length, data, txnId, INVALID_LSN);
+			}
+
+			lsn = record.prevLSN;
+			delete[] data;
+		}
+	}
+
+	if (OK == status)
+	{
+		status = this->log->End(txnId, LOG_ABORT, lsn);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::Checkpoint
+//
+// Input    : None
+// Output   : None
+// Purpose  : Write back the dirty unpinned pages of this pool and its
+//            named pools, and give up the log records that are no
+//            longer needed: those before the first change of a page
+//            not written since, and before the first record of an
+//            active transaction.
+// Return   : OK if successful. FAIL if the log or the database could
+//            not be synced.
+//--------------------------------------------------------------------
+
+Status BufMgr::Checkpoint()
+{
+	Status status = OK;
+	LSN newStartLSN = INVALID_LSN;
+
+	if (NULL == this->log)
+	{
+		status = FAIL;
+	}
+
+	// The records after this point are kept whatever happens below
+	if (OK == status)
+	{
+		newStartLSN = this->log->GetEndLSN();
+		status = this->log->Flush(newStartLSN);
+	}
+
+	if (OK == status)
+	{
+		this->WriteDirtyFrames();
+
+		pthread_rwlock_rdlock(&this->poolLatch);
+		for (int i = 0; i < this->numOfPools; i++)
+		{
+			this->pools[i]->WriteDirtyFrames();
+		}
+
+		// Active transactions first: a change not stamped on its page
+		// yet belongs to one that has not committed
+		LSN lsn = this->log->GetOldestActiveLSN();
+		newStartLSN = (lsn < newStartLSN) ? lsn : newStartLSN;
+
+		for (int i = -1; i < this->numOfPools; i++)
+		{
+			lsn = (i < 0) ? this->GetOldestChangeLSN() : this->pools[i]->GetOldestChangeLSN();
+			newStartLSN = (INVALID_LSN != lsn && lsn < newStartLSN) ? lsn : newStartLSN;
+		}
+		pthread_rwlock_unlock(&this->poolLatch);
+	}
+
+	// The pages written since their changes were logged have to be on
+	// disk, not just written, before the log that could redo them goes
+	if (OK == status)
+	{
+		int fd = open(MINIBASE_DB->GetName(), O_RDONLY);
+
+		if (fd < 0 || 0 != fsync(fd))
+		{
+			status = FAIL;
+		}
+
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+	}
+
+	if (OK == status)
+	{
+		status = this->log->Truncate(newStartLSN);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::StartRecording
+//
+// Input    : fileName - the trace file to write, replaced if it exists
+// Output   : None
+// Purpose  : Record every pin and unpin of this pool and its named
+//            pools, until StopRecording or the buffer manager is
+//            deleted. See TraceRecorder for the format. Meant to be
+//            called while no other thread is using the pool.
+// Return   : FAIL if already recording or the file cannot be written.
+//--------------------------------------------------------------------
+
+Status BufMgr::StartRecording(const char* fileName)
+{
+	Status status = OK;
+
+	if (NULL != this->recorder || NULL == fileName)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		TraceRecorder* recorder = new TraceRecorder(fileName, status);
+
+		if (OK == status)
+		{
+			pthread_rwlock_wrlock(&this->poolLatch);
+			__atomic_store_n(&this->recorder, recorder, __ATOMIC_RELEASE);
+			for (int i = 0; i < this->numOfPools; i++)
+			{
+				__atomic_store_n(&this->pools[i]->recorder, recorder, __ATOMIC_RELEASE);
+			}
+			pthread_rwlock_unlock(&this->poolLatch);
+		}
+		else
+		{
+			delete recorder;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::StopRecording
+//
+// Input    : None
+// Output   : None
+// Purpose  : Stop recording and write out the rest of the trace. Meant
+//            to be called while no other thread is using the pool.
+// Return   : FAIL if not recording or a write of the trace failed.
+//--------------------------------------------------------------------
+
+Status BufMgr::StopRecording()
+{
+	Status status = OK;
+	TraceRecorder* recorder = this->recorder;
+
+	if (NULL == recorder)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		pthread_rwlock_wrlock(&this->poolLatch);
+		__atomic_store_n(&this->recorder, (TraceRecorder*)NULL, __ATOMIC_RELEASE);
+		for (int i = 0; i < this->numOfPools; i++)
+		{
+			__atomic_store_n(&this->pools[i]->recorder, (TraceRecorder*)NULL, __ATOMIC_RELEASE);
+		}
+		pthread_rwlock_unlock(&this->poolLatch);
+
+		status = recorder->Flush();
+		delete recorder;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::Resize
+//
+// Input    : bufSize - the new number of frames, at most BUF_MAX_GROWTH
+//                      times the number the pool was created with
+// Output   : None
+// Purpose  : Grow or shrink the pool while it is in use. When shrinking,
+//            each frame that goes away is claimed as soon as it is not
+//            pinned, and its page is written back if dirty and dropped;
+//            the frame stays claimed so that no page is loaded into it
+//            again. Once all of them are held, the pool is latched as
+//            a whole and the replacer is rebuilt for the new size, the
+//            unpinned frames being replayed in their order of
+//            replacement, so that recency is kept.
+// PostCond : If OK is returned the pool has bufSize frames, otherwise
+//            it keeps its size (though some pages may have been
+//            written back and dropped). The page images of the frames
+//            kept do not move, so pages pinned meanwhile stay valid.
+// Return   : OK if the pool was resized, FAIL if the size is out of
+//            range, a page could not be written back, or a frame that
+//            goes away stayed pinned for BUF_RESIZE_WAIT_MS.
+//--------------------------------------------------------------------
+
+Status BufMgr::Resize(int bufSize)
+{
+	Status status = OK;
+
+	pthread_mutex_lock(&this->resizeLatch);
+	int numOfFrames = this->numOfBuf;
+
+	if (bufSize <= 0 || bufSize > this->maxNumOfBuf)
+	{
+		status = FAIL;
+	}
+
+	// Claim the frames that go away, writing back and dropping their
+	// pages, one partition latch at a time
+	bool* claimed = new bool[numOfFrames];
+	int numOfUnclaimed = 0;
+
+	for (int i = 0; i < numOfFrames; i++)
+	{
+		claimed[i] = false;
+		numOfUnclaimed += (OK == status && i >= bufSize) ? 1 : 0;
+	}
+
+	for (int wait = 0; OK == status && numOfUnclaimed > 0; wait++)
+	{
+		if (wait > BUF_RESIZE_WAIT_MS)
+		{
+			status = FAIL;
+		}
+		else if (wait > 0)
+		{
+			usleep(1000);
+		}
+
+		for (int i = bufSize; OK == status && i < numOfFrames; i++)
+		{
+			if (!claimed[i] && this->ClaimFrame(i))
+			{
+				status = this->DropClaimedPage(i, claimed[i]);
+
+				if (claimed[i])
+				{
+					// Wake up the threads waiting for the page, but
+					// keep the frame
+					this->FinishIO(i);
+					numOfUnclaimed--;
+				}
+				else
+				{
+					this->UnclaimFrame(i);
+				}
+			}
+		}
+	}
+
+	if (OK == status)
+	{
+		for (int i = 0; i < BUF_PARTITIONS; i++)
+		{
+			pthread_mutex_lock(&this->partitions[i].latch);
+		}
+		pthread_mutex_lock(&this->replacerLatch);
+
+		this->RebuildReplacer(bufSize);
+
+		if (bufSize > numOfFrames)
+		{
+			this->arena->Resize(bufSize);
+			__atomic_store_n(&this->numOfBuf, bufSize, __ATOMIC_RELEASE);
+		}
+		else
+		{
+			__atomic_store_n(&this->numOfBuf, bufSize, __ATOMIC_RELEASE);
+			this->arena->Resize(bufSize);
+		}
+
+		// What was sampled was about the old size
+		this->mrc->Reset(bufSize, this->stats.GetPins());
+
+		pthread_mutex_unlock(&this->replacerLatch);
+		for (int i = BUF_PARTITIONS - 1; i >= 0; i--)
+		{
+			pthread_mutex_unlock(&this->partitions[i].latch);
+		}
+	}
+
+	// Frames past the end are never claimed again; on failure they go
+	// back to the replacer as they were
+	for (int i = bufSize; i < numOfFrames; i++)
+	{
+		if (claimed[i])
+		{
+			this->frames[i].Unpin();
+		}
+	}
+
+	delete[] claimed;
+	pthread_mutex_unlock(&this->resizeLatch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::DropClaimedPage
+//
+// Input    : frameId - a frame claimed with ClaimFrame
+// Output   : dropped - true if the frame is now empty
+// Purpose  : Write the page in the frame back if it is dirty, and take
+//            it out of the pool, unless a hit pinned (or dirtied) it
+//            meanwhile.
+// PostCond : The frame is still claimed.
+// Return   : OK if the page was written back (or clean). FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::DropClaimedPage(int frameId, bool& dropped)
+{
+	Status status = OK;
+	Frame& frame = this->frames[frameId];
+	PageID pid = frame.GetPageID();
+
+	dropped = (INVALID_PAGE == pid);
+
+	if (frame.IsDirty())
+	{
+		frame.CleanIt();
+
+		long start = NowInNanoseconds();
+		status = this->ForceLog(frameId);
+		if (OK == status)
+		{
+			status = frame.Write(this->GetIOEngine());
+		}
+
+		// Collect stats
+		this->stats.writeLatency.Add(NowInNanoseconds() - start);
+		__atomic_add_fetch(&this->stats.foregroundWrites, 1, __ATOMIC_RELAXED);
+
+		if (OK != status)
+		{
+			frame.DirtyIt();
+		}
+	}
+
+	if (OK == status && INVALID_PAGE != pid)
+	{
+		Partition* partition = this->PartitionOf(pid);
+
+		pthread_mutex_lock(&partition->latch);
+		if (frame.HasPageID(pid) && 1 == frame.GetPinCount() && !frame.IsDirty())
+		{
+			pthread_mutex_lock(&this->replacerLatch);
+			this->replacer->OnEvict(frameId);
+			partition->pageTable->Delete(pid);
+
+			// Not EmptyIt, which would give up the claim
+			frame.SetPageID(INVALID_PAGE);
+			frame.SetPrefetched(false);
+			__atomic_store_n(&this->pinStart[frameId], 0, __ATOMIC_RELAXED);
+			__atomic_store_n(&this->recLSNs[frameId], INVALID_LSN, __ATOMIC_RELEASE);
+
+			this->replacer->OnFree(frameId);
+			this->freeFrames->MoveToBack(FREE_FRAMES, frameId);
+			pthread_mutex_unlock(&this->replacerLatch);
+
+			dropped = true;
+		}
+		pthread_mutex_unlock(&partition->latch);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::RebuildReplacer
+//
+// Input    : bufSize - the new number of frames
+// Output   : None
+// Purpose  : Replace the replacer by one of the same policy for bufSize
+//            frames, and the free list by the empty ones among them.
+//            Tell the new replacer about the pages in the first bufSize
+//            frames: pinned pages as just loaded, unpinned ones as
+//            loaded and unpinned in the order the old replacer would
+//            have replaced them.
+// Condition: All the latches are held, and the frames from bufSize on
+//            are empty.
+//--------------------------------------------------------------------
+
+void BufMgr::RebuildReplacer(int bufSize)
+{
+	int numOfFrames = this->numOfBuf;
+	int* order = new int[numOfFrames];
+	bool* replayed = new bool[numOfFrames];
+	int numOfVictims = this->replacer->NextVictims(order, numOfFrames);
+
+	Replacer* replacer = Replacer::Create(this->replacer->GetName(), bufSize, &this->frames);
+
+	// Keep the search length counting from the last reset
+	this->examinedAtReset -= this->replacer->GetNumOfExamined();
+
+	for (int i = 0; i < numOfFrames && i < bufSize; i++)
+	{
+		replayed[i] = false;
+		replacer->SetPriority(i, this->replacer->GetPriority(i));
+
+		if (this->frames[i].IsValid())
+		{
+			replacer->OnLoad(i);
+		}
+	}
+
+	for (int i = 0; i < numOfVictims; i++)
+	{
+		int frameId = order[i];
+
+		if (frameId < bufSize && this->frames[frameId].IsValid() && !replayed[frameId])
+		{
+			replacer->OnUnpin(frameId);
+			replayed[frameId] = true;
+		}
+	}
+
+	// Unpinned pages the old replacer did not list, if any. A frame
+	// claimed as a victim is unpinned as far as the replacer knows.
+	for (int i = 0; i < numOfFrames && i < bufSize; i++)
+	{
+		if (this->frames[i].IsValid() && (this->frames[i].NotPinned() || this->frames[i].IsIOInProgress()) && !replayed[i])
+		{
+			replacer->OnUnpin(i);
+		}
+	}
+
+	delete this->replacer;
+	this->replacer = replacer;
+
+	this->freeFrames->EmptyIt();
+	for (int i = 0; i < bufSize; i++)
+	{
+		if (!this->frames[i].IsValid())
+		{
+			this->freeFrames->PushBack(FREE_FRAMES, i);
+		}
+	}
+
+	delete[] order;
+	delete[] replayed;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::AddPool
+//
+// Input    : name              - name of the new pool
+//            bufSize           - number of frames of the new pool
+//            replacementPolicy - (optional) replacement policy of the
+//                                new pool, see Replacer::Create
+// Output   : None
+// Purpose  : Create a named pool owned by this buffer manager. No page
+//            is in it until pages are bound to it.
+// Condition: No pool of that name exists, and there are fewer than
+//            BUF_MAX_POOLS pools.
+// Return   : OK if the pool was created, FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::AddPool(const char* name, int bufSize, const char* replacementPolicy)
+{
+	Status status = OK;
+
+	pthread_rwlock_wrlock(&this->poolLatch);
+	if (NULL == name || bufSize <= 0 || this->numOfPools >= BUF_MAX_POOLS || INVALID_FRAME != this->FindPool(name))
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		int poolIndex = this->numOfPools;
+
+		this->pools[poolIndex] = new BufMgr(bufSize, replacementPolicy);
+		this->pools[poolIndex]->log = this->log;
+		this->pools[poolIndex]->recorder = this->recorder;
+		this->poolNames[poolIndex] = new char[strlen(name) + 1];
+		strcpy(this->poolNames[poolIndex], name);
+
+		// Only published once the pool is complete; PoolOf reads it
+		// without the latch.
+		__atomic_store_n(&this->numOfPools, poolIndex + 1, __ATOMIC_RELEASE);
+	}
+	pthread_rwlock_unlock(&this->poolLatch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::GetPool
+//
+// Input    : name - name of a pool
+// Output   : None
+// Return   : The pool of that name, NULL if there is none.
+//--------------------------------------------------------------------
+
+BufMgr* BufMgr::GetPool(const char* name)
+{
+	BufMgr* pool = NULL;
+
+	pthread_rwlock_rdlock(&this->poolLatch);
+	int poolIndex = this->FindPool(name);
+
+	if (INVALID_FRAME != poolIndex)
+	{
+		pool = this->pools[poolIndex];
+	}
+	pthread_rwlock_unlock(&this->poolLatch);
+
+	return pool;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::UsePool
+//
+// Input    : name - name of a pool, or NULL for this one
+// Output   : None
+// Purpose  : Make NewPage and NewRun allocate their pages in the named
+//            pool, and bind the pages to it. The selection is shared by
+//            all threads; a file is created in a pool by selecting the
+//            pool around the creation, e.g. of a BTreeFile.
+// Return   : OK if the pool exists, FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::UsePool(const char* name)
+{
+	Status status = OK;
+
+	pthread_rwlock_rdlock(&this->poolLatch);
+	int poolIndex = (NULL == name) ? INVALID_FRAME : this->FindPool(name);
+
+	if (NULL != name && INVALID_FRAME == poolIndex)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		__atomic_store_n(&this->allocationPool, poolIndex, __ATOMIC_RELEASE);
+	}
+	pthread_rwlock_unlock(&this->poolLatch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::BindPages
+//
+// Input    : firstPid - first page of a run of pages
+//            count    - number of pages in the run
+//            poolName - name of a pool, or NULL for this one
+// Output   : None
+// Purpose  : Bind the pages to the named pool. Copies of the pages in
+//            the pool they were bound to so far are written back and
+//            dropped, so that no page is ever buffered twice.
+// Condition: None of the pages is pinned.
+// PostCond : Later calls for the pages go to the named pool.
+// Return   : OK if all the pages were bound, FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::BindPages(PageID firstPid, int count, const char* poolName)
+{
+	Status status = OK;
+
+	pthread_rwlock_rdlock(&this->poolLatch);
+	int poolIndex = (NULL == poolName) ? INVALID_FRAME : this->FindPool(poolName);
+
+	if (NULL != poolName && INVALID_FRAME == poolIndex)
+	{
+		status = FAIL;
+	}
+	pthread_rwlock_unlock(&this->poolLatch);
+
+	for (int i = 0; OK == status && i < count; i++)
+	{
+		BufMgr* owner = this->PoolOf(firstPid + i);
+		Partition* partition = owner->PartitionOf(firstPid + i);
+
+		pthread_mutex_lock(&partition->latch);
+		int frameId = partition->pageTable->LookUp(firstPid + i);
+
+		if (INVALID_FRAME != frameId)
+		{
+			status = owner->FlushFrame(frameId);
+		}
+		pthread_mutex_unlock(&partition->latch);
+
+		if (OK == status)
+		{
+			this->Route(firstPid + i, 1, poolIndex);
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::BindFile
+//
+// Input    : fileName - name of a file in the database directory
+//            poolName - name of a pool, or NULL for this one
+// Output   : None
+// Purpose  : Bind the first page of the file to the named pool. The
+//            database does not record which pages belong to a file,
+//            so its other pages are bound as they are allocated, by
+//            selecting the pool with UsePool, or with BindPages.
+// Return   : OK if the file exists and the page was bound, FAIL
+//            otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::BindFile(const char* fileName, const char* poolName)
+{
+	PageID firstPid = INVALID_PAGE;
+
+	pthread_mutex_lock(&spaceMapLatch);
+	Status status = MINIBASE_DB->GetFileEntry(fileName, firstPid);
+	pthread_mutex_unlock(&spaceMapLatch);
+
+	if (OK == status)
+	{
+		status = this->BindPages(firstPid, 1, poolName);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::PoolOf
+//
+// Input    : pid - a page id
+// Output   : None
+// Return   : The pool the page is bound to; this one if the page is
+//            not bound, which is all there is to it while there are
+//            no named pools.
+//--------------------------------------------------------------------
+
+BufMgr* BufMgr::PoolOf(PageID pid)
+{
+	BufMgr* pool = this;
+
+	if (__atomic_load_n(&this->numOfPools, __ATOMIC_ACQUIRE) > 0)
+	{
+		pthread_rwlock_rdlock(&this->poolLatch);
+		int poolIndex = this->poolOfPage->LookUp(pid);
+
+		if (INVALID_FRAME != poolIndex)
+		{
+			pool = this->pools[poolIndex];
+		}
+		pthread_rwlock_unlock(&this->poolLatch);
+	}
+
+	return pool;
+}
+
+
+int BufMgr::FindPool(const char* name)
+{
+	for (int i = 0; NULL != name && i < this->numOfPools; i++)
+	{
+		if (0 == strcmp(this->poolNames[i], name))
+		{
+			return i;
+		}
+	}
+
+	return INVALID_FRAME;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::Route
+//
+// Input    : firstPid  - first page of a run of pages
+//            count     - number of pages in the run
+//            poolIndex - index of the pool the pages are bound to, or
+//                        INVALID_FRAME to bind them to this pool
+// Output   : None
+//--------------------------------------------------------------------
+
+void BufMgr::Route(PageID firstPid, int count, int poolIndex)
+{
+	pthread_rwlock_wrlock(&this->poolLatch);
+	for (int i = 0; i < count; i++)
+	{
+		if (INVALID_FRAME == poolIndex)
+		{
+			this->poolOfPage->Delete(firstPid + i);
+		}
+		else
+		{
+			this->poolOfPage->Insert(firstPid + i, poolIndex);
+		}
+	}
+	pthread_rwlock_unlock(&this->poolLatch);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::GetNumOfUnpinnedFrames
+//
+// Input    : None
+// Output   : None
+// Purpose  : Find out how many unpinned locations are in the buffer
+//            pool.
+// Condition: None
+// PostCond : None
+// Return   : The number of unpinned buffers in the buffer pool.
+//--------------------------------------------------------------------
+
+unsigned int BufMgr::GetNumOfUnpinnedFrames()
+{
+	// Used only for test case; does not really make sense (see bmtest.cpp, Test2).
+	int numOfUnpinnedFrames = this->numOfBuf - __atomic_load_n(&this->frameCounters.numOfPinned, __ATOMIC_RELAXED);
+
+	return (numOfUnpinnedFrames > 0) ? numOfUnpinnedFrames : 0;
+}
+
+
+Status BufMgr::GetStat(long& pinNo, long& missNo)
+{
+	pinNo = 0;
+	missNo = 0;
+
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		pinNo += __atomic_load_n(&this->stats.pins[i], __ATOMIC_RELAXED);
+		missNo += __atomic_load_n(&this->stats.misses[i], __ATOMIC_RELAXED);
+	}
+
+	return OK;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::GetWriteStat
+//
+// Output   : foreground - dirty pages written by the threads using the
+//                         pool: when evicting them, or on FlushPage
+//                         and FlushAllPages
+//            background - dirty pages written by the background writer
+//--------------------------------------------------------------------
+
+Status BufMgr::GetWriteStat(long& foreground, long& background)
+{
+	foreground = __atomic_load_n(&this->stats.foregroundWrites, __ATOMIC_RELAXED);
+	background = __atomic_load_n(&this->stats.backgroundWrites, __ATOMIC_RELAXED);
+
+	return OK;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::GetStats
+//
+// Input    : None
+// Output   : snapshot - the statistics of the pool
+// Purpose  : Take a snapshot of the statistics. Each counter is read
+//            atomically, but they are not read at one instant, so
+//            they may disagree slightly while the pool is in use.
+//--------------------------------------------------------------------
+
+void BufMgr::GetStats(BufStats& snapshot)
+{
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		snapshot.pins[i] = __atomic_load_n(&this->stats.pins[i], __ATOMIC_RELAXED);
+		snapshot.misses[i] = __atomic_load_n(&this->stats.misses[i], __ATOMIC_RELAXED);
+	}
+
+	snapshot.evictions = __atomic_load_n(&this->stats.evictions, __ATOMIC_RELAXED);
+	snapshot.dirtyEvictions = __atomic_load_n(&this->stats.dirtyEvictions, __ATOMIC_RELAXED);
+	snapshot.foregroundWrites = __atomic_load_n(&this->stats.foregroundWrites, __ATOMIC_RELAXED);
+	snapshot.backgroundWrites = __atomic_load_n(&this->stats.backgroundWrites, __ATOMIC_RELAXED);
+	snapshot.prefetches = __atomic_load_n(&this->stats.prefetches, __ATOMIC_RELAXED);
+	snapshot.compressedHits = __atomic_load_n(&this->stats.compressedHits, __ATOMIC_RELAXED);
+	snapshot.compressedMisses = __atomic_load_n(&this->stats.compressedMisses, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&this->replacerLatch);
+	snapshot.victimSearches = this->stats.victimSearches;
+	snapshot.victimSearchLength = this->replacer->GetNumOfExamined() - this->examinedAtReset;
+	pthread_mutex_unlock(&this->replacerLatch);
+
+	snapshot.readLatency.CopyFrom(this->stats.readLatency);
+	snapshot.writeLatency.CopyFrom(this->stats.writeLatency);
+	snapshot.pinHoldTime.CopyFrom(this->stats.pinHoldTime);
+
+	CompressedCache* cache = __atomic_load_n(&this->compressedCache, __ATOMIC_ACQUIRE);
+	snapshot.numOfCompressedPages = (NULL != cache) ? cache->GetNumOfPages() : 0;
+	snapshot.numOfCompressedBytes = (NULL != cache) ? cache->GetNumOfUsedBytes() : 0;
+
+	snapshot.commits = (NULL != this->log) ? this->log->GetNumOfCommits() : 0;
+	snapshot.logSyncs = (NULL != this->log) ? this->log->GetNumOfSyncs() : 0;
+
+	snapshot.mrcSamples = this->mrc->GetHitRatios(snapshot.GetPins(), snapshot.mrcSizes, snapshot.mrcHitRatios);
+
+	snapshot.numOfFrames = this->numOfBuf;
+	snapshot.numOfValidFrames = __atomic_load_n(&this->frameCounters.numOfValid, __ATOMIC_RELAXED);
+	snapshot.numOfPinnedFrames = __atomic_load_n(&this->frameCounters.numOfPinned, __ATOMIC_RELAXED);
+	snapshot.numOfDirtyFrames = __atomic_load_n(&this->frameCounters.numOfDirty, __ATOMIC_RELAXED);
+}
+
+
+void  BufMgr::PrintStat() {
+	BufStats snapshot;
+	this->GetStats(snapshot);
+
+	cout << "**Buffer Manager Statistics**" << endl;
+	cout << "Number of Dirty Pages Written to Disk: " << snapshot.foregroundWrites + snapshot.backgroundWrites << endl;
+	cout << "  Written by Queries: " << snapshot.foregroundWrites << endl;
+	cout << "  Written by the Background Writer: " << snapshot.backgroundWrites << endl;
+	cout << "Number of Pin Page Requests: " << snapshot.GetPins() << endl;
+	cout << "Number of Pin Page Request Misses " << snapshot.GetMisses() << endl;
+
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		if (snapshot.pins[i] > 0 && snapshot.pins[i] < snapshot.GetPins())
+		{
+			cout << "  " << pageClassNames[i] << " Pages: " << snapshot.pins[i] << " requests, " << snapshot.misses[i] << " misses" << endl;
+		}
+	}
+
+	cout << "Number of Pages Prefetched: " << snapshot.prefetches << endl;
+	cout << "Number of Evictions: " << snapshot.evictions << " (" << snapshot.dirtyEvictions << " dirty)" << endl;
+	cout << "Average Victim Search Length: "
+		 << ((snapshot.victimSearches > 0) ? (double)snapshot.victimSearchLength / snapshot.victimSearches : 0.0) << endl;
+	cout << "Read Latency (ns): p50 " << snapshot.readLatency.GetPercentile(50)
+		 << ", p99 " << snapshot.readLatency.GetPercentile(99) << endl;
+	cout << "Write Latency (ns): p50 " << snapshot.writeLatency.GetPercentile(50)
+		 << ", p99 " << snapshot.writeLatency.GetPercentile(99) << endl;
+	cout << "Pin Hold Time (ns): p50 " << snapshot.pinHoldTime.GetPercentile(50)
+		 << ", p99 " << snapshot.pinHoldTime.GetPercentile(99) << endl;
+	cout << "Frames in Use: " << snapshot.numOfValidFrames << " of " << snapshot.numOfFrames
+		 << " (" << snapshot.numOfPinnedFrames << " pinned, " << snapshot.numOfDirtyFrames << " dirty)" << endl;
+
+	if (NULL != this->compressedCache)
+	{
+		cout << "Compressed Cache: " << snapshot.compressedHits << " hits, " << snapshot.compressedMisses << " misses, "
+			 << snapshot.numOfCompressedPages << " pages in " << snapshot.numOfCompressedBytes << " bytes" << endl;
+	}
+
+	if (NULL != this->log)
+	{
+		cout << "Log: " << snapshot.commits << " commits, " << snapshot.logSyncs << " syncs" << endl;
+	}
+
+	cout << "Estimated LRU Hit Ratio (" << snapshot.mrcSamples << " pins sampled):";
+	for (int i = 0; i < MRC_POINTS; i++)
+	{
+		cout << ((i > 0) ? "," : "") << " " << snapshot.mrcSizes[i] << " frames " << 100 * snapshot.mrcHitRatios[i] << "%";
+	}
+	cout << endl;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ResetStat
+//
+// Clear the counters and histograms, for instance at the start of a
+// query. The occupancy of the pool is not affected.
+//--------------------------------------------------------------------
+
+void BufMgr::ResetStat()
+{
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		__atomic_store_n(&this->stats.pins[i], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&this->stats.misses[i], 0, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_lock(&this->prefetchLatch);
+	__atomic_store_n(&this->stats.evictions, 0, __ATOMIC_RELAXED);
+	this->warmUpEvictions = 0;
+	pthread_mutex_unlock(&this->prefetchLatch);
+
+	__atomic_store_n(&this->stats.dirtyEvictions, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&this->stats.foregroundWrites, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&this->stats.backgroundWrites, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&this->stats.prefetches, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&this->stats.compressedHits, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&this->stats.compressedMisses, 0, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&this->replacerLatch);
+	this->stats.victimSearches = 0;
+	this->examinedAtReset = this->replacer->GetNumOfExamined();
+	pthread_mutex_unlock(&this->replacerLatch);
+
+	this->stats.readLatency.Reset();
+	this->stats.writeLatency.Reset();
+	this->stats.pinHoldTime.Reset();
+
+	this->mrc->ResetCounts(0);
+}
+
+
+long BufStats::GetPins()
+{
+	long total = 0;
+
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		total += this->pins[i];
+	}
+
+	return total;
+}
+
+
+long BufStats::GetMisses()
+{
+	long total = 0;
+
+	for (int i = 0; i < NUM_OF_PAGE_CLASSES; i++)
+	{
+		total += this->misses[i];
+	}
+
+	return total;
+}
+
+//--------------------------------------------------------------------
+// BufMgr::FindFrame
+//
+// Input    : pid - a page id 
+// Output   : None
+// Purpose  : Look for the page in the buffer pool, return the frame
+//            number if found. This is an O(1) expected time lookup in
+//            the page table partition of pid.
+// PreCond  : None
+// PostCond : None
+// Return   : the frame number if found. INVALID_FRAME otherwise. The
+//            page may be evicted at any time unless it is pinned by
+//            the caller.
+//--------------------------------------------------------------------
+
+int BufMgr::FindFrame(PageID pid)
+{
+	Partition* partition = this->PartitionOf(pid);
+
+	pthread_mutex_lock(&partition->latch);
+	int frameId = partition->pageTable->LookUp(pid);
+	pthread_mutex_unlock(&partition->latch);
+
+	return frameId;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::FlushFrame
+//
+// Input    : frameId      - a frame
+//            ignorePinned - flush the frame even if it is pinned
+// Output   : None
+// Purpose  : Write the page in the frame to disk if it is dirty and
+//            empty the frame.
+// PreCond  : The caller holds the latch of the page table partition
+//            of the page in the frame.
+// Return   : OK if operation is successful. FAIL if the frame is
+//            pinned (and ignorePinned is false), is being read in or
+//            evicted by another thread, or the write failed.
+//--------------------------------------------------------------------
+
+Status BufMgr::FlushFrame(int frameId, bool ignorePinned)
+{
+	Status status = OK;
+	Frame& frame = this->frames[frameId];
+
+	// If we care about flushing pinned pages and the frame is pinned - fail.
+	if (!ignorePinned && !frame.NotPinned())
+	{
+		status = FAIL;
+	}
+
+	if (frame.IsIOInProgress())
+	{
+		status = FAIL;
+	}
+
+	// Write-ahead: the changes logged for the page go out first
+	if (OK == status && frame.IsDirty())
+	{
+		status = this->ForceLog(frameId);
+	}
+
+	// Flush the frame to disk
+	if (OK == status)
+	{
+		if (frame.IsDirty())
+		{
+			long start = NowInNanoseconds();
+			status = frame.Write(this->GetIOEngine());
+
+			// Collect stats
+			this->stats.writeLatency.Add(NowInNanoseconds() - start);
+			__atomic_add_fetch(&this->stats.foregroundWrites, 1, __ATOMIC_RELAXED);
+		}
+
+		if (frame.IsValid())
+		{
+			this->PartitionOf(frame.GetPageID())->pageTable->Delete(frame.GetPageID());
+		}
+
+		frame.EmptyIt();
+		__atomic_store_n(&this->pinStart[frameId], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&this->recLSNs[frameId], INVALID_LSN, __ATOMIC_RELEASE);
+
+		pthread_mutex_lock(&this->replacerLatch);
+		this->replacer->OnFree(frameId);
+		this->freeFrames->MoveToBack(FREE_FRAMES, frameId);
+		pthread_mutex_unlock(&this->replacerLatch);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ForceLog
+//
+// Input    : frames - frames about to be written (or frameId, one)
+//            count  - the number of frames
+// Output   : None
+// Purpose  : Flush the log up to the last change logged for any of the
+//            pages, which must not reach the disk before the log does.
+// Return   : OK if the pages may be written. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::ForceLog(int frameId)
+{
+	Frame* frame = &this->frames[frameId];
+
+	return this->ForceLog(&frame, 1);
+}
+
+Status BufMgr::ForceLog(Frame** frames, int count)
+{
+	Status status = OK;
+	LSN lsn = INVALID_LSN;
+
+	for (int i = 0; NULL != this->log && i < count; i++)
+	{
+		LSN pageLSN = __atomic_load_n(&this->pageLSNs[frames[i] - this->frames], __ATOMIC_ACQUIRE);
+
+		if (pageLSN > lsn)
+		{
+			lsn = pageLSN;
+		}
+	}
+
+	if (INVALID_LSN != lsn)
+	{
+		status = this->log->Flush(lsn);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::StampPage
+//
+// Input    : frameId - a pinned frame
+//            lsn     - the LSN of a change logged for its page
+// Output   : None
+// Purpose  : Raise the LSN of the page to lsn, if lower, and note lsn
+//            as its first change if it has none since it was written.
+//--------------------------------------------------------------------
+
+void BufMgr::StampPage(int frameId, LSN lsn)
+{
+	LSN pageLSN = __atomic_load_n(&this->pageLSNs[frameId], __ATOMIC_RELAXED);
+
+	while (pageLSN < lsn && !__atomic_compare_exchange_n(&this->pageLSNs[frameId], &pageLSN, lsn, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	{
+	}
+
+	LSN recLSN = INVALID_LSN;
+	__atomic_compare_exchange_n(&this->recLSNs[frameId], &recLSN, lsn, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ForgetWrittenChanges
+//
+// Input    : frames - claimed frames, just written back
+//            count  - the number of frames
+// Output   : None
+// Purpose  : Clear the first change of the pages that were written, so
+//            that the log no longer needs to be kept for them.
+//--------------------------------------------------------------------
+
+void BufMgr::ForgetWrittenChanges(Frame** frames, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (!frames[i]->IsDirty())
+		{
+			__atomic_store_n(&this->recLSNs[frames[i] - this->frames], INVALID_LSN, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::GetOldestChangeLSN
+//
+// Input    : None
+// Output   : None
+// Return   : The LSN of the oldest change logged for a page of this
+//            pool that has not been written since, INVALID_LSN if
+//            there is none.
+//--------------------------------------------------------------------
+
+LSN BufMgr::GetOldestChangeLSN()
+{
+	LSN oldest = INVALID_LSN;
+
+	for (int i = 0; i < this->maxNumOfBuf; i++)
+	{
+		LSN lsn = __atomic_load_n(&this->recLSNs[i], __ATOMIC_ACQUIRE);
+
+		if (INVALID_LSN != lsn && (INVALID_LSN == oldest || lsn < oldest))
+		{
+			oldest = lsn;
+		}
+	}
+
+	return oldest;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ApplyImage
+//
+// Input    : pid    - a page id
+//            offset - where the image goes in the page
+//            length - the size of the image
+//            image  - the bytes to put back
+//            txnId  - the transaction being rolled back, which logs
+//                     the change as a compensation; 0 during recovery,
+//                     which does not log it
+//            lsn    - during recovery, the record the image is from
+// Output   : None
+// Purpose  : Copy a before or after image from the log into the page,
+//            and leave the page dirty.
+// Return   : OK if successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::ApplyImage(PageID pid, int offset, int length, const char* image, int txnId, LSN lsn)
+{
+	PageGuard guard;
+	Status status = this->PinPage(pid, guard);
+
+	if (OK == status)
+	{
+		memcpy((char*)guard.page + offset, image, length);
+		guard.DirtyIt();
+
+		if (0 != txnId)
+		{
+			guard.bufMgr->MarkDirty(guard.frameId, pid);
+			status = this->log->Append(txnId, LOG_COMPENSATE, pid, offset, length, NULL, image, lsn);
+		}
+	}
+
+	if (OK == status && INVALID_LSN != lsn)
+	{
+		guard.bufMgr->StampPage(guard.frameId, lsn);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::Recover
+//
+// Input    : None
+// Output   : None
+// Purpose  : Bring the database back to the state the log describes:
+//            repeat every change in it in order, whatever reached the
+//            disk before, then undo the updates of the transactions
+//            that neither committed nor aborted, latest first. Then
+//            take a checkpoint, which empties the log once the pages
+//            are written.
+// Return   : OK if successful. FAIL otherwise; the log is kept, and
+//            recovery can be tried again.
+//--------------------------------------------------------------------
+
+Status BufMgr::Recover()
+{
+	Status status = OK;
+	LSN endLSN = this->log->GetEndLSN();
+	LogRecord record;
+	char* data = NULL;
+
+	HashTable* ended = new HashTable(LOG_MAX_TRANSACTIONS);
+	int maxNumOfUpdates = 64;
+	int numOfUpdates = 0;
+	LSN* updates = new LSN[maxNumOfUpdates];
+
+	// Redo
+	for (LSN lsn = this->log->GetStartLSN(); OK == status && lsn < endLSN; lsn += record.GetSize())
+	{
+		status = this->log->ReadRecord(lsn, record, data);
+
+		if (OK == status)
+		{
+			if (LOG_UPDATE == record.type)
+			{
+				status = this->ApplyImage(record.pid, record.offset, record.length, data + record.length, 0, lsn);
+
+				if (numOfUpdates == maxNumOfUpdates)
+				{
+					LSN* moreUpdates = new LSN[2 * maxNumOfUpdates];
+					memcpy(moreUpdates, updates, numOfUpdates * sizeof(LSN));
+					delete[] updates;
+					updates = moreUpdates;
+					maxNumOfUpdates *= 2;
+				}
+				updates[numOfUpdates++] = lsn;
+			}
+			else if (LOG_COMPENSATE == record.type)
+			{
+				status = this->ApplyImage(record.pid, record.offset, record.length, data, 0, lsn);
+			}
+			else if (INVALID_FRAME == ended->LookUp(record.txnId))
+			{
+				ended->Insert(record.txnId, 1);
+			}
+
+			delete[] data;
+		}
+	}
+
+	// Undo
+	for (int i = numOfUpdates - 1; OK == status && i >= 0; i--)
+	{
+		status = this->log->ReadRecord(updates[i], record, data);
+
+		if (OK == status)
+		{
+			if (INVALID_FRAME == ended->LookUp(record.txnId))
+			{
+				status = this->ApplyImage(record.pid, record.offset, record.length, data, 0, updates[i]);
+			}
+
+			delete[] data;
+		}
+	}
+
+	delete ended;
+	delete[] updates;
+
+	if (OK == status)
+	{
+		status = this->Checkpoint();
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::WriteDirtyFrames
+//
+// Input    : None
+// Output   : None
+// Purpose  : Write back the dirty unpinned pages of this pool, keeping
+//            them in their frames, for a checkpoint. Pages pinned, or
+//            being written by another thread, are left alone.
+//--------------------------------------------------------------------
+
+void BufMgr::WriteDirtyFrames()
+{
+	Frame** dirtyFrames = new Frame*[this->maxNumOfBuf];
+	int numOfDirtyFrames = 0;
+
+	for (int i = 0; i < this->numOfBuf; i++)
+	{
+		if (this->frames[i].IsDirty() && this->frames[i].NotPinned() && this->ClaimFrame(i))
+		{
+			if (this->frames[i].IsDirty())
+			{
+				dirtyFrames[numOfDirtyFrames++] = &this->frames[i];
+			}
+			else
+			{
+				this->UnclaimFrame(i);
+			}
+		}
+	}
+
+	long start = NowInNanoseconds();
+	int numOfWrites = 0;
+	if (OK == this->ForceLog(dirtyFrames, numOfDirtyFrames))
+	{
+		numOfWrites = Frame::WriteFrames(dirtyFrames, numOfDirtyFrames, this->GetIOEngine());
+	}
+
+	// Collect stats
+	if (numOfDirtyFrames > 0)
+	{
+		this->stats.writeLatency.Add(NowInNanoseconds() - start);
+	}
+	__atomic_add_fetch(&this->stats.foregroundWrites, numOfWrites, __ATOMIC_RELAXED);
+
+	this->ForgetWrittenChanges(dirtyFrames, numOfDirtyFrames);
+	for (int i = 0; i < numOfDirtyFrames; i++)
+	{
+		this->UnclaimFrame(dirtyFrames[i] - this->frames);
+	}
+
+	delete[] dirtyFrames;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::LockPartitions
+//
+// Latch the page table partitions of two pages, lower index first. An
+// invalid pid1 is ignored.
+//--------------------------------------------------------------------
+
+void BufMgr::LockPartitions(PageID pid1, PageID pid2)
+{
+	Partition* first = this->PartitionOf(pid2);
+	Partition* second = NULL;
+
+	if (INVALID_PAGE != pid1 && this->PartitionOf(pid1) != first)
+	{
+		second = this->PartitionOf(pid1);
+
+		if (second < first)
+		{
+			Partition* swap = first;
+			first = second;
+			second = swap;
+		}
+	}
+
+	pthread_mutex_lock(&first->latch);
+
+	if (NULL != second)
+	{
+		pthread_mutex_lock(&second->latch);
+	}
+}
+
+
+void BufMgr::UnlockPartitions(PageID pid1, PageID pid2)
+{
+	if (INVALID_PAGE != pid1 && this->PartitionOf(pid1) != this->PartitionOf(pid2))
+	{
+		pthread_mutex_unlock(&this->PartitionOf(pid1)->latch);
+	}
+
+	pthread_mutex_unlock(&this->PartitionOf(pid2)->latch);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ClaimFrame
+//
+// Input    : frameId - an unpinned frame
+// Output   : None
+// Purpose  : Pin the frame, making sure that no other thread has
+//            pinned it in the meantime. The frame is marked as I/O in
+//            progress, so that threads pinning its page wait until the
+//            claim is given up; the replacer is not told.
+// PostCond : The frame still holds its page (if any).
+// Return   : true if the frame was claimed.
+//--------------------------------------------------------------------
+
+bool BufMgr::ClaimFrame(int frameId)
+{
+	Frame& frame = this->frames[frameId];
+	PageID pid = frame.GetPageID();
+	bool claimed = false;
+
+	if (INVALID_PAGE != pid)
+	{
+		// Page hits pin under the partition latch, so nobody can
+		// find the page between the check and the claim
+		Partition* partition = this->PartitionOf(pid);
+
+		pthread_mutex_lock(&partition->latch);
+		claimed = frame.HasPageID(pid) && frame.TryClaim();
+		if (claimed)
+		{
+			frame.SetIOInProgress(true);
+		}
+		pthread_mutex_unlock(&partition->latch);
+	}
+	else if (frame.TryClaim())
+	{
+		// The frame may have been filled and unpinned again since
+		// the caller looked at it
+		claimed = !frame.IsValid();
+		if (claimed)
+		{
+			frame.SetIOInProgress(true);
+		}
+		else
+		{
+			frame.Unpin();
+		}
+	}
+
+	return claimed;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::UnclaimFrame
+//
+// Give up a claim taken by ClaimFrame, waking up the threads waiting
+// for the page. The frame is unpinned last, as it may be claimed again
+// right away.
+//--------------------------------------------------------------------
+
+void BufMgr::UnclaimFrame(int frameId)
+{
+	this->FinishIO(frameId);
+	this->frames[frameId].Unpin();
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ClaimVictim
+//
+// Input    : ring - the access strategy of the miss (may be NULL)
+// Output   : None
+// Purpose  : Claim a frame to reuse: the current frame of the ring if
+//            it still holds the page the ring read into it and is not
+//            pinned, else an empty frame off the free list, or else a
+//            victim picked by the replacer. Clean victims are preferred
+//            while the background writer is on.
+// PostCond : The frame still holds its old page (if any).
+// Return   : The claimed frame, INVALID_FRAME if all frames are pinned.
+//--------------------------------------------------------------------
+
+int BufMgr::ClaimVictim(BufferRing* ring)
+{
+	int cleanSearch = __atomic_load_n(&this->cleanPercent, __ATOMIC_RELAXED) * this->numOfBuf / 100;
+
+	if (NULL != ring)
+	{
+		PageID ringPid;
+		int frameId = ring->GetFrame(ringPid);
+
+		if (INVALID_FRAME != frameId && frameId < this->numOfBuf
+			&& this->frames[frameId].HasPageID(ringPid) && this->ClaimFrame(frameId))
+		{
+			if (this->frames[frameId].HasPageID(ringPid))
+			{
+				return frameId;
+			}
+
+			this->UnclaimFrame(frameId);
+		}
+	}
+
+	for (;;)
+	{
+		pthread_mutex_lock(&this->replacerLatch);
+		int frameId = this->freeFrames->Front(FREE_FRAMES);
+		if (INVALID_INDEX != frameId)
+		{
+			this->freeFrames->Remove(frameId);
+		}
+		pthread_mutex_unlock(&this->replacerLatch);
+
+		if (INVALID_INDEX == frameId)
+		{
+			break;
+		}
+
+		// A victim picked by another miss meanwhile is left alone
+		if (frameId < this->numOfBuf && this->ClaimFrame(frameId))
+		{
+			if (!this->frames[frameId].IsValid())
+			{
+				return frameId;
+			}
+
+			this->UnclaimFrame(frameId);
+		}
+	}
+
+	for (;;)
+	{
+		pthread_mutex_lock(&this->replacerLatch);
+		int frameId = (cleanSearch > 0) ? this->replacer->PickCleanVictim(cleanSearch) : this->replacer->PickVictim();
+		this->stats.victimSearches++;
+		pthread_mutex_unlock(&this->replacerLatch);
+
+		if (INVALID_FRAME == frameId || this->ClaimFrame(frameId))
+		{
+			// The pool may have shrunk since the replacer picked it
+			if (INVALID_FRAME == frameId || frameId < this->numOfBuf)
+			{
+				return frameId;
+			}
+
+			this->UnclaimFrame(frameId);
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::LoadPage
+//
+// Input    : pid      - page id of the page to load
+//            isEmpty  - if true, do not read the page from disk
+//            prefetch - if true, mark the frame as prefetched (before
+//                       the read completes, so that threads waiting
+//                       for the page see the mark)
+//            ring     - access strategy to take the frame from, or NULL
+// Output   : frameId  - the frame the page was loaded into
+// Purpose  : Handle a miss on pid: install the page in a victim frame,
+//            and read it in without holding any latch.
+// PostCond : If frameId is valid, the page resides in it and is pinned
+//            once. If OK is returned with an invalid frameId, another
+//            thread brought the page in first (or the victim was pinned
+//            again) and the caller should look the page up again.
+// Return   : OK if operation is successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::LoadPage(PageID pid, bool isEmpty, bool prefetch, BufferRing* ring, int& frameId)
+{
+	Status status = this->InstallPage(pid, prefetch, ring, frameId);
+
+	if (OK == status && INVALID_FRAME != frameId)
+	{
+		CompressedCache* cache = __atomic_load_n(&this->compressedCache, __ATOMIC_ACQUIRE);
+
+		if (!isEmpty && NULL != cache && cache->Get(pid, (char*)this->frames[frameId].GetPage()))
+		{
+			// Collect stats
+			__atomic_add_fetch(&this->stats.compressedHits, 1, __ATOMIC_RELAXED);
+		}
+		else if (!isEmpty)
+		{
+			long start = NowInNanoseconds();
+			status = this->frames[frameId].Read(pid, this->GetIOEngine());
+			this->stats.readLatency.Add(NowInNanoseconds() - start);
+
+			// Collect stats
+			if (NULL != cache)
+			{
+				__atomic_add_fetch(&this->stats.compressedMisses, 1, __ATOMIC_RELAXED);
+			}
+		}
+		else if (NULL != cache)
+		{
+			cache->Remove(pid);
+		}
+
+		this->FinishLoad(frameId, status);
+
+		if (OK != status)
+		{
+			frameId = INVALID_FRAME;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::InstallPage
+//
+// Input    : pid      - page id of the page to load
+//            prefetch - if true, mark the frame as prefetched
+//            ring     - access strategy to take the frame from, or NULL;
+//                       the frame is recorded in it
+// Output   : frameId  - the frame the page was installed in
+// Purpose  : Claim a victim and, if dirty, write it back while its page
+//            is still in the page table, so that no other thread can
+//            read a stale copy from disk. The page table is then
+//            updated under the latches of both pages.
+// PostCond : If frameId is valid, it holds pid, is pinned once and is
+//            marked as I/O in progress; the caller reads the page in
+//            (or not) and then calls FinishLoad. If OK is returned with
+//            an invalid frameId, another thread brought the page in
+//            first (or the victim was pinned again).
+// Return   : OK if operation is successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::InstallPage(PageID pid, bool prefetch, BufferRing* ring, int& frameId)
+{
+	Status status = OK;
+	frameId = INVALID_FRAME;
+
+	// Find a victim
+	int victimId = this->ClaimVictim(ring);
+
+	if (INVALID_FRAME == victimId)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		Frame& victimFrame = this->frames[victimId];
+		PageID oldPid = victimFrame.GetPageID();
+		CompressedCache* cache = __atomic_load_n(&this->compressedCache, __ATOMIC_ACQUIRE);
+		char* compressed = NULL;
+		int compressedSize = 0;
+
+		if (victimFrame.IsDirty())
+		{
+			// Cleared first, so that changes made while the page is
+			// being written will be noticed below
+			victimFrame.CleanIt();
+
+			long start = NowInNanoseconds();
+			status = this->ForceLog(victimId);
+			if (OK == status)
+			{
+				status = victimFrame.Write(this->GetIOEngine());
+			}
+
+			// Collect stats
+			this->stats.writeLatency.Add(NowInNanoseconds() - start);
+			__atomic_add_fetch(&this->stats.foregroundWrites, 1, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&this->stats.dirtyEvictions, 1, __ATOMIC_RELAXED);
+
+			if (OK != status)
+			{
+				victimFrame.DirtyIt();
+			}
+		}
+
+		// Compressed before latching, and only kept if the page is
+		// replaced while still clean. The room is only taken with a
+		// compressed cache, not on every miss.
+		if (OK == status && NULL != cache && INVALID_PAGE != oldPid)
+		{
+			compressed = new char[COMP_CACHE_MAX_SIZE];
+			compressedSize = CompressedCache::Compress((char*)victimFrame.GetPage(), compressed);
+		}
+
+		bool replaced = false;
+		if (OK == status)
+		{
+			this->LockPartitions(oldPid, pid);
+
+			if (INVALID_FRAME == this->PartitionOf(pid)->pageTable->LookUp(pid)
+				&& victimFrame.HasPageID(oldPid)
+				&& 1 == victimFrame.GetPinCount()
+				&& !victimFrame.IsDirty())
+			{
+				pthread_mutex_lock(&this->replacerLatch);
+
+				if (INVALID_PAGE != oldPid)
+				{
+					this->replacer->OnEvict(victimId);
+					this->PartitionOf(oldPid)->pageTable->Delete(oldPid);
+
+					// Collect stats
+					__atomic_add_fetch(&this->stats.evictions, 1, __ATOMIC_RELAXED);
+				}
+				this->replacer->OnFree(victimId);
+
+				victimFrame.SetPageID(pid);
+				victimFrame.SetPrefetched(prefetch);
+				__atomic_store_n(&this->pageLSNs[victimId], INVALID_LSN, __ATOMIC_RELAXED);
+				__atomic_store_n(&this->recLSNs[victimId], INVALID_LSN, __ATOMIC_RELEASE);
+				this->PartitionOf(pid)->pageTable->Insert(pid, victimId);
+				this->replacer->SetPriority(victimId, PRIORITY_NORMAL);
+				this->replacer->OnLoad(victimId);
+				this->freeFrames->Remove(victimId);
+
+				pthread_mutex_unlock(&this->replacerLatch);
+
+				replaced = true;
+
+				// Still under the latch of oldPid, so that the page
+				// cannot be read back in before it is in the cache
+				if (compressedSize > 0)
+				{
+					cache->Put(oldPid, compressed, compressedSize);
+				}
+			}
+
+			this->UnlockPartitions(oldPid, pid);
+		}
+
+		delete[] compressed;
+
+		if (!replaced)
+		{
+			// Give the victim up; the replacer never saw the claim
+			this->UnclaimFrame(victimId);
+		}
+		else
+		{
+			frameId = victimId;
+
+			if (NULL != ring)
+			{
+				ring->Record(victimId, pid);
+			}
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::FinishLoad
+//
+// Input    : frameId - a frame set up by InstallPage
+//            status  - the outcome of reading the page in
+// Output   : None
+// Purpose  : Wake up the threads waiting for the page. If the read
+//            failed, the page is taken out of the page table again
+//            first, so that they find the frame empty, and the frame
+//            is released.
+//--------------------------------------------------------------------
+
+void BufMgr::FinishLoad(int frameId, Status status)
+{
+	Frame& frame = this->frames[frameId];
+
+	if (OK != status)
+	{
+		PageID pid = frame.GetPageID();
+		Partition* partition = this->PartitionOf(pid);
+
+		pthread_mutex_lock(&partition->latch);
+		pthread_mutex_lock(&this->replacerLatch);
+
+		partition->pageTable->Delete(pid);
+		frame.SetPageID(INVALID_PAGE);
+		frame.CleanIt();
+		frame.SetPrefetched(false);
+		this->replacer->OnFree(frameId);
+		this->freeFrames->MoveToBack(FREE_FRAMES, frameId);
+
+		pthread_mutex_unlock(&this->replacerLatch);
+		pthread_mutex_unlock(&partition->latch);
+	}
+
+	this->FinishIO(frameId);
+
+	if (OK != status)
+	{
+		this->ReleaseFrame(frameId);
+	}
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::ReleaseFrame
+//
+// Input    : frameId - a frame pinned by the caller
+// Output   : None
+// Purpose  : Unpin the frame, and tell the replacer if it holds a page
+//            and nobody has pinned it again since.
+// Return   : OK if the frame was pinned. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status BufMgr::ReleaseFrame(int frameId)
+{
+	int pinCount = this->frames[frameId].Unpin();
+
+	if (0 == pinCount && 0 != __atomic_load_n(&this->pinStart[frameId], __ATOMIC_RELAXED))
+	{
+		long start = __atomic_exchange_n(&this->pinStart[frameId], 0, __ATOMIC_RELAXED);
+
+		if (0 != start)
+		{
+			// Collect stats
+			this->stats.pinHoldTime.Add(NowInNanoseconds() - start);
+		}
+	}
+
+	if (0 == pinCount && this->latchFreeHooks)
+	{
+		// The partition latch keeps the page in the frame, and Resize
+		// from replacing the replacer meanwhile
+		PageID pid = this->frames[frameId].GetPageID();
+
+		if (INVALID_PAGE != pid)
+		{
+			Partition* partition = this->PartitionOf(pid);
+
+			pthread_mutex_lock(&partition->latch);
+			if (this->frames[frameId].NotPinned() && this->frames[frameId].HasPageID(pid) && frameId < this->numOfBuf)
+			{
+				this->replacer->OnUnpin(frameId);
+			}
+			pthread_mutex_unlock(&partition->latch);
+		}
+	}
+	else if (0 == pinCount)
+	{
+		pthread_mutex_lock(&this->replacerLatch);
+		if (this->frames[frameId].NotPinned() && this->frames[frameId].IsValid() && frameId < this->numOfBuf)
+		{
+			this->replacer->OnUnpin(frameId);
+		}
+		pthread_mutex_unlock(&this->replacerLatch);
+	}
 
+	return (pinCount < 0) ? FAIL : OK;
+}
 
 
 //--------------------------------------------------------------------
-// BufMgr::FlushAllPages
+// BufMgr::WaitForIO
 //
-// Input    : None
+// Block until the frame is no longer marked as I/O in progress.
+//--------------------------------------------------------------------
+
+void BufMgr::WaitForIO(int frameId)
+{
+	if (this->frames[frameId].IsIOInProgress())
+	{
+		IOLatch* io = &this->ioLatches[frameId % BUF_IO_LATCHES];
+
+		pthread_mutex_lock(&io->latch);
+		while (this->frames[frameId].IsIOInProgress())
+		{
+			pthread_cond_wait(&io->done, &io->latch);
+		}
+		pthread_mutex_unlock(&io->latch);
+	}
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::FinishIO
+//
+// Clear the I/O in progress mark of the frame and wake up the threads
+// waiting for it.
+//--------------------------------------------------------------------
+
+void BufMgr::FinishIO(int frameId)
+{
+	IOLatch* io = &this->ioLatches[frameId % BUF_IO_LATCHES];
+
+	pthread_mutex_lock(&io->latch);
+	this->frames[frameId].SetIOInProgress(false);
+	pthread_cond_broadcast(&io->done);
+	pthread_mutex_unlock(&io->latch);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::RunPrefetcher
+//
+// Body of the I/O thread: read the queued pages into the pool, leaving
+// them unpinned, and those of the warm-up list whenever the queue is
+// empty and the pool is not full, until the buffer manager is
+// destroyed.
+//--------------------------------------------------------------------
+
+void* BufMgr::RunPrefetcher(void* arg)
+{
+	BufMgr* bufMgr = (BufMgr*)arg;
+
+	pthread_mutex_lock(&bufMgr->prefetchLatch);
+
+	while (!bufMgr->prefetcherStop)
+	{
+		// Warming up stops once pages are replaced: the pool is full,
+		// and the pages in use matter more than those on the list
+		if (bufMgr->warmUpNext < bufMgr->warmUpCount
+			&& bufMgr->warmUpEvictions != __atomic_load_n(&bufMgr->stats.evictions, __ATOMIC_RELAXED))
+		{
+			bufMgr->warmUpNext = bufMgr->warmUpCount;
+		}
+
+		if (0 == bufMgr->prefetchCount && bufMgr->warmUpNext == bufMgr->warmUpCount)
+		{
+			pthread_cond_wait(&bufMgr->prefetchQueued, &bufMgr->prefetchLatch);
+			continue;
+		}
+
+		PageID pids[BUF_PREFETCH_BATCH];
+		int numOfPids = 0;
+
+		// Without an I/O engine there is no point in taking more than
+		// one page at a time
+		int batchSize = __atomic_load_n(&bufMgr->numOfBuf, __ATOMIC_RELAXED) / 8;
+
+		if (batchSize > BUF_PREFETCH_BATCH)
+		{
+			batchSize = BUF_PREFETCH_BATCH;
+		}
+
+		if (batchSize < 1 || NULL == bufMgr->GetIOEngine())
+		{
+			batchSize = 1;
+		}
+
+		// Prefetch requests go before warming up
+		while (numOfPids < batchSize && bufMgr->prefetchCount > 0)
+		{
+			pids[numOfPids++] = bufMgr->prefetchQueue[bufMgr->prefetchHead];
+			bufMgr->prefetchHead = (bufMgr->prefetchHead + 1) % BUF_PREFETCH_QUEUE;
+			bufMgr->prefetchCount--;
+		}
+
+		while (numOfPids < batchSize && bufMgr->warmUpNext < bufMgr->warmUpCount)
+		{
+			pids[numOfPids++] = bufMgr->warmUpPids[bufMgr->warmUpNext++];
+		}
+
+		pthread_mutex_unlock(&bufMgr->prefetchLatch);
+
+		bufMgr->PrefetchPages(pids, numOfPids);
+
+		pthread_mutex_lock(&bufMgr->prefetchLatch);
+	}
+
+	pthread_mutex_unlock(&bufMgr->prefetchLatch);
+
+	return NULL;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::PrefetchPages
+//
+// Input    : pids  - pages to bring in; sorted on return
+//            count - number of pages, at most BUF_PREFETCH_BATCH
 // Output   : None
-// Purpose  : Flush all pages in this buffer pool to disk.
-// Condition: All pages in the buffer pool must not be pinned.
-// PostCond : All dirty pages in the buffer pool are written to 
-//            disk (even if some pages are pinned). All frames are empty.
-// Return   : OK if operation is successful.  FAIL otherwise.
+// Purpose  : Install the pages that are not in the pool yet, serve
+//            those in the compressed tier from it, and read the others
+//            in with a single ReadFrames, so that an I/O engine has all
+//            of them in flight at once.
+// PostCond : The pages read in are resident and unpinned.
 //--------------------------------------------------------------------
 
-Status BufMgr::FlushAllPages()
+void BufMgr::PrefetchPages(PageID* pids, int count)
 {
-	bool success = true;
-	for (int i = 0; i < this->numOfBuf; i++)
+	Frame* toRead[BUF_PREFETCH_BATCH];
+	int numOfReads = 0;
+	CompressedCache* cache = __atomic_load_n(&this->compressedCache, __ATOMIC_ACQUIRE);
+
+	// In page id order, so that consecutive pages are read together
+	qsort(pids, count, sizeof(PageID), ComparePageIDs);
+
+	for (int i = 0; i < count; i++)
 	{
-		if (this->frames[i].IsValid())
+		int frameId = INVALID_FRAME;
+
+		// Read-ahead may run past the end of the database; one page
+		// that cannot be read would fail the whole batch
+		if (pids[i] < 0 || pids[i] >= MINIBASE_DB->GetNumOfPages())
+		{
+			continue;
+		}
+
+		if (OK == this->InstallPage(pids[i], true, NULL, frameId) && INVALID_FRAME != frameId)
 		{
-			success &= this->frames[i].NotPinned();
-			success &= (this->FlushFrame(i, true) == OK);
+			if (NULL != cache && cache->Get(pids[i], (char*)this->frames[frameId].GetPage()))
+			{
+				this->FinishLoad(frameId, OK);
+				this->ReleaseFrame(frameId);
+
+				// Collect stats
+				__atomic_add_fetch(&this->stats.compressedHits, 1, __ATOMIC_RELAXED);
+				__atomic_add_fetch(&this->stats.prefetches, 1, __ATOMIC_RELAXED);
+			}
+			else
+			{
+				toRead[numOfReads++] = &this->frames[frameId];
 
-			frames[i].EmptyIt();
+				// Collect stats
+				if (NULL != cache)
+				{
+					__atomic_add_fetch(&this->stats.compressedMisses, 1, __ATOMIC_RELAXED);
+				}
+			}
 		}
 	}
 
-	return success ? OK : FAIL;
+	if (numOfReads > 0)
+	{
+		long start = NowInNanoseconds();
+		Status status = Frame::ReadFrames(toRead, numOfReads, this->GetIOEngine());
+		this->stats.readLatency.Add(NowInNanoseconds() - start);
+
+		for (int i = 0; i < numOfReads; i++)
+		{
+			int frameId = toRead[i] - this->frames;
+
+			this->FinishLoad(frameId, status);
+
+			if (OK == status)
+			{
+				this->ReleaseFrame(frameId);
+
+				// Collect stats
+				__atomic_add_fetch(&this->stats.prefetches, 1, __ATOMIC_RELAXED);
+			}
+		}
+	}
 }
 
 
 //--------------------------------------------------------------------
-// BufMgr::GetNumOfUnpinnedFrames
+// BufMgr::ReadAhead
 //
-// Input    : None
+// Input    : pid - a page PinPage has just read in, or found in the
+//                  buffer because it was prefetched
 // Output   : None
-// Purpose  : Find out how many unpinned locations are in the buffer
-//            pool.
-// Condition: None
-// PostCond : None
-// Return   : The number of unpinned buffers in the buffer pool.
+// Purpose  : Detect sequential reading. Once BUF_READ_AHEAD_TRIGGER
+//            consecutive pages have been read, prefetch the pages up
+//            to readAheadPages beyond pid that have not been requested
+//            yet. Hits on prefetched pages keep the run going, so the
+//            window slides along with the reader.
 //--------------------------------------------------------------------
 
-unsigned int BufMgr::GetNumOfUnpinnedFrames()
+void BufMgr::ReadAhead(PageID pid)
 {
-	int numOfUnpinnedFrames = 0;
+	PageID start = INVALID_PAGE;
+	int count = 0;
 
-	for (int i = 0; i < this->numOfBuf; i++)
+	pthread_mutex_lock(&this->prefetchLatch);
+
+	if (INVALID_PAGE != this->lastReadPid && pid == this->lastReadPid + 1)
+	{
+		this->sequentialReads++;
+	}
+	else
 	{
-		// Used only for test case; does not really make sense (see bmtest.cpp, Test2).
-		if (!this->frames[i].IsValid() || this->frames[i].NotPinned())
+		this->sequentialReads = 1;
+		this->readAheadEnd = pid + 1;
+	}
+	this->lastReadPid = pid;
+
+	if (this->readAheadPages > 0 && this->sequentialReads >= BUF_READ_AHEAD_TRIGGER)
+	{
+		if (this->readAheadEnd <= pid)
+		{
+			this->readAheadEnd = pid + 1;
+		}
+
+		start = this->readAheadEnd;
+		count = pid + 1 + this->readAheadPages - start;
+
+		if (count > 0)
 		{
-			numOfUnpinnedFrames++;
+			this->readAheadEnd = start + count;
 		}
 	}
 
-	return numOfUnpinnedFrames;
+	pthread_mutex_unlock(&this->prefetchLatch);
+
+	if (count > 0)
+	{
+		this->Prefetch(start, count);
+	}
 }
 
 
-void  BufMgr::PrintStat() {
-	cout << "**Buffer Manager Statistics**" << endl;
-	cout << "Number of Dirty Pages Written to Disk: " << numDirtyPageWrites << endl;
-	cout << "Number of Pin Page Requests: " << totalCall << endl;
-	cout << "Number of Pin Page Request Misses " << totalMiss << endl;
+//--------------------------------------------------------------------
+// BufMgr::ListResidentPages
+//
+// Input    : max   - room in pids and ranks
+// Output   : pids  - the pages in the pool
+//            ranks - for each, 0 for the most recently used page on:
+//                    the pinned pages, then the others in the reverse
+//                    of the order the replacer would replace them
+// Return   : The number of pages listed.
+//--------------------------------------------------------------------
+
+int BufMgr::ListResidentPages(PageID* pids, int* ranks, int max)
+{
+	int count = 0;
+
+	pthread_mutex_lock(&this->replacerLatch);
+
+	int numOfFrames = this->numOfBuf;
+	int* order = new int[numOfFrames];
+	bool* unpinned = new bool[numOfFrames];
+	int numOfVictims = this->replacer->NextVictims(order, numOfFrames);
+
+	for (int i = 0; i < numOfFrames; i++)
+	{
+		unpinned[i] = false;
+	}
+
+	for (int i = 0; i < numOfVictims; i++)
+	{
+		unpinned[order[i]] = true;
+	}
+
+	for (int i = 0; i < numOfFrames && count < max; i++)
+	{
+		PageID pid = this->frames[i].GetPageID();
+
+		if (INVALID_PAGE != pid && !unpinned[i])
+		{
+			pids[count] = pid;
+			ranks[count] = count;
+			count++;
+		}
+	}
+
+	for (int i = numOfVictims - 1; i >= 0 && count < max; i--)
+	{
+		PageID pid = this->frames[order[i]].GetPageID();
+
+		if (INVALID_PAGE != pid)
+		{
+			pids[count] = pid;
+			ranks[count] = count;
+			count++;
+		}
+	}
+
+	pthread_mutex_unlock(&this->replacerLatch);
+
+	delete[] order;
+	delete[] unpinned;
+
+	return count;
 }
 
+
 //--------------------------------------------------------------------
-// BufMgr::FindFrame
+// BufMgr::QueueWarmUp
 //
-// Input    : pid - a page id 
+// Input    : pids  - pages to read in, allocated with new[]; the pool
+//                    owns them from now on
+//            count - the number of pages
 // Output   : None
-// Purpose  : Look for the page in the buffer pool, return the frame
-//            number if found.
-// PreCond  : None
-// PostCond : None
-// Return   : the frame number if found. INVALID_FRAME otherwise.
+// Purpose  : Replace the warm-up list of the prefetcher, starting it
+//            if need be.
+// Return   : FAIL if the prefetcher cannot be started.
 //--------------------------------------------------------------------
 
-int BufMgr::FindFrame(PageID pid)
+Status BufMgr::QueueWarmUp(PageID* pids, int count)
 {
-	for (int i = 0; i < this->numOfBuf; i++)
+	Status status = OK;
+
+	pthread_mutex_lock(&this->prefetchLatch);
+
+	delete[] this->warmUpPids;
+	this->warmUpPids = pids;
+	this->warmUpCount = count;
+	this->warmUpNext = 0;
+	this->warmUpEvictions = __atomic_load_n(&this->stats.evictions, __ATOMIC_RELAXED);
+
+	if (count > 0 && !this->prefetcherRunning && !this->prefetcherStop)
+	{
+		this->prefetcherRunning = (0 == pthread_create(&this->prefetcher, NULL, BufMgr::RunPrefetcher, this));
+	}
+
+	if (count > 0 && !this->prefetcherRunning)
+	{
+		status = FAIL;
+	}
+
+	pthread_cond_signal(&this->prefetchQueued);
+	pthread_mutex_unlock(&this->prefetchLatch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::PinMappedRun
+//
+// PinRun in mapped mode: pin the pages one by one, and unpin them all
+// again if one of them cannot be pinned.
+//--------------------------------------------------------------------
+
+Status BufMgr::PinMappedRun(PageID firstPid, int count, Page** pages, int pageClass)
+{
+	Status status = (count < 1) ? FAIL : OK;
+	int numOfPinned = 0;
+
+	while (OK == status && numOfPinned < count)
 	{
-		if (this->frames[i].GetPageID() == pid)
+		status = this->PinPage(firstPid + numOfPinned, pages[numOfPinned], false, pageClass);
+
+		if (OK == status)
 		{
-			return i;
+			numOfPinned++;
 		}
 	}
 
-	return INVALID_FRAME;
+	if (OK != status)
+	{
+		for (int i = 0; i < numOfPinned; i++)
+		{
+			this->mapping->Unpin(firstPid + i);
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			pages[i] = NULL;
+		}
+	}
+
+	return status;
 }
 
 
-Status BufMgr::FlushFrame(int frameId, bool ignorePinned)
+//--------------------------------------------------------------------
+// BufMgr::StartWriter
+//
+// Start the background writer, unless it is running or turned off. It
+// is started when the first page is unpinned dirty.
+//--------------------------------------------------------------------
+
+void BufMgr::StartWriter()
 {
-	Status status = OK;
+	pthread_mutex_lock(&this->writerLatch);
 
-	// If we care about flushing pinned pages and the frame is pinned - fail.
-	if (OK == status)
+	if (!this->writerRunning && !this->writerStop && __atomic_load_n(&this->cleanPercent, __ATOMIC_RELAXED) > 0)
+	{
+		bool running = (0 == pthread_create(&this->writer, NULL, BufMgr::RunWriter, this));
+		__atomic_store_n(&this->writerRunning, running, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&this->writerLatch);
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::RunWriter
+//
+// Body of the background writer, until the buffer manager is
+// destroyed. Rounds follow each other as long as they find pages to
+// write; after a round with nothing to do the writer sleeps for
+// BUF_WRITER_DELAY_MS milliseconds. It is not woken up by misses, as
+// that would cost a context switch per dirty eviction.
+//--------------------------------------------------------------------
+
+void* BufMgr::RunWriter(void* arg)
+{
+	BufMgr* bufMgr = (BufMgr*)arg;
+	int* candidates = new int[bufMgr->maxNumOfBuf];
+	Frame** dirtyFrames = new Frame*[bufMgr->maxNumOfBuf];
+
+	pthread_mutex_lock(&bufMgr->writerLatch);
+
+	while (!bufMgr->writerStop)
 	{
-		if (!ignorePinned && !this->frames[frameId].NotPinned())
+		pthread_mutex_unlock(&bufMgr->writerLatch);
+		int numOfWrites = bufMgr->CleanFrames(candidates, dirtyFrames);
+		pthread_mutex_lock(&bufMgr->writerLatch);
+
+		if (!bufMgr->writerStop && 0 == numOfWrites)
 		{
-			status = FAIL;
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+
+			deadline.tv_nsec += BUF_WRITER_DELAY_MS * 1000000L;
+			deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+			deadline.tv_nsec %= 1000000000L;
+
+			pthread_cond_timedwait(&bufMgr->writerWake, &bufMgr->writerLatch, &deadline);
 		}
 	}
 
-	// Flush the frame to disk
-	if (OK == status)
+	pthread_mutex_unlock(&bufMgr->writerLatch);
+	delete[] candidates;
+	delete[] dirtyFrames;
+
+	return NULL;
+}
+
+
+//--------------------------------------------------------------------
+// BufMgr::CleanFrames
+//
+// Input    : candidates  - room for maxNumOfBuf frame numbers
+//            dirtyFrames - room for maxNumOfBuf frames
+// Output   : None
+// Purpose  : One round of the background writer: write the dirty ones
+//            among the next cleanPercent of the pool's frames to be
+//            replaced, in page id order. The frames are claimed while
+//            they are written, so they cannot be evicted or freed
+//            meanwhile.
+// Return   : The number of pages written.
+//--------------------------------------------------------------------
+
+int BufMgr::CleanFrames(int* candidates, Frame** dirtyFrames)
+{
+	int numOfDirtyFrames = 0;
+	int window = __atomic_load_n(&this->cleanPercent, __ATOMIC_RELAXED) * this->numOfBuf / 100;
+
+	pthread_mutex_lock(&this->replacerLatch);
+	int numOfCandidates = this->replacer->NextVictims(candidates, window);
+	pthread_mutex_unlock(&this->replacerLatch);
+
+	for (int i = 0; i < numOfCandidates; i++)
 	{
+		int frameId = candidates[i];
 		Frame& frame = this->frames[frameId];
 
-		if (frame.IsDirty())
+		if (frame.NotPinned() && frame.IsDirty() && this->ClaimFrame(frameId))
 		{
-			// Collect stats
-			numDirtyPageWrites++;
-
-			status = frame.Write();
+			if (frame.IsDirty())
+			{
+				dirtyFrames[numOfDirtyFrames++] = &frame;
+			}
+			else
+			{
+				this->UnclaimFrame(frameId);
+			}
 		}
+	}
 
-		frame.EmptyIt();
+	long start = NowInNanoseconds();
+	int numOfWrites = 0;
+	if (OK == this->ForceLog(dirtyFrames, numOfDirtyFrames))
+	{
+		numOfWrites = Frame::WriteFrames(dirtyFrames, numOfDirtyFrames, this->GetIOEngine());
 	}
 
-	return status;
+	// Collect stats
+	if (numOfDirtyFrames > 0)
+	{
+		this->stats.writeLatency.Add(NowInNanoseconds() - start);
+	}
+	__atomic_add_fetch(&this->stats.backgroundWrites, numOfWrites, __ATOMIC_RELAXED);
+
+	this->ForgetWrittenChanges(dirtyFrames, numOfDirtyFrames);
+	for (int i = 0; i < numOfDirtyFrames; i++)
+	{
+		this->UnclaimFrame(dirtyFrames[i] - this->frames);
+	}
+
+	return numOfWrites;
 }
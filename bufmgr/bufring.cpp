@@ -0,0 +1,58 @@
+#include "../include/bufring.h"
+#include "../include/frame.h"
+
+BufferRing::BufferRing(int numOfFrames)
+{
+	this->numOfFrames = (numOfFrames > 0) ? numOfFrames : 1;
+	this->frameIds = new int[this->numOfFrames];
+	this->pids = new PageID[this->numOfFrames];
+	this->current = 0;
+
+	for (int i = 0; i < this->numOfFrames; i++)
+	{
+		this->frameIds[i] = INVALID_FRAME;
+		this->pids[i] = INVALID_PAGE;
+	}
+}
+
+
+BufferRing::~BufferRing()
+{
+	delete[] this->frameIds;
+	delete[] this->pids;
+}
+
+
+//--------------------------------------------------------------------
+// BufferRing::GetFrame
+//
+// Input    : None
+// Output   : pid - the page read into the frame by the ring
+// Return   : The frame of the current slot, INVALID_FRAME while the
+//            ring is not full yet.
+//--------------------------------------------------------------------
+
+int BufferRing::GetFrame(PageID& pid)
+{
+	pid = this->pids[this->current];
+
+	return this->frameIds[this->current];
+}
+
+
+//--------------------------------------------------------------------
+// BufferRing::Record
+//
+// Input    : frameId - the frame a miss has just read pid into
+//            pid     - the page
+// Output   : None
+// Purpose  : Remember the frame in the current slot and move on to
+//            the next one.
+//--------------------------------------------------------------------
+
+void BufferRing::Record(int frameId, PageID pid)
+{
+	this->frameIds[this->current] = frameId;
+	this->pids[this->current] = pid;
+	this->current = (this->current + 1) % this->numOfFrames;
+}
@@ -0,0 +1,398 @@
+#include <string.h>
+
+#include "../include/compcache.h"
+
+// LZ4 block format: a match is at least 4 bytes long, and the last 5
+// bytes of the input are always literals.
+#define LZ_MIN_MATCH      4
+#define LZ_LAST_LITERALS  5
+#define LZ_HASH_BITS      10
+
+static unsigned int Read32(const char* p)
+{
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+
+	return value;
+}
+
+
+static unsigned long long Read64(const char* p)
+{
+	unsigned long long value;
+	memcpy(&value, p, sizeof(value));
+
+	return value;
+}
+
+
+static unsigned int HashSequence(unsigned int value)
+{
+	return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+
+// Append a length of 15 or more as a run of bytes, 255 meaning more.
+static int PutLength(char* out, int op, int length)
+{
+	for (length -= 15; length >= 255; length -= 255)
+	{
+		out[op++] = (char)255;
+	}
+	out[op++] = (char)length;
+
+	return op;
+}
+
+
+//--------------------------------------------------------------------
+// Append one sequence: literal bytes followed by a match of length
+// matchLength at the given offset back, or by nothing if matchLength
+// is 0. Returns the new output size, 0 if it does not fit.
+//--------------------------------------------------------------------
+
+static int PutSequence(char* out, int op, const char* literals, int numOfLiterals, int offset, int matchLength)
+{
+	// Token, length bytes, literals and offset, in the worst case
+	int needed = 1 + numOfLiterals / 255 + 1 + numOfLiterals + 2 + matchLength / 255 + 1;
+
+	if (op + needed > COMP_CACHE_MAX_SIZE)
+	{
+		return 0;
+	}
+
+	int extra = (matchLength > 0) ? matchLength - LZ_MIN_MATCH : 0;
+	int token = op++;
+
+	out[token] = (char)(((numOfLiterals < 15 ? numOfLiterals : 15) << 4) | (extra < 15 ? extra : 15));
+
+	if (numOfLiterals >= 15)
+	{
+		op = PutLength(out, op, numOfLiterals);
+	}
+
+	memcpy(out + op, literals, numOfLiterals);
+	op += numOfLiterals;
+
+	if (matchLength > 0)
+	{
+		out[op++] = (char)(offset & 0xff);
+		out[op++] = (char)(offset >> 8);
+
+		if (extra >= 15)
+		{
+			op = PutLength(out, op, extra);
+		}
+	}
+
+	return op;
+}
+
+
+//--------------------------------------------------------------------
+// Constructor for CompressedCache
+//
+// Input   : numOfBytes - budget for the compressed pages
+// Output  : None
+// PostCond: The cache is empty.
+//--------------------------------------------------------------------
+
+CompressedCache::CompressedCache(int numOfBytes)
+{
+	this->numOfBytes = (numOfBytes > 0) ? numOfBytes : 0;
+	this->numOfUsedBytes = 0;
+	this->numOfSlots = this->numOfBytes / COMP_CACHE_MIN_SIZE + 1;
+	this->pids = new PageID[this->numOfSlots];
+	this->data = new char*[this->numOfSlots];
+	this->sizes = new int[this->numOfSlots];
+	this->index = new HashTable(this->numOfSlots);
+	this->order = new IndexLists(this->numOfSlots, 2);
+	pthread_mutex_init(&this->latch, NULL);
+
+	for (int i = 0; i < this->numOfSlots; i++)
+	{
+		this->pids[i] = INVALID_PAGE;
+		this->data[i] = NULL;
+		this->sizes[i] = 0;
+		this->order->PushBack(UNUSED, i);
+	}
+}
+
+
+CompressedCache::~CompressedCache()
+{
+	for (int i = 0; i < this->numOfSlots; i++)
+	{
+		delete[] this->data[i];
+	}
+
+	delete[] this->pids;
+	delete[] this->data;
+	delete[] this->sizes;
+	delete this->index;
+	delete this->order;
+	pthread_mutex_destroy(&this->latch);
+}
+
+
+//--------------------------------------------------------------------
+// CompressedCache::Put
+//
+// Input    : pid        - page id of a clean page leaving the pool
+//            compressed - the page, as compressed by Compress
+//            size       - the compressed size
+// Output   : None
+// Purpose  : Keep the page, replacing any older copy, and dropping the
+//            oldest pages as needed to stay within the budget.
+// Return   : true if the page was kept.
+//--------------------------------------------------------------------
+
+bool CompressedCache::Put(PageID pid, const char* compressed, int size)
+{
+	bool kept = false;
+
+	pthread_mutex_lock(&this->latch);
+	int slot = this->index->LookUp(pid);
+
+	if (INVALID_FRAME != slot)
+	{
+		this->FreeSlot(slot);
+	}
+
+	if (size > 0 && size <= this->numOfBytes)
+	{
+		while (this->numOfUsedBytes + size > this->numOfBytes || 0 == this->order->Size(UNUSED))
+		{
+			this->FreeSlot(this->order->Front(USED));
+		}
+
+		slot = this->order->Front(UNUSED);
+		this->order->MoveToBack(USED, slot);
+		this->pids[slot] = pid;
+		this->data[slot] = new char[size];
+		this->sizes[slot] = size;
+		memcpy(this->data[slot], compressed, size);
+		this->index->Insert(pid, slot);
+		this->numOfUsedBytes += size;
+
+		kept = true;
+	}
+	pthread_mutex_unlock(&this->latch);
+
+	return kept;
+}
+
+
+//--------------------------------------------------------------------
+// CompressedCache::Get
+//
+// Input    : pid  - page id of a page the pool misses on
+// Output   : page - the page, if it was in the cache
+// Purpose  : Hand the page back to the pool; the cache forgets it.
+// Return   : true if the page was in the cache.
+//--------------------------------------------------------------------
+
+bool CompressedCache::Get(PageID pid, char* page)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&this->latch);
+	int slot = this->index->LookUp(pid);
+
+	if (INVALID_FRAME != slot)
+	{
+		found = Decompress(this->data[slot], this->sizes[slot], page);
+		this->FreeSlot(slot);
+	}
+	pthread_mutex_unlock(&this->latch);
+
+	return found;
+}
+
+
+//--------------------------------------------------------------------
+// CompressedCache::Remove
+//
+// Forget the page, if it is in the cache: it is about to be read or
+// overwritten by other means, or has been freed.
+//--------------------------------------------------------------------
+
+void CompressedCache::Remove(PageID pid)
+{
+	pthread_mutex_lock(&this->latch);
+	int slot = this->index->LookUp(pid);
+
+	if (INVALID_FRAME != slot)
+	{
+		this->FreeSlot(slot);
+	}
+	pthread_mutex_unlock(&this->latch);
+}
+
+
+void CompressedCache::FreeSlot(int slot)
+{
+	this->index->Delete(this->pids[slot]);
+	this->numOfUsedBytes -= this->sizes[slot];
+
+	delete[] this->data[slot];
+	this->data[slot] = NULL;
+	this->pids[slot] = INVALID_PAGE;
+	this->sizes[slot] = 0;
+
+	this->order->MoveToBack(UNUSED, slot);
+}
+
+
+//--------------------------------------------------------------------
+// CompressedCache::Compress
+//
+// Input    : page       - MINIBASE_PAGESIZE bytes to compress
+// Output   : compressed - room for COMP_CACHE_MAX_SIZE bytes
+// Purpose  : Greedy LZ77 with a hash table of the last position of
+//            each 4-byte sequence, emitting LZ4 block sequences.
+// Return   : The compressed size, 0 if it would exceed
+//            COMP_CACHE_MAX_SIZE.
+//--------------------------------------------------------------------
+
+int CompressedCache::Compress(const char* page, char* compressed)
+{
+	// Positions plus one, 0 for none
+	unsigned short table[1 << LZ_HASH_BITS];
+	const int matchLimit = MINIBASE_PAGESIZE - LZ_LAST_LITERALS;
+
+	memset(table, 0, sizeof(table));
+
+	int ip = 0;
+	int anchor = 0;
+	int op = 0;
+
+	while (ip + LZ_MIN_MATCH <= matchLimit)
+	{
+		unsigned int sequence = Read32(page + ip);
+		unsigned int h = HashSequence(sequence);
+		int ref = (int)table[h] - 1;
+
+		table[h] = (unsigned short)(ip + 1);
+
+		if (ref >= 0 && Read32(page + ref) == sequence)
+		{
+			int length = LZ_MIN_MATCH;
+
+			// Eight bytes at a time, then the first that differs
+			while (ip + length + 8 <= matchLimit && Read64(page + ref + length) == Read64(page + ip + length))
+			{
+				length += 8;
+			}
+
+			while (ip + length < matchLimit && page[ref + length] == page[ip + length])
+			{
+				length++;
+			}
+
+			op = PutSequence(compressed, op, page + anchor, ip - anchor, ip - ref, length);
+
+			if (0 == op)
+			{
+				return 0;
+			}
+
+			ip += length;
+			anchor = ip;
+		}
+		else
+		{
+			ip++;
+		}
+	}
+
+	return PutSequence(compressed, op, page + anchor, MINIBASE_PAGESIZE - anchor, 0, 0);
+}
+
+
+//--------------------------------------------------------------------
+// CompressedCache::Decompress
+//
+// Input    : compressed - a page compressed by Compress
+//            size       - its compressed size
+// Output   : page       - MINIBASE_PAGESIZE bytes
+// Return   : true if the input decoded to exactly one page.
+//--------------------------------------------------------------------
+
+bool CompressedCache::Decompress(const char* compressed, int size, char* page)
+{
+	const unsigned char* in = (const unsigned char*)compressed;
+	int ip = 0;
+	int op = 0;
+
+	while (ip < size)
+	{
+		int token = in[ip++];
+		int length = token >> 4;
+
+		if (15 == length)
+		{
+			int b = 255;
+			while (255 == b && ip < size)
+			{
+				b = in[ip++];
+				length += b;
+			}
+		}
+
+		if (op + length > MINIBASE_PAGESIZE || ip + length > size)
+		{
+			return false;
+		}
+
+		memcpy(page + op, in + ip, length);
+		ip += length;
+		op += length;
+
+		// The last sequence has no match
+		if (ip == size)
+		{
+			break;
+		}
+
+		if (ip + 2 > size)
+		{
+			return false;
+		}
+
+		int offset = in[ip] | (in[ip + 1] << 8);
+		ip += 2;
+
+		length = token & 15;
+		if (15 == length)
+		{
+			int b = 255;
+			while (255 == b && ip < size)
+			{
+				b = in[ip++];
+				length += b;
+			}
+		}
+		length += LZ_MIN_MATCH;
+
+		if (0 == offset || offset > op || op + length > MINIBASE_PAGESIZE)
+		{
+			return false;
+		}
+
+		// The match may overlap what it produces: copy what lies
+		// between its start and the output so far, twice as much
+		// each time
+		int from = op - offset;
+		while (length > 0)
+		{
+			int chunk = (op - from < length) ? op - from : length;
+
+			memcpy(page + op, page + from, chunk);
+			op += chunk;
+			length -= chunk;
+		}
+	}
+
+	return MINIBASE_PAGESIZE == op;
+}
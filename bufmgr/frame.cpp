@@ -1,9 +1,27 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include "../include/frame.h"
 #include "../include/db.h"
+#include "../include/ioengine.h"
+
+// DB::ReadPage and DB::WritePage seek and then transfer on the shared
+// database file descriptor, so page I/O from concurrent threads (and
+// from different buffer pools) has to be serialized.
+static pthread_mutex_t dbIOLatch = PTHREAD_MUTEX_INITIALIZER;
 
 Frame::Frame()
 {
-	this->data = new Page();
+	this->pid = INVALID_PAGE;
+	this->pinCount = 0;
+	this->dirty = false;
+	this->data = NULL;
+	this->counters = NULL;
+	this->ioInProgress = false;
 	this->EmptyIt();
 }
 
@@ -14,88 +32,202 @@ Frame::~Frame()
 	{
 		this->Write();
 	}
+}
+
+void Frame::SetPage(Page* page)
+{
+	this->data = page;
+}
+
+void Frame::SetCounters(FrameCounters* counters)
+{
+	this->counters = counters;
+}
 
-	delete this->data;
+void Frame::Count(int FrameCounters::*counter, int delta)
+{
+	if (NULL != this->counters)
+	{
+		__atomic_add_fetch(&(this->counters->*counter), delta, __ATOMIC_RELAXED);
+	}
 }
 
 void Frame::Pin()
 {
-	this->pinCount++;
+	if (1 == __atomic_add_fetch(&this->pinCount, 1, __ATOMIC_ACQ_REL))
+	{
+		this->Count(&FrameCounters::numOfPinned, 1);
+	}
+}
+
+//--------------------------------------------------------------------
+// Frame::Unpin
+//
+// Decrement the pin count unless it is already zero. Returns the new
+// pin count, or -1 if the frame was not pinned.
+//--------------------------------------------------------------------
+
+int Frame::Unpin()
+{
+	int count = __atomic_load_n(&this->pinCount, __ATOMIC_ACQUIRE);
+
+	while (count > 0)
+	{
+		if (__atomic_compare_exchange_n(&this->pinCount, &count, count - 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			if (1 == count)
+			{
+				this->Count(&FrameCounters::numOfPinned, -1);
+			}
+
+			return count - 1;
+		}
+	}
+
+	return -1;
 }
 
-void Frame::Unpin()
+//--------------------------------------------------------------------
+// Frame::TryClaim
+//
+// Pin the frame only if nobody else has it pinned. Used to take a
+// replacement victim; at most one thread can succeed.
+//--------------------------------------------------------------------
+
+bool Frame::TryClaim()
 {
-	this->pinCount--;
+	int unpinned = 0;
+	bool claimed = __atomic_compare_exchange_n(&this->pinCount, &unpinned, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
 
-	if (this->NotPinned())
+	if (claimed)
 	{
-		this->timestamp = clock();
+		this->Count(&FrameCounters::numOfPinned, 1);
 	}
+
+	return claimed;
 }
 
 void Frame::EmptyIt()
 {
-	this->pid = INVALID_PAGE;
-	this->dirty = false;
-	this->pinCount = 0;
-	this->timestamp = clock();
+	this->SetPageID(INVALID_PAGE);
+	this->CleanIt();
+	this->SetPrefetched(false);
+
+	if (__atomic_exchange_n(&this->pinCount, 0, __ATOMIC_ACQ_REL) > 0)
+	{
+		this->Count(&FrameCounters::numOfPinned, -1);
+	}
 }
 
 
+// DirtyIt and CleanIt only write the flag if it changes, which keeps
+// unpinning an already dirty page cheap
 void Frame::DirtyIt()
 {
-	this->dirty = true;
+	if (!this->IsDirty() && !__atomic_exchange_n(&this->dirty, true, __ATOMIC_ACQ_REL))
+	{
+		this->Count(&FrameCounters::numOfDirty, 1);
+	}
+}
+
+void Frame::CleanIt()
+{
+	if (this->IsDirty() && __atomic_exchange_n(&this->dirty, false, __ATOMIC_ACQ_REL))
+	{
+		this->Count(&FrameCounters::numOfDirty, -1);
+	}
 }
 
 void Frame::SetPageID(PageID pid)
 {
-	this->pid = pid;
+	PageID oldPid = __atomic_exchange_n(&this->pid, pid, __ATOMIC_ACQ_REL);
+
+	if ((INVALID_PAGE == oldPid) != (INVALID_PAGE == pid))
+	{
+		this->Count(&FrameCounters::numOfValid, (INVALID_PAGE == pid) ? -1 : 1);
+	}
 }
 
 bool Frame::IsDirty()
 {
-	return this->dirty;
+	return __atomic_load_n(&this->dirty, __ATOMIC_ACQUIRE);
 }
 
 bool Frame::IsValid()
 {
-	return (this->pid != INVALID_PAGE);
+	return (this->GetPageID() != INVALID_PAGE);
 }
 
-Status Frame::Write()
+//--------------------------------------------------------------------
+// Frame::Write, Frame::Read
+//
+// Transfer the page through the I/O engine if one is given, falling
+// back to DB::WritePage and DB::ReadPage if that fails or if not.
+//--------------------------------------------------------------------
+
+Status Frame::Write(IOEngine* engine)
 {
-	return MINIBASE_DB->WritePage(this->pid, this->data);
+	Status status = FAIL;
+
+	if (NULL != engine)
+	{
+		status = engine->Write(this->GetPageID(), this->data);
+	}
+
+	if (OK != status)
+	{
+		pthread_mutex_lock(&dbIOLatch);
+		status = MINIBASE_DB->WritePage(this->GetPageID(), this->data);
+		pthread_mutex_unlock(&dbIOLatch);
+	}
+
+	return status;
 }
 
-Status Frame::Read(PageID pid)
+Status Frame::Read(PageID pid, IOEngine* engine)
 {
-	Status status = MINIBASE_DB->ReadPage(pid, data);
+	Status status = FAIL;
+
+	if (NULL != engine)
+	{
+		status = engine->Read(pid, this->data);
+	}
+
+	if (OK != status)
+	{
+		pthread_mutex_lock(&dbIOLatch);
+		status = MINIBASE_DB->ReadPage(pid, data);
+		pthread_mutex_unlock(&dbIOLatch);
+	}
 
 	if (OK == status)
 	{
-		this->pid = pid;
+		this->SetPageID(pid);
 	}
 
 	return status;
 }
 
+//--------------------------------------------------------------------
+// Frame::Free
+//
+// Release the frame of a page that is about to be deallocated. Fails
+// if the page is pinned more than once or is still being read in.
+// Deallocating the page itself is left to the caller.
+//--------------------------------------------------------------------
+
 Status Frame::Free()
 {
 	Status status = OK;
 
-	if (this->pinCount > 1)
+	if (this->GetPinCount() > 1 || this->IsIOInProgress())
 	{
 		status = FAIL;
 	}
 
 	if (OK == status)
 	{
-		PageID pid = this->pid;
-
-		// Release the frame (the space might be needed by the directory page)
 		this->EmptyIt();
-
-		status = MINIBASE_DB->DeallocatePage(pid);
 	}
 
 	return status;
@@ -103,17 +235,22 @@ Status Frame::Free()
 
 bool Frame::NotPinned()
 {
-	return (this->pinCount == 0);
+	return (this->GetPinCount() == 0);
+}
+
+int Frame::GetPinCount()
+{
+	return __atomic_load_n(&this->pinCount, __ATOMIC_ACQUIRE);
 }
 
 bool Frame::HasPageID(PageID pid)
 {
-	return (this->pid == pid);
+	return (this->GetPageID() == pid);
 }
 
 PageID Frame::GetPageID()
 {
-	return this->pid;
+	return __atomic_load_n(&this->pid, __ATOMIC_ACQUIRE);
 }
 
 Page* Frame::GetPage()
@@ -121,7 +258,309 @@ Page* Frame::GetPage()
 	return this->data;
 }
 
-clock_t Frame::GetTimestamp()
+void Frame::SetIOInProgress(bool inProgress)
+{
+	__atomic_store_n(&this->ioInProgress, inProgress, __ATOMIC_RELEASE);
+}
+
+bool Frame::IsIOInProgress()
+{
+	return __atomic_load_n(&this->ioInProgress, __ATOMIC_ACQUIRE);
+}
+
+void Frame::SetPrefetched(bool prefetched)
+{
+	__atomic_store_n(&this->prefetched, prefetched, __ATOMIC_RELEASE);
+}
+
+//--------------------------------------------------------------------
+// Frame::TakePrefetched
+//
+// Returns true if the page was read in by the prefetcher and has not
+// been pinned since; only the first caller gets true.
+//--------------------------------------------------------------------
+
+bool Frame::TakePrefetched()
+{
+	if (!__atomic_load_n(&this->prefetched, __ATOMIC_ACQUIRE))
+	{
+		return false;
+	}
+
+	return __atomic_exchange_n(&this->prefetched, false, __ATOMIC_ACQ_REL);
+}
+
+// Order frames by the page id they hold, for qsort
+static int ComparePageIDs(const void* frame1, const void* frame2)
+{
+	PageID pid1 = (*(Frame**)frame1)->GetPageID();
+	PageID pid2 = (*(Frame**)frame2)->GetPageID();
+
+	return (pid1 > pid2) - (pid1 < pid2);
+}
+
+// Length of the run of consecutive pages starting at frames[first]
+static int RunLength(Frame** frames, int first, int count)
+{
+	int last = first + 1;
+
+	while (last < count && last - first < IOV_MAX &&
+		   frames[last]->GetPageID() == frames[last - 1]->GetPageID() + 1)
+	{
+		last++;
+	}
+
+	return last - first;
+}
+
+// Whether a run lies within the database, so that it can be
+// transferred on a descriptor of our own without extending the file
+static bool IsInDB(Frame** run, int count)
+{
+	PageID firstPid = run[0]->GetPageID();
+
+	return (firstPid >= 0 && firstPid + count <= MINIBASE_DB->GetNumOfPages());
+}
+
+// Write out a run the I/O engine or pwritev could not, page by page;
+// see WriteFrames
+static int FinishWriteRun(Frame** run, int count, bool written)
+{
+	int numOfWrites = count;
+
+	for (int i = 0; !written && i < count; i++)
+	{
+		if (OK != run[i]->Write())
+		{
+			run[i]->DirtyIt();
+			numOfWrites--;
+		}
+	}
+
+	return numOfWrites;
+}
+
+// Write a run of frames holding consecutive pages; see WriteFrames
+static int WriteRun(int fd, Frame** run, int count)
+{
+	bool written = false;
+
+	for (int i = 0; i < count; i++)
+	{
+		run[i]->CleanIt();
+	}
+
+	if (fd >= 0 && IsInDB(run, count))
+	{
+		struct iovec iov[IOV_MAX];
+
+		for (int i = 0; i < count; i++)
+		{
+			iov[i].iov_base = run[i]->GetPage();
+			iov[i].iov_len = MINIBASE_PAGESIZE;
+		}
+
+		ssize_t size = (ssize_t)count * MINIBASE_PAGESIZE;
+		written = (pwritev(fd, iov, count, (off_t)run[0]->GetPageID() * MINIBASE_PAGESIZE) == size);
+	}
+
+	return FinishWriteRun(run, count, written);
+}
+
+//--------------------------------------------------------------------
+// Frame::WriteFrames
+//
+// Input    : frames - frames holding dirty pages; sorted by page id
+//                     on return
+//            count  - number of frames
+//            engine - I/O engine to write through, or NULL
+// Output   : None
+// Purpose  : Write the pages back in page id order. Each run of
+//            consecutive pages goes out with a single pwritev, on a
+//            descriptor of its own so that the DB's file offset is
+//            left alone, instead of a seek and a write per page. With
+//            an I/O engine, all runs are handed to it at once, so that
+//            they are in flight together. A run that cannot be written
+//            this way, or a single page, goes through DB::WritePage
+//            page by page.
+// PreCond  : The caller has claimed the frames, so that their pages
+//            can neither change nor be replaced meanwhile.
+// PostCond : The frames written are clean, the others still dirty.
+// Return   : The number of pages written.
+//--------------------------------------------------------------------
+
+int Frame::WriteFrames(Frame** frames, int count, IOEngine* engine)
 {
-	return this->timestamp;
+	int numOfWrites = 0;
+	int fd = (NULL == engine && count > 1) ? open(MINIBASE_DB->GetName(), O_WRONLY) : -1;
+	IORequest* requests = (NULL != engine) ? new IORequest[count] : NULL;
+	Page** pages = (NULL != engine) ? new Page*[count] : NULL;
+	int numOfRequests = 0;
+
+	qsort(frames, count, sizeof(Frame*), ComparePageIDs);
+
+	for (int first = 0; first < count; )
+	{
+		int runSize = RunLength(frames, first, count);
+
+		if (NULL != engine && IsInDB(frames + first, runSize))
+		{
+			IORequest& request = requests[numOfRequests++];
+
+			for (int i = first; i < first + runSize; i++)
+			{
+				frames[i]->CleanIt();
+				pages[i] = frames[i]->GetPage();
+			}
+
+			request.pid = frames[first]->GetPageID();
+			request.count = runSize;
+			request.pages = pages + first;
+			request.write = true;
+		}
+		else
+		{
+			numOfWrites += WriteRun(fd, frames + first, runSize);
+		}
+
+		first += runSize;
+	}
+
+	if (numOfRequests > 0)
+	{
+		engine->Submit(requests, numOfRequests);
+
+		for (int i = 0; i < numOfRequests; i++)
+		{
+			Frame** run = frames + (requests[i].pages - pages);
+			numOfWrites += FinishWriteRun(run, requests[i].count, OK == requests[i].status);
+		}
+	}
+
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	delete[] requests;
+	delete[] pages;
+
+	return numOfWrites;
+}
+
+// Read in a run the I/O engine or preadv could not, page by page; see
+// ReadFrames
+static Status FinishReadRun(Frame** run, int count, bool read)
+{
+	Status status = OK;
+	PageID firstPid = run[0]->GetPageID();
+
+	for (int i = 0; !read && OK == status && i < count; i++)
+	{
+		status = run[i]->Read(firstPid + i);
+	}
+
+	return status;
+}
+
+// Read a run of frames holding consecutive pages; see ReadFrames
+static Status ReadRun(int fd, Frame** run, int count)
+{
+	bool read = false;
+
+	if (fd >= 0 && IsInDB(run, count))
+	{
+		struct iovec iov[IOV_MAX];
+
+		for (int i = 0; i < count; i++)
+		{
+			iov[i].iov_base = run[i]->GetPage();
+			iov[i].iov_len = MINIBASE_PAGESIZE;
+		}
+
+		ssize_t size = (ssize_t)count * MINIBASE_PAGESIZE;
+		read = (preadv(fd, iov, count, (off_t)run[0]->GetPageID() * MINIBASE_PAGESIZE) == size);
+	}
+
+	return FinishReadRun(run, count, read);
+}
+
+//--------------------------------------------------------------------
+// Frame::ReadFrames
+//
+// Input    : frames - frames holding the pages to read, in page id
+//                     order
+//            count  - number of frames
+//            engine - I/O engine to read through, or NULL
+// Output   : None
+// Purpose  : Read the pages in, each run of consecutive pages (at most
+//            IOV_MAX pages at a time) with a single preadv, on a
+//            descriptor of its own. With an I/O engine, all runs are
+//            handed to it at once, so that they are in flight together.
+//            A run that cannot be read this way goes through
+//            DB::ReadPage page by page. A single page is read with
+//            DB::ReadPage straight away, which saves opening the file.
+// PreCond  : The caller has installed the pages in the frames and
+//            marked them as I/O in progress.
+// Return   : OK if all pages were read. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status Frame::ReadFrames(Frame** frames, int count, IOEngine* engine)
+{
+	Status status = OK;
+	int fd = (NULL == engine && count > 1) ? open(MINIBASE_DB->GetName(), O_RDONLY) : -1;
+	IORequest* requests = (NULL != engine) ? new IORequest[count] : NULL;
+	Page** pages = (NULL != engine) ? new Page*[count] : NULL;
+	int numOfRequests = 0;
+
+	for (int first = 0; first < count; )
+	{
+		int runSize = RunLength(frames, first, count);
+
+		if (NULL != engine && IsInDB(frames + first, runSize))
+		{
+			IORequest& request = requests[numOfRequests++];
+
+			for (int i = first; i < first + runSize; i++)
+			{
+				pages[i] = frames[i]->GetPage();
+			}
+
+			request.pid = frames[first]->GetPageID();
+			request.count = runSize;
+			request.pages = pages + first;
+			request.write = false;
+		}
+		else if (OK != ReadRun(fd, frames + first, runSize))
+		{
+			status = FAIL;
+		}
+
+		first += runSize;
+	}
+
+	if (numOfRequests > 0)
+	{
+		engine->Submit(requests, numOfRequests);
+
+		for (int i = 0; i < numOfRequests; i++)
+		{
+			Frame** run = frames + (requests[i].pages - pages);
+
+			if (OK != FinishReadRun(run, requests[i].count, OK == requests[i].status))
+			{
+				status = FAIL;
+			}
+		}
+	}
+
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+	delete[] requests;
+	delete[] pages;
+
+	return status;
 }
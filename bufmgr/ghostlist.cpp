@@ -0,0 +1,90 @@
+#include "../include/ghostlist.h"
+
+GhostList::GhostList(int capacity)
+{
+	this->capacity = (capacity > 0) ? capacity : 1;
+	this->pids = new PageID[this->capacity];
+	this->index = new HashTable(this->capacity);
+	this->order = new IndexLists(this->capacity, 2);
+
+	for (int i = 0; i < this->capacity; i++)
+	{
+		this->pids[i] = INVALID_PAGE;
+		this->order->PushBack(UNUSED, i);
+	}
+}
+
+
+GhostList::~GhostList()
+{
+	delete[] this->pids;
+	delete this->index;
+	delete this->order;
+}
+
+
+//--------------------------------------------------------------------
+// GhostList::Insert
+//
+// Input    : pid - page id of a page that just left the buffer pool
+// Output   : None
+// Purpose  : Add pid as the newest ghost. If the list is full, the
+//            oldest ghost is dropped to make room.
+// Return   : The entry number the ghost is kept in.
+//--------------------------------------------------------------------
+
+int GhostList::Insert(PageID pid)
+{
+	this->Remove(pid);
+
+	if (0 == this->order->Size(UNUSED))
+	{
+		this->RemoveOldest();
+	}
+
+	int entry = this->order->Front(UNUSED);
+	this->order->MoveToBack(USED, entry);
+	this->pids[entry] = pid;
+	this->index->Insert(pid, entry);
+
+	return entry;
+}
+
+
+//--------------------------------------------------------------------
+// GhostList::Find
+//
+// Return   : The entry number of the ghost for pid, INVALID_INDEX if
+//            pid is not in the list.
+//--------------------------------------------------------------------
+
+int GhostList::Find(PageID pid)
+{
+	int entry = this->index->LookUp(pid);
+
+	return (INVALID_FRAME == entry) ? INVALID_INDEX : entry;
+}
+
+
+void GhostList::Remove(PageID pid)
+{
+	int entry = this->Find(pid);
+
+	if (INVALID_INDEX != entry)
+	{
+		this->index->Delete(pid);
+		this->pids[entry] = INVALID_PAGE;
+		this->order->MoveToBack(UNUSED, entry);
+	}
+}
+
+
+void GhostList::RemoveOldest()
+{
+	int entry = this->order->Front(USED);
+
+	if (INVALID_INDEX != entry)
+	{
+		this->Remove(this->pids[entry]);
+	}
+}
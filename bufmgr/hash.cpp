@@ -0,0 +1,196 @@
+#include "../include/hash.h"
+#include "../include/page.h"
+
+//--------------------------------------------------------------------
+// Constructor for HashTable
+//
+// Input   : maxEntries - the largest number of mappings that will be
+//                        stored in the table at any one time
+// Output  : None
+// PostCond: The table is empty.
+//--------------------------------------------------------------------
+
+HashTable::HashTable(int maxEntries)
+{
+	this->capacity = 2;
+	this->shift = 31;
+
+	// Keep the load factor at or below 1/2
+	while (this->capacity < 2 * (unsigned int)maxEntries)
+	{
+		this->capacity <<= 1;
+		this->shift--;
+	}
+
+	this->entries = new Entry[this->capacity];
+	this->EmptyIt();
+}
+
+
+HashTable::~HashTable()
+{
+	delete[] this->entries;
+}
+
+
+//--------------------------------------------------------------------
+// HashTable::Insert
+//
+// Input    : pid     - page id to map
+//            frameNo - frame the page resides in
+// Output   : None
+// Purpose  : Map pid to frameNo, replacing any previous mapping of pid.
+//--------------------------------------------------------------------
+
+void HashTable::Insert(PageID pid, int frameNo)
+{
+	if (2 * (unsigned int)(this->numOfEntries + 1) > this->capacity)
+	{
+		this->Grow();
+	}
+
+	unsigned int slot = this->Slot(pid);
+
+	while (this->entries[slot].pid != INVALID_PAGE && this->entries[slot].pid != pid)
+	{
+		slot = (slot + 1) & (this->capacity - 1);
+	}
+
+	if (this->entries[slot].pid == INVALID_PAGE)
+	{
+		this->numOfEntries++;
+	}
+
+	this->entries[slot].pid = pid;
+	this->entries[slot].frameNo = frameNo;
+}
+
+
+//--------------------------------------------------------------------
+// HashTable::Delete
+//
+// Input    : pid - page id whose mapping should be removed
+// Output   : None
+// Purpose  : Remove the mapping of pid. The entries following the
+//            removed one in its probe run are shifted back, so that
+//            no tombstones are left behind.
+// Return   : OK if pid was mapped, FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status HashTable::Delete(PageID pid)
+{
+	unsigned int mask = this->capacity - 1;
+	unsigned int hole = this->Slot(pid);
+
+	while (this->entries[hole].pid != pid)
+	{
+		if (this->entries[hole].pid == INVALID_PAGE)
+		{
+			return FAIL;
+		}
+
+		hole = (hole + 1) & mask;
+	}
+
+	// Backward shift deletion: move every entry of the run that would
+	// still be reachable from its home slot into the hole.
+	unsigned int next = (hole + 1) & mask;
+	while (this->entries[next].pid != INVALID_PAGE)
+	{
+		unsigned int home = this->Slot(this->entries[next].pid);
+
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			this->entries[hole] = this->entries[next];
+			hole = next;
+		}
+
+		next = (next + 1) & mask;
+	}
+
+	this->entries[hole].pid = INVALID_PAGE;
+	this->numOfEntries--;
+
+	return OK;
+}
+
+
+//--------------------------------------------------------------------
+// HashTable::LookUp
+//
+// Input    : pid - a page id
+// Output   : None
+// Return   : the frame number pid is mapped to, INVALID_FRAME if pid
+//            is not in the table.
+//--------------------------------------------------------------------
+
+int HashTable::LookUp(PageID pid)
+{
+	unsigned int slot = this->Slot(pid);
+
+	while (this->entries[slot].pid != INVALID_PAGE)
+	{
+		if (this->entries[slot].pid == pid)
+		{
+			return this->entries[slot].frameNo;
+		}
+
+		slot = (slot + 1) & (this->capacity - 1);
+	}
+
+	return INVALID_FRAME;
+}
+
+
+void HashTable::EmptyIt()
+{
+	for (unsigned int i = 0; i < this->capacity; i++)
+	{
+		this->entries[i].pid = INVALID_PAGE;
+		this->entries[i].frameNo = INVALID_FRAME;
+	}
+
+	this->numOfEntries = 0;
+}
+
+
+//--------------------------------------------------------------------
+// HashTable::Grow
+//
+// Double the capacity and reinsert every mapping.
+//--------------------------------------------------------------------
+
+void HashTable::Grow()
+{
+	Entry* oldEntries = this->entries;
+	unsigned int oldCapacity = this->capacity;
+
+	this->capacity <<= 1;
+	this->shift--;
+	this->entries = new Entry[this->capacity];
+	this->EmptyIt();
+
+	for (unsigned int i = 0; i < oldCapacity; i++)
+	{
+		if (oldEntries[i].pid != INVALID_PAGE)
+		{
+			this->Insert(oldEntries[i].pid, oldEntries[i].frameNo);
+		}
+	}
+
+	delete[] oldEntries;
+}
+
+
+//--------------------------------------------------------------------
+// HashTable::Slot
+//
+// Fibonacci hashing: page ids are mostly allocated sequentially, so
+// the multiplication spreads neighbouring ids over the whole table
+// and the top bits are used as the home slot.
+//--------------------------------------------------------------------
+
+unsigned int HashTable::Slot(PageID pid)
+{
+	return ((unsigned int)pid * 2654435769u) >> this->shift;
+}
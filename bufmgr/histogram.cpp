@@ -0,0 +1,90 @@
+#include "../include/histogram.h"
+
+Histogram::Histogram()
+{
+	this->Reset();
+}
+
+
+void Histogram::Add(long value)
+{
+	int bucket = (value > 0) ? 64 - __builtin_clzl((unsigned long)value) : 0;
+
+	if (bucket >= HISTOGRAM_BUCKETS)
+	{
+		bucket = HISTOGRAM_BUCKETS - 1;
+	}
+
+	__atomic_add_fetch(&this->buckets[bucket], 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&this->count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&this->sum, value, __ATOMIC_RELAXED);
+}
+
+
+void Histogram::Reset()
+{
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		__atomic_store_n(&this->buckets[i], 0, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&this->count, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&this->sum, 0, __ATOMIC_RELAXED);
+}
+
+
+//--------------------------------------------------------------------
+// Histogram::CopyFrom
+//
+// Take a copy of a histogram that may be being added to. The count is
+// recomputed from the buckets, so that percentiles of the copy are
+// consistent.
+//--------------------------------------------------------------------
+
+void Histogram::CopyFrom(Histogram& other)
+{
+	this->count = 0;
+
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		this->buckets[i] = __atomic_load_n(&other.buckets[i], __ATOMIC_RELAXED);
+		this->count += this->buckets[i];
+	}
+
+	this->sum = __atomic_load_n(&other.sum, __ATOMIC_RELAXED);
+}
+
+
+double Histogram::GetMean()
+{
+	return (this->count > 0) ? (double)this->sum / this->count : 0.0;
+}
+
+
+//--------------------------------------------------------------------
+// Histogram::GetPercentile
+//
+// Input    : percent - between 0 and 100
+// Return   : The upper bound of the bucket holding the value below
+//            which percent of the values fall, 0 if there are none.
+//--------------------------------------------------------------------
+
+long Histogram::GetPercentile(double percent)
+{
+	long rank = (long)(percent / 100.0 * this->count + 0.5);
+	long seen = 0;
+	int bucket = 0;
+
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+
+	while (bucket < HISTOGRAM_BUCKETS - 1 && seen + this->buckets[bucket] < rank)
+	{
+		seen += this->buckets[bucket];
+		bucket++;
+	}
+
+	return (0 == this->count || 0 == bucket) ? 0 : (1L << bucket) - 1;
+}
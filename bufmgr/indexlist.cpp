@@ -0,0 +1,124 @@
+#include "../include/indexlist.h"
+
+IndexLists::IndexLists(int numOfEntries, int numOfLists)
+{
+	this->numOfLists = numOfLists;
+	this->head = new int[numOfLists];
+	this->tail = new int[numOfLists];
+	this->size = new int[numOfLists];
+
+	this->numOfEntries = numOfEntries;
+	this->prev = new int[numOfEntries];
+	this->next = new int[numOfEntries];
+	this->owner = new int[numOfEntries];
+
+	this->EmptyIt();
+}
+
+
+IndexLists::~IndexLists()
+{
+	delete[] this->head;
+	delete[] this->tail;
+	delete[] this->size;
+	delete[] this->prev;
+	delete[] this->next;
+	delete[] this->owner;
+}
+
+
+void IndexLists::PushBack(int listNo, int entry)
+{
+	this->prev[entry] = this->tail[listNo];
+	this->next[entry] = INVALID_INDEX;
+
+	if (INVALID_INDEX == this->tail[listNo])
+	{
+		this->head[listNo] = entry;
+	}
+	else
+	{
+		this->next[this->tail[listNo]] = entry;
+	}
+
+	this->tail[listNo] = entry;
+	this->owner[entry] = listNo;
+	this->size[listNo]++;
+}
+
+
+void IndexLists::PushFront(int listNo, int entry)
+{
+	this->prev[entry] = INVALID_INDEX;
+	this->next[entry] = this->head[listNo];
+
+	if (INVALID_INDEX == this->head[listNo])
+	{
+		this->tail[listNo] = entry;
+	}
+	else
+	{
+		this->prev[this->head[listNo]] = entry;
+	}
+
+	this->head[listNo] = entry;
+	this->owner[entry] = listNo;
+	this->size[listNo]++;
+}
+
+
+//--------------------------------------------------------------------
+// IndexLists::Remove
+//
+// Unlink entry from the list it is on. Does nothing if the entry is
+// not on any list.
+//--------------------------------------------------------------------
+
+void IndexLists::Remove(int entry)
+{
+	int listNo = this->owner[entry];
+
+	if (INVALID_INDEX == listNo)
+	{
+		return;
+	}
+
+	if (INVALID_INDEX == this->prev[entry])
+	{
+		this->head[listNo] = this->next[entry];
+	}
+	else
+	{
+		this->next[this->prev[entry]] = this->next[entry];
+	}
+
+	if (INVALID_INDEX == this->next[entry])
+	{
+		this->tail[listNo] = this->prev[entry];
+	}
+	else
+	{
+		this->prev[this->next[entry]] = this->prev[entry];
+	}
+
+	this->owner[entry] = INVALID_INDEX;
+	this->size[listNo]--;
+}
+
+
+void IndexLists::EmptyIt()
+{
+	for (int i = 0; i < this->numOfLists; i++)
+	{
+		this->head[i] = INVALID_INDEX;
+		this->tail[i] = INVALID_INDEX;
+		this->size[i] = 0;
+	}
+
+	for (int i = 0; i < this->numOfEntries; i++)
+	{
+		this->prev[i] = INVALID_INDEX;
+		this->next[i] = INVALID_INDEX;
+		this->owner[i] = INVALID_INDEX;
+	}
+}
@@ -0,0 +1,677 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+#include "../include/ioengine.h"
+#include "../include/db.h"
+
+// No liburing: the ring is set up and driven with the raw system calls
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_OFF_SQ_RING)
+#define IO_HAVE_URING 1
+#else
+#define IO_HAVE_URING 0
+#endif
+
+// O_DIRECT transfers have to be aligned to the logical block size of
+// the device, which is 512 bytes or a multiple of it up to 4 KiB.
+#define IO_DIRECT_ALIGNMENT 512
+
+struct IOBatch
+{
+	int numOfPending;
+};
+
+
+//--------------------------------------------------------------------
+// Constructor for IOEngine
+//
+// Input   : kind   - "io_uring" to use io_uring if the kernel has it;
+//                    anything else for the thread pool
+//           direct - if true, open the file with O_DIRECT
+// Output  : None
+// PostCond: The engine is set up; the file is not opened yet.
+//--------------------------------------------------------------------
+
+IOEngine::IOEngine(const char* kind, bool direct)
+{
+	this->direct = direct;
+	this->opened = false;
+	this->directFd = -1;
+	this->bufferedFd = -1;
+
+	pthread_mutex_init(&this->latch, NULL);
+	pthread_cond_init(&this->queued, NULL);
+	pthread_cond_init(&this->completed, NULL);
+	this->queueHead = NULL;
+	this->queueTail = NULL;
+	this->numOfInFlight = 0;
+	this->stop = false;
+
+	this->ringFd = -1;
+	this->sqRing = NULL;
+	this->cqRing = NULL;
+	this->sqRingSize = 0;
+	this->cqRingSize = 0;
+	this->sqes = NULL;
+	this->sqesSize = 0;
+	this->numOfUnsubmitted = 0;
+	this->reaping = false;
+	this->numOfThreads = 0;
+
+	this->kind = THREADS;
+
+	if (0 == strcmp(kind, "io_uring") && this->SetUpRing())
+	{
+		this->kind = IO_URING;
+	}
+}
+
+
+IOEngine::~IOEngine()
+{
+	pthread_mutex_lock(&this->latch);
+	this->stop = true;
+	pthread_cond_broadcast(&this->queued);
+	pthread_mutex_unlock(&this->latch);
+
+	for (int i = 0; i < this->numOfThreads; i++)
+	{
+		pthread_join(this->threads[i], NULL);
+	}
+
+	if (NULL != this->sqes)
+	{
+		munmap(this->sqes, this->sqesSize);
+	}
+
+	if (NULL != this->cqRing && this->cqRing != this->sqRing)
+	{
+		munmap(this->cqRing, this->cqRingSize);
+	}
+
+	if (NULL != this->sqRing)
+	{
+		munmap(this->sqRing, this->sqRingSize);
+	}
+
+	if (this->ringFd >= 0)
+	{
+		close(this->ringFd);
+	}
+
+	if (this->directFd >= 0)
+	{
+		close(this->directFd);
+	}
+
+	if (this->bufferedFd >= 0)
+	{
+		close(this->bufferedFd);
+	}
+
+	pthread_mutex_destroy(&this->latch);
+	pthread_cond_destroy(&this->queued);
+	pthread_cond_destroy(&this->completed);
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::SetUpRing
+//
+// Create an io_uring instance and map its submission queue, completion
+// queue and submission queue entries.
+// Returns false if io_uring is not available; nothing is left mapped.
+//--------------------------------------------------------------------
+
+bool IOEngine::SetUpRing()
+{
+	bool ready = false;
+
+#if IO_HAVE_URING
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	this->ringFd = syscall(__NR_io_uring_setup, IO_QUEUE_DEPTH, &params);
+	ready = (this->ringFd >= 0);
+
+	if (ready)
+	{
+		this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		this->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+		// Both rings may share a single mapping
+		bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP);
+
+		if (singleMapping && this->cqRingSize > this->sqRingSize)
+		{
+			this->sqRingSize = this->cqRingSize;
+		}
+
+		void* mapping = mmap(NULL, this->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFd, IORING_OFF_SQ_RING);
+		this->sqRing = (MAP_FAILED != mapping) ? mapping : NULL;
+
+		if (NULL != this->sqRing && singleMapping)
+		{
+			this->cqRing = this->sqRing;
+		}
+		else if (NULL != this->sqRing)
+		{
+			mapping = mmap(NULL, this->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFd, IORING_OFF_CQ_RING);
+			this->cqRing = (MAP_FAILED != mapping) ? mapping : NULL;
+		}
+
+		if (NULL != this->cqRing)
+		{
+			mapping = mmap(NULL, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ringFd, IORING_OFF_SQES);
+			this->sqes = (MAP_FAILED != mapping) ? mapping : NULL;
+		}
+
+		ready = (NULL != this->sqes);
+	}
+
+	if (ready)
+	{
+		char* sq = (char*)this->sqRing;
+		char* cq = (char*)this->cqRing;
+
+		this->sqHead = (unsigned*)(sq + params.sq_off.head);
+		this->sqTail = (unsigned*)(sq + params.sq_off.tail);
+		this->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+		this->sqArray = (unsigned*)(sq + params.sq_off.array);
+		this->cqHead = (unsigned*)(cq + params.cq_off.head);
+		this->cqTail = (unsigned*)(cq + params.cq_off.tail);
+		this->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+		this->cqes = cq + params.cq_off.cqes;
+	}
+	else
+	{
+		if (NULL != this->cqRing && this->cqRing != this->sqRing)
+		{
+			munmap(this->cqRing, this->cqRingSize);
+		}
+
+		if (NULL != this->sqRing)
+		{
+			munmap(this->sqRing, this->sqRingSize);
+		}
+
+		if (this->ringFd >= 0)
+		{
+			close(this->ringFd);
+		}
+
+		this->ringFd = -1;
+		this->sqRing = NULL;
+		this->cqRing = NULL;
+	}
+#endif
+
+	return ready;
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::Open
+//
+// Open the database file, and start the worker threads if there is no
+// ring. Called with the latch held.
+// Returns OK if the file could be opened at least for buffered I/O,
+// and a worker thread started if they are needed. Otherwise nothing is
+// left open.
+//--------------------------------------------------------------------
+
+Status IOEngine::Open()
+{
+	Status status = OK;
+	const char* fileName = MINIBASE_DB->GetName();
+
+	this->bufferedFd = open(fileName, O_RDWR);
+
+	if (this->bufferedFd < 0)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status && this->IsDirect())
+	{
+		// Not every file system supports O_DIRECT; tmpfs refuses it
+		this->directFd = open(fileName, O_RDWR | O_DIRECT);
+
+		if (this->directFd < 0)
+		{
+			__atomic_store_n(&this->direct, false, __ATOMIC_RELEASE);
+		}
+	}
+
+	if (OK == status && THREADS == this->kind)
+	{
+		for (int i = 0; i < IO_NUM_OF_THREADS; i++)
+		{
+			if (0 == pthread_create(&this->threads[this->numOfThreads], NULL, RunWorker, this))
+			{
+				this->numOfThreads++;
+			}
+		}
+
+		if (0 == this->numOfThreads)
+		{
+			status = FAIL;
+		}
+	}
+
+	if (OK == status)
+	{
+		this->opened = true;
+	}
+	else
+	{
+		// The next Submit opens the file again
+		if (this->directFd >= 0)
+		{
+			close(this->directFd);
+			this->directFd = -1;
+		}
+
+		if (this->bufferedFd >= 0)
+		{
+			close(this->bufferedFd);
+			this->bufferedFd = -1;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::Submit
+//
+// Input    : requests - runs of at most IOV_MAX consecutive pages
+//            count    - number of requests
+// Output   : None
+// Purpose  : Queue all requests, start as many as the queue depth
+//            allows, and wait until every one has completed. With
+//            io_uring, the first waiting thread reaps completions for
+//            everybody, starting queued requests as room frees up.
+//            Requests refused by O_DIRECT are done again buffered.
+// PostCond : The status of each request is set.
+// Return   : OK if all requests succeeded. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status IOEngine::Submit(IORequest* requests, int count)
+{
+	Status status = OK;
+	IOBatch batch;
+	int numOfPages = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		requests[i].status = FAIL;
+		numOfPages += requests[i].count;
+	}
+
+	struct iovec* iov = new struct iovec[numOfPages + 1];
+	batch.numOfPending = count;
+
+	pthread_mutex_lock(&this->latch);
+
+	if (!this->opened)
+	{
+		status = this->Open();
+	}
+
+	if (OK == status)
+	{
+		for (int i = 0, page = 0; i < count; i++)
+		{
+			requests[i].iov = iov + page;
+			requests[i].batch = &batch;
+			page += requests[i].count;
+
+			this->Prepare(&requests[i]);
+		}
+
+		pthread_cond_broadcast(&this->queued);
+
+		while (batch.numOfPending > 0)
+		{
+			this->StartQueued();
+
+			if (IO_URING == this->kind && !this->reaping && this->numOfInFlight == this->numOfUnsubmitted)
+			{
+				// The kernel took none of the requests in flight, so
+				// none would complete; offer them again after a while
+				pthread_mutex_unlock(&this->latch);
+				usleep(100);
+				pthread_mutex_lock(&this->latch);
+			}
+			else if (IO_URING == this->kind && !this->reaping)
+			{
+				// Entries not taken yet are offered again with the wait
+				int numOfUnsubmitted = this->numOfUnsubmitted;
+
+				this->reaping = true;
+				pthread_mutex_unlock(&this->latch);
+
+				long submitted = 0;
+#if IO_HAVE_URING
+				submitted = syscall(__NR_io_uring_enter, this->ringFd, numOfUnsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+#endif
+
+				pthread_mutex_lock(&this->latch);
+				if (submitted > 0)
+				{
+					this->numOfUnsubmitted -= submitted;
+				}
+				this->ReapCompletions();
+				this->reaping = false;
+				pthread_cond_broadcast(&this->completed);
+			}
+			else if (batch.numOfPending > 0)
+			{
+				pthread_cond_wait(&this->completed, &this->latch);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&this->latch);
+
+	for (int i = 0; OK == status && i < count; i++)
+	{
+		IORequest& request = requests[i];
+
+		if (request.direct && -EINVAL == request.result)
+		{
+			request.result = Transfer(this->bufferedFd, &request);
+		}
+
+		request.status = (request.result == (long)request.count * MINIBASE_PAGESIZE) ? OK : FAIL;
+	}
+
+	for (int i = 0; OK == status && i < count; i++)
+	{
+		if (OK != requests[i].status)
+		{
+			status = FAIL;
+		}
+	}
+
+	delete[] iov;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::Prepare
+//
+// Set up the I/O vector of a request and append it to the queue. It
+// goes to the O_DIRECT descriptor only if all its pages are aligned.
+// Called with the latch held.
+//--------------------------------------------------------------------
+
+void IOEngine::Prepare(IORequest* request)
+{
+	bool aligned = (this->directFd >= 0 && this->IsDirect());
+
+	for (int i = 0; i < request->count; i++)
+	{
+		request->iov[i].iov_base = request->pages[i];
+		request->iov[i].iov_len = MINIBASE_PAGESIZE;
+
+		if (0 != (unsigned long)request->pages[i] % IO_DIRECT_ALIGNMENT)
+		{
+			aligned = false;
+		}
+	}
+
+	request->direct = aligned;
+	request->result = 0;
+	request->next = NULL;
+
+	if (NULL == this->queueTail)
+	{
+		this->queueHead = request;
+	}
+	else
+	{
+		this->queueTail->next = request;
+	}
+
+	this->queueTail = request;
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::StartQueued
+//
+// Move queued requests to the submission queue while fewer than
+// IO_QUEUE_DEPTH are in flight, and submit them with a single
+// io_uring_enter. The worker threads take requests off the queue
+// themselves. Called with the latch held.
+//--------------------------------------------------------------------
+
+void IOEngine::StartQueued()
+{
+#if IO_HAVE_URING
+	if (IO_URING == this->kind)
+	{
+		// Only this thread writes the tail, under the latch
+		unsigned tail = *this->sqTail;
+		unsigned mask = *this->sqMask;
+		int numOfStarted = 0;
+
+		while (NULL != this->queueHead && this->numOfInFlight < IO_QUEUE_DEPTH)
+		{
+			IORequest* request = this->queueHead;
+
+			this->queueHead = request->next;
+			if (NULL == this->queueHead)
+			{
+				this->queueTail = NULL;
+			}
+
+			unsigned index = tail & mask;
+			struct io_uring_sqe* sqe = (struct io_uring_sqe*)this->sqes + index;
+
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->fd = request->direct ? this->directFd : this->bufferedFd;
+			sqe->off = (unsigned long long)request->pid * MINIBASE_PAGESIZE;
+			sqe->addr = (unsigned long long)(unsigned long)request->iov;
+			sqe->len = request->count;
+			sqe->user_data = (unsigned long long)(unsigned long)request;
+			this->sqArray[index] = index;
+
+			tail++;
+			numOfStarted++;
+			this->numOfInFlight++;
+		}
+
+		if (numOfStarted > 0)
+		{
+			__atomic_store_n(this->sqTail, tail, __ATOMIC_RELEASE);
+			this->numOfUnsubmitted += numOfStarted;
+		}
+
+		// Entries the kernel does not take now (it may be short of
+		// memory, or interrupted) are offered again on the next call
+		if (this->numOfUnsubmitted > 0)
+		{
+			long submitted = syscall(__NR_io_uring_enter, this->ringFd, this->numOfUnsubmitted, 0, 0, NULL, 0);
+
+			if (submitted > 0)
+			{
+				this->numOfUnsubmitted -= submitted;
+			}
+		}
+	}
+#endif
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::ReapCompletions
+//
+// Complete the requests on the completion queue. Called with the latch
+// held.
+//--------------------------------------------------------------------
+
+void IOEngine::ReapCompletions()
+{
+#if IO_HAVE_URING
+	unsigned head = *this->cqHead;
+	unsigned mask = *this->cqMask;
+
+	while (head != __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE))
+	{
+		struct io_uring_cqe* cqe = (struct io_uring_cqe*)this->cqes + (head & mask);
+		IORequest* request = (IORequest*)(unsigned long)cqe->user_data;
+		long result = cqe->res;
+
+		head++;
+		this->numOfInFlight--;
+		this->Complete(request, result);
+	}
+
+	__atomic_store_n(this->cqHead, head, __ATOMIC_RELEASE);
+#endif
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::Complete
+//
+// Record the outcome of a request: the number of bytes transferred,
+// or minus the error number. If O_DIRECT was refused, later requests
+// are done buffered. The request belongs to its submitter again once
+// its batch has no more pending requests, so it is not touched after.
+// Called with the latch held.
+//--------------------------------------------------------------------
+
+void IOEngine::Complete(IORequest* request, long result)
+{
+	request->result = result;
+
+	if (request->direct && -EINVAL == result)
+	{
+		__atomic_store_n(&this->direct, false, __ATOMIC_RELEASE);
+	}
+
+	request->batch->numOfPending--;
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::Transfer
+//
+// Carry out a prepared request on fd with preadv or pwritev.
+// Returns the number of bytes transferred, or minus the error number.
+//--------------------------------------------------------------------
+
+long IOEngine::Transfer(int fd, IORequest* request)
+{
+	off_t offset = (off_t)request->pid * MINIBASE_PAGESIZE;
+	ssize_t size;
+
+	do
+	{
+		if (request->write)
+		{
+			size = pwritev(fd, request->iov, request->count, offset);
+		}
+		else
+		{
+			size = preadv(fd, request->iov, request->count, offset);
+		}
+	}
+	while (size < 0 && EINTR == errno);
+
+	return (size < 0) ? -errno : size;
+}
+
+
+//--------------------------------------------------------------------
+// IOEngine::RunWorker
+//
+// Body of the worker threads of the thread pool: take requests off the
+// queue and carry them out, without holding the latch meanwhile.
+//--------------------------------------------------------------------
+
+void* IOEngine::RunWorker(void* arg)
+{
+	IOEngine* engine = (IOEngine*)arg;
+
+	pthread_mutex_lock(&engine->latch);
+
+	while (!engine->stop)
+	{
+		if (NULL == engine->queueHead)
+		{
+			pthread_cond_wait(&engine->queued, &engine->latch);
+			continue;
+		}
+
+		IORequest* request = engine->queueHead;
+
+		engine->queueHead = request->next;
+		if (NULL == engine->queueHead)
+		{
+			engine->queueTail = NULL;
+		}
+		engine->numOfInFlight++;
+
+		int fd = request->direct ? engine->directFd : engine->bufferedFd;
+
+		pthread_mutex_unlock(&engine->latch);
+		long result = Transfer(fd, request);
+		pthread_mutex_lock(&engine->latch);
+
+		engine->numOfInFlight--;
+		engine->Complete(request, result);
+		pthread_cond_broadcast(&engine->completed);
+	}
+
+	pthread_mutex_unlock(&engine->latch);
+
+	return NULL;
+}
+
+
+Status IOEngine::Read(PageID pid, Page* page)
+{
+	IORequest request;
+
+	request.pid = pid;
+	request.count = 1;
+	request.pages = &page;
+	request.write = false;
+
+	return this->Submit(&request, 1);
+}
+
+
+Status IOEngine::Write(PageID pid, Page* page)
+{
+	IORequest request;
+
+	request.pid = pid;
+	request.count = 1;
+	request.pages = &page;
+	request.write = true;
+
+	return this->Submit(&request, 1);
+}
+
+
+const char* IOEngine::GetName()
+{
+	return (IO_URING == this->kind) ? "io_uring" : "threads";
+}
@@ -1,53 +1,105 @@
-#include <climits>
-
 #include "../include/lru.h"
 #include "../include/frame.h"
 
+LRU::LRU(int n, Frame** f) : Replacer(n, f)
+{
+	this->unpinned = new IndexLists(n, 1);
+	this->chances = new char[n];
+
+	for (int i = 0; i < n; i++)
+	{
+		this->unpinned->PushBack(UNPINNED, i);
+		this->chances[i] = 0;
+	}
+}
+
+
+LRU::~LRU()
+{
+	delete this->unpinned;
+	delete[] this->chances;
+}
+
+
 int LRU::PickVictim()
 {
-	int victimFrameIndex = INVALID_FRAME;
+	// The front is the victim unless it was pinned by another thread
+	// whose OnPin has not reached us yet, or has a chance left
+	int i = this->unpinned->Front(UNPINNED);
 
-	clock_t earliestTimestamp = LONG_MAX;
-	for (int i = 0; i < this->numOfBuf; i++)
+	while (INVALID_INDEX != i)
 	{
-		Frame& potentialVictim = (*this->frames)[i];
-		if (potentialVictim.NotPinned())
+		int next = this->unpinned->Next(i);
+		this->numOfExamined++;
+
+		if ((*this->frames)[i].NotPinned())
 		{
-			if (potentialVictim.GetTimestamp() < earliestTimestamp)
+			if (this->chances[i] > 0)
 			{
-				earliestTimestamp = potentialVictim.GetTimestamp();
-				victimFrameIndex = i;
+				// Comes round again, if it is the last one too
+				this->chances[i]--;
+				this->unpinned->MoveToBack(UNPINNED, i);
+				next = (INVALID_INDEX == next) ? i : next;
+			}
+			else if (this->Accept(i))
+			{
+				return i;
 			}
 		}
+
+		i = next;
 	}
 
-	return victimFrameIndex;
+	return INVALID_FRAME;
 }
 
 
-/*
-int Clock::PickVictim()
+//--------------------------------------------------------------------
+// LRU::NextVictims
+//
+// The unpinned frames in list order, those with no chances left first,
+// then the others with the fewest chances left, in as many passes.
+//--------------------------------------------------------------------
+
+int LRU::NextVictims(int* frameIds, int max)
 {
-	for (int i = 0; i < 2 * this->numOfBuf; i++) // Do two cycles
-	{
-		current = (current + i) % this->numOfBuf;
+	int count = 0;
 
-		Frame& potentialVictim = (*this->frames)[current];
-		if (potentialVictim.NotPinned())
+	for (int pass = 0; pass <= REPLACER_EXTRA_CHANCES; pass++)
+	{
+		for (int i = this->unpinned->Front(UNPINNED); INVALID_INDEX != i && count < max; i = this->unpinned->Next(i))
 		{
-			if (potentialVictim.IsReferenced())
+			if ((*this->frames)[i].NotPinned() && this->chances[i] == pass)
 			{
-				potentialVictim.DereferenceIt();
-			}
-			else
-			{
-				// Current frame gots to go
-				return current;
+				frameIds[count++] = i;
 			}
 		}
 	}
 
-	return INVALID_FRAME;
+	return count;
 }
-*/
 
+
+void LRU::OnUnpin(int frameId)
+{
+	if (PRIORITY_LOW == this->priorities[frameId])
+	{
+		this->unpinned->Remove(frameId);
+		this->unpinned->PushFront(UNPINNED, frameId);
+	}
+	else
+	{
+		this->unpinned->MoveToBack(UNPINNED, frameId);
+	}
+
+	this->chances[frameId] = (PRIORITY_HIGH == this->priorities[frameId]) ? REPLACER_EXTRA_CHANCES : 0;
+}
+
+
+void LRU::OnFree(int frameId)
+{
+	// Empty frames are reused before any frame holding a page
+	this->unpinned->Remove(frameId);
+	this->unpinned->PushFront(UNPINNED, frameId);
+	this->chances[frameId] = 0;
+}
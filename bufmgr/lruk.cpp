@@ -0,0 +1,221 @@
+#include <string.h>
+
+#include "../include/lruk.h"
+
+LRUK::LRUK(int numOfBuf, Frame** frames) : Replacer(numOfBuf, frames)
+{
+	this->now = 0;
+	this->history = new unsigned long[numOfBuf * LRUK_K];
+	this->ghostHistory = new unsigned long[numOfBuf * LRUK_K];
+	this->ghosts = new GhostList(numOfBuf);
+
+	memset(this->history, 0, numOfBuf * LRUK_K * sizeof(unsigned long));
+}
+
+
+LRUK::~LRUK()
+{
+	delete[] this->history;
+	delete[] this->ghostHistory;
+	delete this->ghosts;
+}
+
+
+//--------------------------------------------------------------------
+// LRUK::PickVictim
+//
+// Return the unpinned frame with the oldest K-th reference. Frames
+// with fewer than K references have a K-th reference time of 0 and
+// are therefore chosen first; ties are broken by the most recent
+// reference, so empty frames (no references at all) come first.
+//
+// All frames are scanned anyway, so when a clean victim is preferred
+// the best clean frame is taken if there is one, without a limit.
+//--------------------------------------------------------------------
+
+int LRUK::PickVictim()
+{
+	int victimFrameIndex = INVALID_FRAME;
+	int cleanFrameIndex = INVALID_FRAME;
+
+	for (int i = 0; i < this->numOfBuf; i++)
+	{
+		if ((*this->frames)[i].NotPinned())
+		{
+			if (this->Older(i, victimFrameIndex))
+			{
+				victimFrameIndex = i;
+			}
+
+			if (!(*this->frames)[i].IsDirty() && this->Older(i, cleanFrameIndex))
+			{
+				cleanFrameIndex = i;
+			}
+		}
+	}
+
+	this->numOfExamined += this->numOfBuf;
+
+	if (this->PrefersClean() && INVALID_FRAME != cleanFrameIndex)
+	{
+		victimFrameIndex = cleanFrameIndex;
+	}
+
+	return victimFrameIndex;
+}
+
+
+//--------------------------------------------------------------------
+// LRUK::NextVictims
+//
+// Select the max oldest unpinned frames with a bounded heap whose root
+// is the youngest of those selected so far, then sort them oldest
+// first. O(n log max).
+//--------------------------------------------------------------------
+
+int LRUK::NextVictims(int* frameIds, int max)
+{
+	int count = 0;
+
+	for (int i = 0; i < this->numOfBuf && max > 0; i++)
+	{
+		if (!(*this->frames)[i].NotPinned())
+		{
+			continue;
+		}
+
+		int hole;
+		if (count < max)
+		{
+			// Sift up from a new leaf
+			hole = count++;
+			while (hole > 0 && this->Older(frameIds[(hole - 1) / 2], i))
+			{
+				frameIds[hole] = frameIds[(hole - 1) / 2];
+				hole = (hole - 1) / 2;
+			}
+			frameIds[hole] = i;
+		}
+		else if (this->Older(i, frameIds[0]))
+		{
+			// Replace the root and sift down
+			hole = 0;
+			for (;;)
+			{
+				int child = 2 * hole + 1;
+				if (child >= count)
+				{
+					break;
+				}
+				if (child + 1 < count && this->Older(frameIds[child], frameIds[child + 1]))
+				{
+					child++;
+				}
+				if (!this->Older(i, frameIds[child]))
+				{
+					break;
+				}
+				frameIds[hole] = frameIds[child];
+				hole = child;
+			}
+			frameIds[hole] = i;
+		}
+	}
+
+	// Heap sort: repeatedly move the youngest to the end
+	for (int end = count - 1; end > 0; end--)
+	{
+		int youngest = frameIds[0];
+		int last = frameIds[end];
+		int hole = 0;
+
+		for (;;)
+		{
+			int child = 2 * hole + 1;
+			if (child >= end)
+			{
+				break;
+			}
+			if (child + 1 < end && this->Older(frameIds[child], frameIds[child + 1]))
+			{
+				child++;
+			}
+			if (!this->Older(last, frameIds[child]))
+			{
+				break;
+			}
+			frameIds[hole] = frameIds[child];
+			hole = child;
+		}
+		frameIds[hole] = last;
+		frameIds[end] = youngest;
+	}
+
+	return count;
+}
+
+
+//--------------------------------------------------------------------
+// LRUK::Older
+//
+// True if frame a should be replaced before frame b (or b is invalid).
+//--------------------------------------------------------------------
+
+bool LRUK::Older(int a, int b)
+{
+	if (INVALID_FRAME == b)
+	{
+		return true;
+	}
+
+	unsigned long* ha = this->HistoryOf(a);
+	unsigned long* hb = this->HistoryOf(b);
+
+	return ha[LRUK_K - 1] < hb[LRUK_K - 1]
+		|| (ha[LRUK_K - 1] == hb[LRUK_K - 1] && ha[0] < hb[0]);
+}
+
+
+void LRUK::OnLoad(int frameId)
+{
+	unsigned long* h = this->HistoryOf(frameId);
+	PageID pid = (*this->frames)[frameId].GetPageID();
+
+	// Restore the references the page had before it was evicted
+	int entry = this->ghosts->Find(pid);
+	if (INVALID_INDEX != entry)
+	{
+		memcpy(h, this->ghostHistory + entry * LRUK_K, LRUK_K * sizeof(unsigned long));
+		this->ghosts->Remove(pid);
+	}
+
+	this->OnPin(frameId);
+}
+
+
+void LRUK::OnPin(int frameId)
+{
+	unsigned long* h = this->HistoryOf(frameId);
+
+	for (int k = LRUK_K - 1; k > 0; k--)
+	{
+		h[k] = h[k - 1];
+	}
+
+	h[0] = ++this->now;
+}
+
+
+void LRUK::OnEvict(int frameId)
+{
+	PageID pid = (*this->frames)[frameId].GetPageID();
+	int entry = this->ghosts->Insert(pid);
+
+	memcpy(this->ghostHistory + entry * LRUK_K, this->HistoryOf(frameId), LRUK_K * sizeof(unsigned long));
+}
+
+
+void LRUK::OnFree(int frameId)
+{
+	memset(this->HistoryOf(frameId), 0, LRUK_K * sizeof(unsigned long));
+}
@@ -0,0 +1,206 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../include/mappeddb.h"
+
+//--------------------------------------------------------------------
+// Constructor for MappedDB
+//
+// Input   : fileName   - the database file
+//           numOfPages - the number of pages in it
+// Output  : status     - OK if the file could be mapped, FAIL otherwise
+// PostCond: No page is pinned.
+//--------------------------------------------------------------------
+
+MappedDB::MappedDB(const char* fileName, int numOfPages, Status& status)
+{
+	this->base = NULL;
+	this->size = (unsigned long)numOfPages * MINIBASE_PAGESIZE;
+	this->numOfPages = numOfPages;
+	this->pinCounts = new int[numOfPages > 0 ? numOfPages : 1];
+	this->numOfPinnedPages = 0;
+
+	for (int i = 0; i < numOfPages; i++)
+	{
+		this->pinCounts[i] = 0;
+	}
+
+	status = (numOfPages > 0) ? OK : FAIL;
+
+	int fd = (OK == status) ? open(fileName, O_RDWR) : -1;
+
+	if (fd < 0)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		void* mapping = mmap(NULL, this->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+		if (MAP_FAILED == mapping)
+		{
+			status = FAIL;
+		}
+		else
+		{
+			this->base = (char*)mapping;
+		}
+	}
+
+	// The mapping keeps the file open
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+}
+
+
+MappedDB::~MappedDB()
+{
+	if (NULL != this->base)
+	{
+		munmap(this->base, this->size);
+	}
+
+	delete[] this->pinCounts;
+}
+
+
+//--------------------------------------------------------------------
+// MappedDB::Pin
+//
+// Input    : pid  - page id of a page of the database
+// Output   : page - the page, in the mapping (NULL if fail)
+// Return   : FAIL if pid is not a page of the database.
+//--------------------------------------------------------------------
+
+Status MappedDB::Pin(PageID pid, Page*& page)
+{
+	Status status = OK;
+	page = NULL;
+
+	if (!this->IsValid(pid))
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		if (1 == __atomic_add_fetch(&this->pinCounts[pid], 1, __ATOMIC_ACQ_REL))
+		{
+			__atomic_add_fetch(&this->numOfPinnedPages, 1, __ATOMIC_RELAXED);
+		}
+
+		page = (Page*)(this->base + (unsigned long)pid * MINIBASE_PAGESIZE);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// MappedDB::Unpin
+//
+// Input    : pid - page id of a pinned page
+// Output   : None
+// Return   : FAIL if the page is not pinned.
+//--------------------------------------------------------------------
+
+Status MappedDB::Unpin(PageID pid)
+{
+	Status status = OK;
+
+	if (!this->IsValid(pid))
+	{
+		status = FAIL;
+	}
+
+	// Take the pin back unless there is none
+	int pinCount = (OK == status) ? __atomic_load_n(&this->pinCounts[pid], __ATOMIC_RELAXED) : 0;
+	bool unpinned = false;
+
+	while (OK == status && !unpinned)
+	{
+		if (0 == pinCount)
+		{
+			status = FAIL;
+		}
+		else
+		{
+			unpinned = __atomic_compare_exchange_n(&this->pinCounts[pid], &pinCount, pinCount - 1,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+		}
+	}
+
+	if (OK == status && 1 == pinCount)
+	{
+		__atomic_sub_fetch(&this->numOfPinnedPages, 1, __ATOMIC_RELAXED);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// MappedDB::Flush
+//
+// Input    : pid   - page id of the first page to write
+//            count - the number of pages
+// Output   : None
+// Purpose  : Write the pages back to the file, if they were modified,
+//            and wait for the writes to complete.
+// Return   : FAIL if the pages are not in the database or cannot be
+//            written.
+//--------------------------------------------------------------------
+
+Status MappedDB::Flush(PageID pid, int count)
+{
+	Status status = OK;
+
+	if (!this->IsValid(pid) || count < 1 || pid + count > this->numOfPages)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		// msync wants an address aligned to the system page size
+		unsigned long systemPageSize = sysconf(_SC_PAGESIZE);
+		unsigned long start = (unsigned long)pid * MINIBASE_PAGESIZE / systemPageSize * systemPageSize;
+		unsigned long end = (unsigned long)(pid + count) * MINIBASE_PAGESIZE;
+
+		if (0 != msync(this->base + start, end - start, MS_SYNC))
+		{
+			status = FAIL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// MappedDB::Prefetch
+//
+// Have the operating system start reading the pages in. Pages out of
+// the database are ignored.
+//--------------------------------------------------------------------
+
+void MappedDB::Prefetch(PageID pid, int count)
+{
+	if (pid + count > this->numOfPages)
+	{
+		count = this->numOfPages - pid;
+	}
+
+	if (this->IsValid(pid) && count > 0)
+	{
+		unsigned long systemPageSize = sysconf(_SC_PAGESIZE);
+		unsigned long start = (unsigned long)pid * MINIBASE_PAGESIZE / systemPageSize * systemPageSize;
+		unsigned long end = (unsigned long)(pid + count) * MINIBASE_PAGESIZE;
+
+		madvise(this->base + start, end - start, MADV_WILLNEED);
+	}
+}
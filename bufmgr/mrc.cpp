@@ -0,0 +1,197 @@
+#include "../include/mrc.h"
+
+// The pool sizes of the estimates, in halves of the actual size
+static const int halfMultiples[MRC_POINTS] = { 1, 2, 4, 8 };
+
+MRCEstimator::MRCEstimator(int poolSize)
+{
+	pthread_mutex_init(&this->latch, NULL);
+
+	this->pids = new PageID[MRC_MAX_SAMPLES];
+	this->index = new HashTable(MRC_MAX_SAMPLES);
+	this->segments = new IndexLists(MRC_MAX_SAMPLES, MRC_POINTS + 1);
+
+	this->Reset(poolSize, 0);
+}
+
+
+MRCEstimator::~MRCEstimator()
+{
+	delete[] this->pids;
+	delete this->index;
+	delete this->segments;
+	pthread_mutex_destroy(&this->latch);
+}
+
+
+//--------------------------------------------------------------------
+// MRCEstimator::Access
+//
+// Input    : pid - a sampled page, just pinned
+// Output   : None
+// Purpose  : Count a hit at the pool sizes the page's reuse distance is
+//            below, if it was seen before, and make it the most
+//            recently used. The oldest page of each segment that is too
+//            long moves on to the next one, and out of the last.
+//--------------------------------------------------------------------
+
+void MRCEstimator::Access(PageID pid)
+{
+	pthread_mutex_lock(&this->latch);
+
+	this->numOfSamples++;
+
+	int entry = this->index->LookUp(pid);
+
+	if (INVALID_FRAME != entry)
+	{
+		this->hits[this->segments->ListOf(entry)]++;
+		this->segments->MoveToBack(0, entry);
+	}
+	else
+	{
+		// All entries are in use only if the segments add up to
+		// MRC_MAX_SAMPLES; make room by dropping the oldest page
+		if (0 == this->segments->Size(UNUSED))
+		{
+			int last = MRC_POINTS - 1;
+			while (0 == this->segments->Size(last))
+			{
+				last--;
+			}
+
+			int oldest = this->segments->Front(last);
+			this->index->Delete(this->pids[oldest]);
+			this->segments->MoveToBack(UNUSED, oldest);
+		}
+
+		entry = this->segments->Front(UNUSED);
+		this->segments->MoveToBack(0, entry);
+		this->pids[entry] = pid;
+		this->index->Insert(pid, entry);
+	}
+
+	for (int i = 0; i < MRC_POINTS; i++)
+	{
+		while (this->segments->Size(i) > this->capacities[i])
+		{
+			int oldest = this->segments->Front(i);
+
+			if (i + 1 < MRC_POINTS)
+			{
+				this->segments->MoveToBack(i + 1, oldest);
+			}
+			else
+			{
+				this->index->Delete(this->pids[oldest]);
+				this->segments->MoveToBack(UNUSED, oldest);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&this->latch);
+}
+
+
+//--------------------------------------------------------------------
+// MRCEstimator::Reset
+//
+// Input    : poolSize  - the number of frames of the pool
+//            numOfPins - the pins of the pool so far
+// Output   : None
+// Purpose  : Choose the sampling threshold and the segment sizes for
+//            the pool size, and start with no pages and no counts.
+//--------------------------------------------------------------------
+
+void MRCEstimator::Reset(int poolSize, long numOfPins)
+{
+	pthread_mutex_lock(&this->latch);
+
+	long covered = 4L * ((poolSize > 0) ? poolSize : 1);
+	long threshold = MRC_HASH_RANGE >> MRC_RATE_SHIFT;
+
+	if (covered > (MRC_MAX_SAMPLES << MRC_RATE_SHIFT))
+	{
+		threshold = (long)MRC_HASH_RANGE * MRC_MAX_SAMPLES / covered;
+	}
+
+	this->poolSize = poolSize;
+	__atomic_store_n(&this->threshold, (unsigned int)((threshold > 0) ? threshold : 1), __ATOMIC_RELAXED);
+
+	// The sampled pages within each pool size, less those of the
+	// smaller ones
+	long below = 0;
+	for (int i = 0; i < MRC_POINTS; i++)
+	{
+		long within = (long)halfMultiples[i] * poolSize * this->threshold / (2L * MRC_HASH_RANGE);
+
+		this->capacities[i] = (int)(within - below);
+		below = within;
+	}
+
+	this->index->EmptyIt();
+	this->segments->EmptyIt();
+	for (int i = 0; i < MRC_MAX_SAMPLES; i++)
+	{
+		this->pids[i] = INVALID_PAGE;
+		this->segments->PushBack(UNUSED, i);
+	}
+
+	pthread_mutex_unlock(&this->latch);
+
+	this->ResetCounts(numOfPins);
+}
+
+
+void MRCEstimator::ResetCounts(long numOfPins)
+{
+	pthread_mutex_lock(&this->latch);
+
+	this->numOfSamples = 0;
+	for (int i = 0; i < MRC_POINTS; i++)
+	{
+		this->hits[i] = 0;
+	}
+	this->pinsAtReset = numOfPins;
+
+	pthread_mutex_unlock(&this->latch);
+}
+
+
+//--------------------------------------------------------------------
+// MRCEstimator::GetHitRatios
+//
+// Input    : numOfPins - the pins of the pool so far
+// Output   : poolSizes - the MRC_POINTS pool sizes estimated for
+//            hitRatios - the estimated hit ratio at each size, between
+//                        0 and 1
+// Purpose  : Scale the sampled counts up to all the pins since the
+//            counts were reset. The pins the sampling rate should have
+//            given but did not (or gave in excess) are counted as hits
+//            at the smallest size, as in SHARDS-adj, which makes up for
+//            a sample with too few (or too many) of the popular pages.
+// Return   : The number of pins sampled.
+//--------------------------------------------------------------------
+
+long MRCEstimator::GetHitRatios(long numOfPins, int* poolSizes, double* hitRatios)
+{
+	pthread_mutex_lock(&this->latch);
+
+	double rate = (double)this->threshold / MRC_HASH_RANGE;
+	double expected = (numOfPins - this->pinsAtReset) * rate;
+	double hits = expected - this->numOfSamples;
+	long numOfSamples = this->numOfSamples;
+
+	for (int i = 0; i < MRC_POINTS; i++)
+	{
+		hits += this->hits[i];
+
+		poolSizes[i] = (int)((long)halfMultiples[i] * this->poolSize / 2);
+		hitRatios[i] = (expected > 0 && hits > 0) ? hits / expected : 0.0;
+		hitRatios[i] = (hitRatios[i] < 1.0) ? hitRatios[i] : 1.0;
+	}
+
+	pthread_mutex_unlock(&this->latch);
+
+	return numOfSamples;
+}
@@ -0,0 +1,94 @@
+#include "../include/pageguard.h"
+#include "../include/bufmgr.h"
+
+PageGuard::PageGuard()
+{
+	this->Reset();
+}
+
+
+PageGuard::PageGuard(PageGuard&& other)
+{
+	this->bufMgr = other.bufMgr;
+	this->pid = other.pid;
+	this->frameId = other.frameId;
+	this->page = other.page;
+	this->dirty = other.dirty;
+
+	other.Reset();
+}
+
+
+PageGuard& PageGuard::operator=(PageGuard&& other)
+{
+	if (this != &other)
+	{
+		this->Release();
+
+		this->bufMgr = other.bufMgr;
+		this->pid = other.pid;
+		this->frameId = other.frameId;
+		this->page = other.page;
+		this->dirty = other.dirty;
+
+		other.Reset();
+	}
+
+	return *this;
+}
+
+
+PageGuard::~PageGuard()
+{
+	this->Release();
+}
+
+
+void PageGuard::Reset()
+{
+	this->bufMgr = NULL;
+	this->pid = INVALID_PAGE;
+	this->frameId = INVALID_FRAME;
+	this->page = NULL;
+	this->dirty = false;
+}
+
+
+//--------------------------------------------------------------------
+// PageGuard::Release
+//
+// Input    : None
+// Output   : None
+// Purpose  : Unpin the page through the frame it was pinned in, dirty
+//            if DirtyIt was called, and leave the guard empty.
+// Return   : OK if the page was unpinned. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status PageGuard::Release()
+{
+	Status status = FAIL;
+
+	if (NULL != this->bufMgr)
+	{
+		status = this->bufMgr->UnpinFrame(this->frameId, this->pid, this->dirty);
+		this->Reset();
+	}
+
+	return status;
+}
+
+
+Page* PageGuard::Detach()
+{
+	Page* page = this->page;
+
+	if (NULL != this->bufMgr && this->dirty)
+	{
+		// Keep the mark, which the caller may not know about
+		this->bufMgr->MarkDirty(this->frameId, this->pid);
+	}
+
+	this->Reset();
+
+	return page;
+}
@@ -0,0 +1,226 @@
+#include <strings.h>
+
+#include "../include/replacer.h"
+#include "../include/lru.h"
+#include "../include/lruk.h"
+#include "../include/twoq.h"
+#include "../include/arc.h"
+
+Replacer::Replacer(int numOfBuf, Frame** frames)
+{
+	this->numOfBuf = numOfBuf;
+	this->frames = frames;
+	this->numOfExamined = 0;
+	this->cleanSearch = -1;
+	this->firstDirty = INVALID_FRAME;
+
+	this->priorities = new char[numOfBuf];
+	for (int i = 0; i < numOfBuf; i++)
+	{
+		this->priorities[i] = PRIORITY_NORMAL;
+	}
+}
+
+
+Replacer::~Replacer()
+{
+	delete[] this->priorities;
+}
+
+
+//--------------------------------------------------------------------
+// Replacer::PickCleanVictim
+//
+// Input    : searchLimit - how many dirty candidates to pass over
+// Output   : None
+// Purpose  : Like PickVictim, but prefer a frame that is not dirty, so
+//            that it can be reused without waiting for a write. Up to
+//            searchLimit dirty candidates, in replacement order, are
+//            passed over; if no clean one turns up, the first of them
+//            is the victim.
+// Return   : The victim, INVALID_FRAME if every frame is pinned.
+//--------------------------------------------------------------------
+
+int Replacer::PickCleanVictim(int searchLimit)
+{
+	this->cleanSearch = (searchLimit > 0) ? searchLimit : 0;
+	this->firstDirty = INVALID_FRAME;
+
+	int victimFrameIndex = this->PickVictim();
+
+	if (INVALID_FRAME != this->firstDirty
+		&& (INVALID_FRAME == victimFrameIndex || (*this->frames)[victimFrameIndex].IsDirty()))
+	{
+		victimFrameIndex = this->firstDirty;
+	}
+
+	this->cleanSearch = -1;
+
+	return victimFrameIndex;
+}
+
+
+//--------------------------------------------------------------------
+// Replacer::Accept
+//
+// Called by PickVictim for each frame it would return, in replacement
+// order. Returns false to make it look further for a clean frame.
+//--------------------------------------------------------------------
+
+bool Replacer::Accept(int frameId)
+{
+	if (!this->PrefersClean() || !(*this->frames)[frameId].IsDirty())
+	{
+		return true;
+	}
+
+	if (INVALID_FRAME == this->firstDirty)
+	{
+		this->firstDirty = frameId;
+	}
+
+	return (--this->cleanSearch <= 0);
+}
+
+
+//--------------------------------------------------------------------
+// Replacer::Create
+//
+// Input    : policy   - name of the replacement policy (may be NULL)
+//            numOfBuf - number of frames in the buffer pool
+//            frames   - the frame array of the buffer pool
+// Output   : None
+// Purpose  : Instantiate the replacement policy selected by name.
+// Return   : The new replacer, NULL if the policy is unknown.
+//--------------------------------------------------------------------
+
+Replacer* Replacer::Create(const char* policy, int numOfBuf, Frame** frames)
+{
+	if (NULL == policy || 0 == strcasecmp(policy, "LRU"))
+	{
+		return new LRU(numOfBuf, frames);
+	}
+
+	if (0 == strcasecmp(policy, "Clock"))
+	{
+		return new Clock(numOfBuf, frames);
+	}
+
+	if (0 == strcasecmp(policy, "LRU-K") || 0 == strcasecmp(policy, "LRUK"))
+	{
+		return new LRUK(numOfBuf, frames);
+	}
+
+	if (0 == strcasecmp(policy, "2Q"))
+	{
+		return new TwoQ(numOfBuf, frames);
+	}
+
+	if (0 == strcasecmp(policy, "ARC"))
+	{
+		return new ARC(numOfBuf, frames);
+	}
+
+	return NULL;
+}
+
+
+Clock::Clock(int numOfBuf, Frame** frames) : Replacer(numOfBuf, frames)
+{
+	this->current = 0;
+	this->referenced = new char[numOfBuf];
+
+	for (int i = 0; i < numOfBuf; i++)
+	{
+		this->referenced[i] = 0;
+	}
+}
+
+
+Clock::~Clock()
+{
+	delete[] this->referenced;
+}
+
+
+int Clock::PickVictim()
+{
+	// Do two cycles, and one more for each extra chance
+	for (int i = 0; i < (2 + REPLACER_EXTRA_CHANCES) * this->numOfBuf; i++)
+	{
+		int candidate = this->current;
+		this->current = (this->current + 1) % this->numOfBuf;
+		this->numOfExamined++;
+
+		// A pin may set the count meanwhile; losing the decrement then
+		// only gives the frame one more sweep
+		Frame& potentialVictim = (*this->frames)[candidate];
+		char referenced = __atomic_load_n(&this->referenced[candidate], __ATOMIC_RELAXED);
+		if (potentialVictim.NotPinned())
+		{
+			if (referenced > 0)
+			{
+				__atomic_store_n(&this->referenced[candidate], referenced - 1, __ATOMIC_RELAXED);
+			}
+			else if (this->Accept(candidate))
+			{
+				// Current frame gots to go
+				return candidate;
+			}
+		}
+	}
+
+	return INVALID_FRAME;
+}
+
+
+//--------------------------------------------------------------------
+// Clock::NextVictims
+//
+// The unpinned frames from the hand onwards whose reference bit is
+// clear go first; those with the bit set follow, as they would only
+// go on the second sweep, or a later one for a high priority frame.
+//--------------------------------------------------------------------
+
+int Clock::NextVictims(int* frameIds, int max)
+{
+	int count = 0;
+
+	for (int sweep = 0; sweep < 2 + REPLACER_EXTRA_CHANCES; sweep++)
+	{
+		for (int i = 0; count < max && i < this->numOfBuf; i++)
+		{
+			int candidate = (this->current + i) % this->numOfBuf;
+
+			if ((*this->frames)[candidate].NotPinned() && __atomic_load_n(&this->referenced[candidate], __ATOMIC_RELAXED) == sweep)
+			{
+				frameIds[count++] = candidate;
+			}
+		}
+	}
+
+	return count;
+}
+
+
+//--------------------------------------------------------------------
+// Clock::OnUnpin
+//
+// The frame keeps its reference bit, set by the pin, unless its
+// priority says otherwise: a low priority frame goes on the next sweep
+// that reaches it, a high priority one survives the extra chances too.
+//--------------------------------------------------------------------
+
+void Clock::OnUnpin(int frameId)
+{
+	int priority = this->GetPriority(frameId);
+
+	if (PRIORITY_LOW == priority)
+	{
+		__atomic_store_n(&this->referenced[frameId], 0, __ATOMIC_RELAXED);
+	}
+	else if (PRIORITY_HIGH == priority)
+	{
+		__atomic_store_n(&this->referenced[frameId], 1 + REPLACER_EXTRA_CHANCES, __ATOMIC_RELAXED);
+	}
+}
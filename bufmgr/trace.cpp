@@ -0,0 +1,779 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/trace.h"
+#include "../include/bufmgr.h"
+
+// Entries a trace starts out with room for
+#define TRACE_INITIAL_CAPACITY 1024
+
+// What a recorded trace file starts with
+struct TraceFileHeader
+{
+	int magic;
+	int pageSize;
+	int recordSize;
+	int reserved;
+};
+
+//--------------------------------------------------------------------
+// The next number of the linear congruential generator used by the
+// benchmarks, from 0 to 2^24 - 1.
+//--------------------------------------------------------------------
+
+static int NextRandom(unsigned int& seed)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return (seed >> 8) & 0xffffff;
+}
+
+
+//--------------------------------------------------------------------
+// A number drawn uniformly from [low, high].
+//--------------------------------------------------------------------
+
+static int Uniform(unsigned int& seed, int low, int high)
+{
+	// Two draws, for ranges wider than 2^24
+	long value = ((long)NextRandom(seed) << 24) | NextRandom(seed);
+
+	return low + (int)(value % (high - low + 1));
+}
+
+
+//--------------------------------------------------------------------
+// TPC-C's non-uniform random number in [low, high] (clause 2.1.6).
+//--------------------------------------------------------------------
+
+static int NURand(unsigned int& seed, int a, int c, int low, int high)
+{
+	return (((Uniform(seed, 0, a) | Uniform(seed, low, high)) + c) % (high - low + 1)) + low;
+}
+
+
+//--------------------------------------------------------------------
+// ZipfGenerator
+//
+// Draws ranks from 0 to n - 1, rank i with a probability proportional
+// to 1 / (i + 1)^theta, with the method of Gray et al., "Quickly
+// Generating Billion-Record Synthetic Databases". Setting up takes
+// time linear in n, each draw constant time. Scatter spreads the
+// ranks over the range, so that the popular pages are not next to
+// each other.
+//--------------------------------------------------------------------
+
+class ZipfGenerator
+{
+	private:
+
+		int    n;
+		double theta;
+		double zetaN;
+		double alpha;
+		double eta;
+		long   stride;
+
+	public:
+
+		ZipfGenerator(int n, double theta)
+		{
+			double zeta2 = 1.0 + pow(0.5, theta);
+
+			this->n = n;
+			this->theta = theta;
+			this->zetaN = 0;
+			for (int i = 1; i <= n; i++)
+			{
+				this->zetaN += 1.0 / pow(i, theta);
+			}
+
+			this->alpha = 1.0 / (1.0 - theta);
+			this->eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / this->zetaN);
+
+			// A stride prime to n makes rank * stride % n a permutation
+			this->stride = 2654435761L % n;
+			while (n > 1 && !this->IsPrimeToN(this->stride))
+			{
+				this->stride = (this->stride + 1) % n;
+			}
+		}
+
+		bool IsPrimeToN(long value)
+		{
+			long a = value;
+			long b = this->n;
+
+			while (b != 0)
+			{
+				long rest = a % b;
+				a = b;
+				b = rest;
+			}
+
+			return 1 == a;
+		}
+
+		int Next(unsigned int& seed)
+		{
+			double u = (double)Uniform(seed, 0, (1 << 30) - 1) / (1 << 30);
+			double uz = u * this->zetaN;
+			int rank;
+
+			if (uz < 1.0)
+			{
+				rank = 0;
+			}
+			else if (uz < 1.0 + pow(0.5, this->theta))
+			{
+				rank = 1;
+			}
+			else
+			{
+				rank = (int)(this->n * pow(this->eta * u - this->eta + 1.0, this->alpha));
+			}
+
+			return (rank < this->n) ? rank : this->n - 1;
+		}
+
+		int Scatter(int rank)
+		{
+			return (int)(rank * this->stride % this->n);
+		}
+};
+
+
+Trace::Trace(const char* name)
+{
+	this->entries = new TraceEntry[TRACE_INITIAL_CAPACITY];
+	this->capacity = TRACE_INITIAL_CAPACITY;
+	this->count = 0;
+	this->numOfPages = 0;
+
+	strncpy(this->name, name, TRACE_NAME_LENGTH - 1);
+	this->name[TRACE_NAME_LENGTH - 1] = '\0';
+}
+
+
+Trace::~Trace()
+{
+	delete[] this->entries;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::Add
+//
+// Input    : page      - page number, from 0
+//            write     - whether the page is unpinned dirty
+//            pageClass - what the page holds, see PageClass
+// Output   : None
+// Purpose  : Append an access to the trace.
+//--------------------------------------------------------------------
+
+void Trace::Add(int page, bool write, int pageClass)
+{
+	if (this->count == this->capacity)
+	{
+		TraceEntry* entries = new TraceEntry[2 * this->capacity];
+
+		memcpy(entries, this->entries, this->count * sizeof(TraceEntry));
+		delete[] this->entries;
+
+		this->entries = entries;
+		this->capacity *= 2;
+	}
+
+	this->entries[this->count].page = page;
+	this->entries[this->count].write = write ? 1 : 0;
+	this->entries[this->count].pageClass = pageClass;
+	this->count++;
+
+	if (page >= this->numOfPages)
+	{
+		this->numOfPages = page + 1;
+	}
+}
+
+
+//--------------------------------------------------------------------
+// Trace::Load
+//
+// Input    : fileName - a trace file, text or recorded, in the formats
+//                       described in trace.h
+// Output   : None
+// Purpose  : Append the accesses in the file to the (empty) trace.
+// Return   : OK, FAIL if the file cannot be read or holds anything but
+//            accesses.
+//--------------------------------------------------------------------
+
+Status Trace::Load(const char* fileName)
+{
+	Status status = OK;
+	FILE* file = fopen(fileName, "rb");
+	int magic = 0;
+
+	if (NULL == file)
+	{
+		cerr << "Cannot open trace " << fileName << endl;
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		if (1 == fread(&magic, sizeof(magic), 1, file) && TRACE_MAGIC == magic)
+		{
+			status = this->LoadRecords(file, fileName);
+		}
+		else
+		{
+			rewind(file);
+			status = this->LoadText(file, fileName);
+		}
+
+		fclose(file);
+	}
+
+	// Make the pages relative to the first one
+	if (OK == status && this->count > 0)
+	{
+		int firstPage = this->entries[0].page;
+
+		for (int i = 1; i < this->count; i++)
+		{
+			if (this->entries[i].page < firstPage)
+			{
+				firstPage = this->entries[i].page;
+			}
+		}
+
+		for (int i = 0; i < this->count; i++)
+		{
+			this->entries[i].page -= firstPage;
+		}
+
+		this->numOfPages -= firstPage;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::LoadText
+//
+// Input    : file     - a text trace, open at its beginning
+//            fileName - its name, for error messages
+// Output   : None
+// Purpose  : Append the accesses in the file to the trace.
+// Return   : OK, FAIL if a line is not an access.
+//--------------------------------------------------------------------
+
+Status Trace::LoadText(FILE* file, const char* fileName)
+{
+	Status status = OK;
+	char line[256];
+	int lineNo = 0;
+
+	while (OK == status && NULL != fgets(line, sizeof(line), file))
+	{
+		char access[8];
+		int pid;
+		int pageClass = PAGE_CLASS_DATA;
+		int numOfFields = sscanf(line, "%d %7s %d", &pid, access, &pageClass);
+
+		lineNo++;
+
+		if (numOfFields <= 0 || '#' == line[0])
+		{
+			continue;
+		}
+
+		if (numOfFields < 2 || pid < 0 || pid >= TRACE_MAX_PAGE || (0 != strcmp(access, "r") && 0 != strcmp(access, "w"))
+			|| pageClass < 0 || pageClass >= NUM_OF_PAGE_CLASSES)
+		{
+			cerr << fileName << ":" << lineNo << ": not an access" << endl;
+			status = FAIL;
+		}
+		else
+		{
+			this->Add(pid, 'w' == access[0], pageClass);
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::LoadRecords
+//
+// Input    : file     - a file written by TraceRecorder, past the magic
+//                       number
+//            fileName - its name, for error messages
+// Output   : None
+// Purpose  : Append an access to the trace for each pin recorded, and
+//            make it a write if the page is unpinned dirty before its
+//            next pin.
+// Return   : OK, FAIL if the file is not a trace of this page size.
+//--------------------------------------------------------------------
+
+Status Trace::LoadRecords(FILE* file, const char* fileName)
+{
+	Status status = OK;
+	TraceFileHeader header;
+	TraceRecord record;
+
+	// The entry of the last pin of each page, by page id; as large as
+	// the number of pages touched, whatever their ids
+	HashTable* lastPins = new HashTable(TRACE_RECORD_BUFFER);
+
+	rewind(file);
+
+	if (1 != fread(&header, sizeof(header), 1, file) || MINIBASE_PAGESIZE != header.pageSize
+		|| sizeof(TraceRecord) != header.recordSize)
+	{
+		cerr << fileName << ": not a trace of " << MINIBASE_PAGESIZE << " byte pages" << endl;
+		status = FAIL;
+	}
+
+	while (OK == status && 1 == fread(&record, sizeof(record), 1, file))
+	{
+		if (record.pid < 0 || record.pid >= TRACE_MAX_PAGE
+			|| (TRACE_PIN != record.type && TRACE_UNPIN != record.type))
+		{
+			cerr << fileName << ": bad record of page " << record.pid << endl;
+			status = FAIL;
+		}
+
+		if (OK == status && TRACE_PIN == record.type)
+		{
+			int pageClass = (record.pageClass >= 0 && record.pageClass < NUM_OF_PAGE_CLASSES)
+				? record.pageClass : PAGE_CLASS_OTHER;
+
+			lastPins->Insert(record.pid, this->count);
+			this->Add(record.pid, false, pageClass);
+		}
+		else if (OK == status && record.dirty)
+		{
+			int lastPin = lastPins->LookUp(record.pid);
+
+			if (INVALID_FRAME != lastPin)
+			{
+				this->entries[lastPin].write = 1;
+			}
+		}
+	}
+
+	delete lastPins;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::Save
+//
+// Input    : fileName - the trace file to write
+// Output   : None
+// Purpose  : Write the accesses of the trace to the file, in the
+//            format Load reads.
+// Return   : OK, FAIL if the file cannot be written.
+//--------------------------------------------------------------------
+
+Status Trace::Save(const char* fileName)
+{
+	Status status = OK;
+	FILE* file = fopen(fileName, "w");
+
+	if (NULL == file)
+	{
+		cerr << "Cannot create trace " << fileName << endl;
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		fprintf(file, "# %s: %d accesses to %d pages\n", this->name, this->count, this->numOfPages);
+
+		for (int i = 0; i < this->count; i++)
+		{
+			fprintf(file, "%d %c %d\n", this->entries[i].page, this->entries[i].write ? 'w' : 'r',
+				this->entries[i].pageClass);
+		}
+
+		if (0 != fclose(file))
+		{
+			status = FAIL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::Zipf
+//
+// Input    : numOfPages - pages the accesses are spread over
+//            count      - number of accesses
+//            theta      - skew, from 0 (uniform) up to, not including, 1
+//            writeEvery - one access in writeEvery is a write, none if 0
+//            seed       - of the random number generator
+// Output   : None
+// Return   : The new trace, to be deleted by the caller.
+//--------------------------------------------------------------------
+
+Trace* Trace::Zipf(int numOfPages, int count, double theta, int writeEvery, unsigned int seed)
+{
+	Trace* trace = new Trace("zipf");
+	ZipfGenerator zipf(numOfPages, theta);
+
+	for (int i = 0; i < count; i++)
+	{
+		bool write = writeEvery > 0 && 0 == NextRandom(seed) % writeEvery;
+
+		trace->Add(zipf.Scatter(zipf.Next(seed)), write, PAGE_CLASS_DATA);
+	}
+
+	return trace;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::Loop
+//
+// Input    : numOfPages - pages scanned
+//            count      - number of accesses
+// Output   : None
+// Return   : The new trace, to be deleted by the caller.
+//--------------------------------------------------------------------
+
+Trace* Trace::Loop(int numOfPages, int count)
+{
+	Trace* trace = new Trace("loop");
+
+	for (int i = 0; i < count; i++)
+	{
+		trace->Add(i % numOfPages, false, PAGE_CLASS_DATA);
+	}
+
+	return trace;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::ScanPoint
+//
+// Input    : numOfPages - pages of the index and the table together
+//            count      - number of accesses
+//            seed       - of the random number generator
+// Output   : None
+// Purpose  : The index is laid out first: its root, inner pages of a
+//            fanout of 100 and one leaf per ten data pages. Lookups
+//            pick a data page with a skew of 0.99 and descend to it.
+// Return   : The new trace, to be deleted by the caller.
+//--------------------------------------------------------------------
+
+Trace* Trace::ScanPoint(int numOfPages, int count, unsigned int seed)
+{
+	Trace* trace = new Trace("scanpoint");
+	int numOfLeaves = (numOfPages - 1) / 11;
+	int numOfInner = (numOfLeaves + 99) / 100;
+	int numOfLeavesAndInner = numOfLeaves + numOfInner;
+
+	if (numOfLeaves < 1 || numOfPages - 1 - numOfLeavesAndInner < 1)
+	{
+		numOfLeaves = numOfInner = numOfLeavesAndInner = 0;
+	}
+
+	int firstLeaf = 1 + numOfInner;
+	int firstData = 1 + numOfLeavesAndInner;
+	int numOfData = numOfPages - firstData;
+	int scanned = 0;
+	ZipfGenerator zipf(numOfData, 0.99);
+
+	while (trace->GetCount() < count)
+	{
+		int data = zipf.Scatter(zipf.Next(seed));
+
+		if (numOfLeaves > 0)
+		{
+			int leaf = (int)((long)data * numOfLeaves / numOfData);
+
+			trace->Add(0, false, PAGE_CLASS_INDEX);
+			trace->Add(1 + leaf * numOfInner / numOfLeaves, false, PAGE_CLASS_INDEX);
+			trace->Add(firstLeaf + leaf, false, PAGE_CLASS_LEAF);
+		}
+
+		trace->Add(firstData + data, false, PAGE_CLASS_DATA);
+
+		trace->Add(firstData + scanned, false, PAGE_CLASS_DATA);
+		scanned = (scanned + 1) % numOfData;
+	}
+
+	// The last lookup may not fit
+	trace->count = count;
+
+	return trace;
+}
+
+
+//--------------------------------------------------------------------
+// Trace::TPCC
+//
+// Input    : numOfPages - pages of all the tables together
+//            count      - number of accesses
+//            seed       - of the random number generator
+// Output   : None
+// Purpose  : One warehouse. Its row and those of its ten districts
+//            take a page each, the customers a fifth of the pages,
+//            the items a tenth and the stock three tenths. History
+//            and order lines are appended to the remaining pages,
+//            starting over at the beginning of their table when full
+//            (as if old orders were archived). Delivery works its way
+//            through the order lines behind the newest orders.
+// Return   : The new trace, to be deleted by the caller.
+//--------------------------------------------------------------------
+
+Trace* Trace::TPCC(int numOfPages, int count, unsigned int seed)
+{
+	const int numOfCustomers = 30000;
+	const int numOfItems = 100000;
+	const int orderLinesPerPage = 20;
+
+	Trace* trace = new Trace("tpcc");
+
+	int warehouse = 0;
+	int district = 1;
+	int firstCustomer = 2;
+	int customerPages = numOfPages / 5;
+	int firstItem = firstCustomer + customerPages;
+	int itemPages = numOfPages / 10;
+	int firstStock = firstItem + itemPages;
+	int stockPages = 3 * numOfPages / 10;
+	int firstHistory = firstStock + stockPages;
+	int historyPages = (numOfPages - firstHistory) / 8;
+	int firstOrderLine = firstHistory + historyPages;
+	int orderLinePages = numOfPages - firstOrderLine;
+
+	if (customerPages < 1 || itemPages < 1 || stockPages < 1 || historyPages < 1 || orderLinePages < 2)
+	{
+		cerr << "A TPC-C trace needs at least 40 pages" << endl;
+		delete trace;
+		return NULL;
+	}
+
+	long orderLines = 0;     // appended so far
+	long delivered = 0;      // order lines delivered so far
+	long historyRows = 0;
+
+	while (trace->GetCount() < count)
+	{
+		int kind = Uniform(seed, 1, 100);
+		int customer = NURand(seed, 1023, 259, 0, numOfCustomers - 1);
+		int customerPage = firstCustomer + (int)((long)customer * customerPages / numOfCustomers);
+
+		if (kind <= 45)
+		{
+			// New order: read the warehouse and customer, take the
+			// next order id from the district, then order 5 to 15 items
+			int numOfLines = Uniform(seed, 5, 15);
+
+			trace->Add(warehouse, false, PAGE_CLASS_DATA);
+			trace->Add(district, true, PAGE_CLASS_DATA);
+			trace->Add(customerPage, false, PAGE_CLASS_DATA);
+
+			for (int i = 0; i < numOfLines; i++)
+			{
+				int item = NURand(seed, 8191, 7911, 0, numOfItems - 1);
+
+				trace->Add(firstItem + (int)((long)item * itemPages / numOfItems), false, PAGE_CLASS_DATA);
+				trace->Add(firstStock + (int)((long)item * stockPages / numOfItems), true, PAGE_CLASS_DATA);
+				trace->Add(firstOrderLine + (int)(orderLines / orderLinesPerPage % orderLinePages), true, PAGE_CLASS_DATA);
+				orderLines++;
+			}
+		}
+		else if (kind <= 88)
+		{
+			// Payment: update the year to date of the warehouse,
+			// district and customer, and append a history row
+			trace->Add(warehouse, true, PAGE_CLASS_DATA);
+			trace->Add(district, true, PAGE_CLASS_DATA);
+			trace->Add(customerPage, true, PAGE_CLASS_DATA);
+			trace->Add(firstHistory + (int)(historyRows / orderLinesPerPage % historyPages), true, PAGE_CLASS_DATA);
+			historyRows++;
+		}
+		else if (kind <= 92)
+		{
+			// Order status: the customer and the lines of one of the
+			// recent orders
+			long line = orderLines - Uniform(seed, 1, 10 * orderLinesPerPage);
+
+			trace->Add(customerPage, false, PAGE_CLASS_DATA);
+			if (line >= 0)
+			{
+				trace->Add(firstOrderLine + (int)(line / orderLinesPerPage % orderLinePages), false, PAGE_CLASS_DATA);
+			}
+		}
+		else if (kind <= 96)
+		{
+			// Delivery: the oldest undelivered order of each district,
+			// and its customer's balance
+			for (int d = 0; d < 10 && delivered < orderLines; d++)
+			{
+				int lines = Uniform(seed, 5, 15);
+
+				trace->Add(firstOrderLine + (int)(delivered / orderLinesPerPage % orderLinePages), true, PAGE_CLASS_DATA);
+				trace->Add(firstCustomer + Uniform(seed, 0, customerPages - 1), true, PAGE_CLASS_DATA);
+				delivered = (delivered + lines < orderLines) ? delivered + lines : orderLines;
+			}
+		}
+		else
+		{
+			// Stock level: the lines of the last 20 orders and the
+			// stock of their items
+			trace->Add(district, false, PAGE_CLASS_DATA);
+
+			for (long line = orderLines - 200; line < orderLines; line += orderLinesPerPage)
+			{
+				if (line >= 0)
+				{
+					trace->Add(firstOrderLine + (int)(line / orderLinesPerPage % orderLinePages), false, PAGE_CLASS_DATA);
+				}
+			}
+
+			for (int i = 0; i < 200; i++)
+			{
+				int item = NURand(seed, 8191, 7911, 0, numOfItems - 1);
+
+				trace->Add(firstStock + (int)((long)item * stockPages / numOfItems), false, PAGE_CLASS_DATA);
+			}
+		}
+	}
+
+	// The last transaction may not fit
+	trace->count = count;
+
+	return trace;
+}
+
+
+TraceRecorder::TraceRecorder(const char* fileName, Status& status)
+{
+	struct timespec now;
+	TraceFileHeader header;
+
+	this->failed = false;
+	this->numOfRecords = 0;
+	this->records = new TraceRecord[TRACE_RECORD_BUFFER];
+	this->used = 0;
+	pthread_mutex_init(&this->latch, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	this->start = now.tv_sec * 1000000000L + now.tv_nsec;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TRACE_MAGIC;
+	header.pageSize = MINIBASE_PAGESIZE;
+	header.recordSize = sizeof(TraceRecord);
+
+	this->fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	status = (this->fd >= 0 && sizeof(header) == write(this->fd, &header, sizeof(header))) ? OK : FAIL;
+
+	if (OK != status)
+	{
+		cerr << "Cannot write trace " << fileName << endl;
+		this->failed = true;
+	}
+}
+
+
+TraceRecorder::~TraceRecorder()
+{
+	this->Flush();
+
+	if (this->fd >= 0)
+	{
+		close(this->fd);
+	}
+
+	delete[] this->records;
+	pthread_mutex_destroy(&this->latch);
+}
+
+
+//--------------------------------------------------------------------
+// TraceRecorder::Record
+//
+// Input    : type      - TRACE_PIN or TRACE_UNPIN
+//            pid       - the page pinned or unpinned
+//            pageClass - of a pin, see PageClass
+//            dirty     - of an unpin
+// Output   : None
+// Purpose  : Add a record of the call, stamped with the time, and write
+//            the records gathered so far once the buffer is full.
+//--------------------------------------------------------------------
+
+void TraceRecorder::Record(int type, PageID pid, int pageClass, bool dirty)
+{
+	struct timespec now;
+
+	pthread_mutex_lock(&this->latch);
+
+	// Timestamps are taken under the latch, so that they increase
+	// through the file
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	TraceRecord* record = &this->records[this->used++];
+	record->timestamp = now.tv_sec * 1000000000L + now.tv_nsec - this->start;
+	record->pid = pid;
+	record->pageClass = pageClass;
+	record->type = type;
+	record->dirty = dirty ? 1 : 0;
+
+	if (TRACE_RECORD_BUFFER == this->used)
+	{
+		this->WriteRecords();
+	}
+
+	pthread_mutex_unlock(&this->latch);
+}
+
+
+Status TraceRecorder::Flush()
+{
+	pthread_mutex_lock(&this->latch);
+	this->WriteRecords();
+	Status status = this->failed ? FAIL : OK;
+	pthread_mutex_unlock(&this->latch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceRecorder::WriteRecords
+//
+// Append the records gathered to the file; called with the latch
+// held. After a failed write, records are counted but dropped.
+//--------------------------------------------------------------------
+
+void TraceRecorder::WriteRecords()
+{
+	long size = (long)this->used * sizeof(TraceRecord);
+
+	if (!this->failed && size > 0 && size != write(this->fd, this->records, size))
+	{
+		cerr << "Cannot write trace records" << endl;
+		this->failed = true;
+	}
+
+	this->numOfRecords += this->used;
+	this->used = 0;
+}
@@ -0,0 +1,630 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/tracebench.h"
+#include "../include/bufmgr.h"
+
+static const char* allPolicies[] = { "LRU", "Clock", "LRU-K", "2Q", "ARC" };
+static const int defaultPoolSizes[] = { 5, 10, 25, 50 };
+
+//--------------------------------------------------------------------
+// Wall clock time in nanoseconds
+//--------------------------------------------------------------------
+
+static long NowInNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+
+// Order latencies, for qsort
+static int CompareLatencies(const void* a, const void* b)
+{
+	long x = *(const long*)a;
+	long y = *(const long*)b;
+
+	return (x > y) - (x < y);
+}
+
+
+TraceBenchmark::TraceBenchmark()
+{
+	this->numOfPolicies = sizeof(allPolicies) / sizeof(allPolicies[0]);
+	for (int i = 0; i < this->numOfPolicies; i++)
+	{
+		strcpy(this->policies[i], allPolicies[i]);
+	}
+
+	this->numOfPoolSizes = sizeof(defaultPoolSizes) / sizeof(defaultPoolSizes[0]);
+	for (int i = 0; i < this->numOfPoolSizes; i++)
+	{
+		this->poolSizes[i] = defaultPoolSizes[i];
+		this->relative[i] = true;
+	}
+
+	this->csv = NULL;
+}
+
+
+TraceBenchmark::~TraceBenchmark()
+{
+	if (NULL != this->csv)
+	{
+		fclose(this->csv);
+	}
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::SetPolicies
+//
+// Input    : list - policy names separated by commas
+// Output   : None
+// Return   : OK, FAIL if the list is empty, too long or names a
+//            policy that does not exist.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::SetPolicies(const char* list)
+{
+	Status status = OK;
+	int numOfPolicies = 0;
+	const char* name = list;
+
+	while (OK == status && '\0' != *name)
+	{
+		int length = strcspn(name, ",");
+		const char* known = NULL;
+
+		for (int i = 0; i < (int)(sizeof(allPolicies) / sizeof(allPolicies[0])); i++)
+		{
+			if ((int)strlen(allPolicies[i]) == length && 0 == strncasecmp(name, allPolicies[i], length))
+			{
+				known = allPolicies[i];
+			}
+		}
+
+		if (NULL == known || numOfPolicies == TRACE_MAX_POLICIES)
+		{
+			cerr << "Unknown or too many replacement policies: " << list << endl;
+			status = FAIL;
+		}
+		else
+		{
+			strcpy(this->policies[numOfPolicies], known);
+			numOfPolicies++;
+
+			name += (',' == name[length]) ? length + 1 : length;
+		}
+	}
+
+	if (OK == status && 0 == numOfPolicies)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		this->numOfPolicies = numOfPolicies;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::SetPoolSizes
+//
+// Input    : list - frame counts, or percents followed by '%',
+//                   separated by commas
+// Output   : None
+// Return   : OK, FAIL if the list is empty, too long or holds anything
+//            but positive numbers.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::SetPoolSizes(const char* list)
+{
+	Status status = OK;
+	int numOfPoolSizes = 0;
+	const char* size = list;
+
+	while (OK == status && '\0' != *size)
+	{
+		char* end;
+		long value = strtol(size, &end, 10);
+		bool percent = ('%' == *end);
+
+		if (percent)
+		{
+			end++;
+		}
+
+		if (end == size || value <= 0 || (percent && value > 100) || (',' != *end && '\0' != *end)
+			|| numOfPoolSizes == TRACE_MAX_POOL_SIZES)
+		{
+			cerr << "Bad or too many pool sizes: " << list << endl;
+			status = FAIL;
+		}
+		else
+		{
+			this->poolSizes[numOfPoolSizes] = (int)value;
+			this->relative[numOfPoolSizes] = percent;
+			numOfPoolSizes++;
+
+			size = (',' == *end) ? end + 1 : end;
+		}
+	}
+
+	if (OK == status && 0 == numOfPoolSizes)
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		this->numOfPoolSizes = numOfPoolSizes;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::OpenCSV
+//
+// Input    : fileName - where to append the results
+// Output   : None
+// Return   : OK, FAIL if the file cannot be opened.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::OpenCSV(const char* fileName)
+{
+	Status status = OK;
+
+	if (NULL != this->csv)
+	{
+		fclose(this->csv);
+	}
+
+	this->csv = fopen(fileName, "a");
+
+	if (NULL == this->csv)
+	{
+		cerr << "Cannot open " << fileName << endl;
+		status = FAIL;
+	}
+
+	if (OK == status && 0 == ftell(this->csv))
+	{
+		fprintf(this->csv, "trace,mode,pages,page_size,policy,frames,accesses,seconds,accesses_per_second,"
+			"pin_p50_ns,pin_p99_ns,hit_ratio,misses,dirty_writes\n");
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::Run
+//
+// Input    : trace - the accesses to replay
+// Output   : None
+// Purpose  : Replay the trace with each policy and pool size, and
+//            report the results.
+// Return   : OK, FAIL if the pages cannot be allocated or a pin fails.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::Run(Trace* trace)
+{
+	Status status = OK;
+	PageID firstPid = INVALID_PAGE;
+	int numOfPages = trace->GetNumOfPages();
+
+	if (0 == trace->GetCount())
+	{
+		cerr << "Trace " << trace->GetName() << " is empty" << endl;
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		status = MINIBASE_DB->AllocatePage(firstPid, numOfPages);
+	}
+
+	if (OK == status)
+	{
+		cout << "\n  Trace " << trace->GetName() << ": " << trace->GetCount() << " accesses to "
+			 << numOfPages << " pages\n";
+		cout << "    policy   frames   Maccesses/s   pin p50 ns   pin p99 ns   hit ratio   dirty writes\n";
+	}
+	else
+	{
+		cerr << "*** Cannot allocate " << numOfPages << " pages for trace " << trace->GetName() << endl;
+	}
+
+	for (int s = 0; OK == status && s < this->numOfPoolSizes; s++)
+	{
+		int poolSize = this->GetPoolSize(trace, s);
+
+		for (int p = 0; OK == status && p < this->numOfPolicies; p++)
+		{
+			TraceResult result;
+			status = this->Replay(trace, firstPid, this->policies[p], poolSize, result);
+
+			if (OK == status)
+			{
+				double hitRatio = 1.0 - (double)result.misses / result.accesses;
+				double throughput = result.accesses / result.elapsed * 1e9;
+
+				printf("    %-7s  %6d   %11.2f   %10ld   %10ld   %8.1f%%   %12ld\n", this->policies[p], poolSize,
+					throughput / 1e6, result.pinLatencyP50, result.pinLatencyP99, 100 * hitRatio, result.dirtyWrites);
+
+				if (NULL != this->csv)
+				{
+					fprintf(this->csv, "%s,replay,%d,%d,%s,%d,%ld,%.6f,%.0f,%ld,%ld,%.6f,%ld,%ld\n", trace->GetName(),
+						numOfPages, MINIBASE_PAGESIZE, this->policies[p], poolSize, result.accesses,
+						result.elapsed / 1e9, throughput, result.pinLatencyP50, result.pinLatencyP99, hitRatio,
+						result.misses, result.dirtyWrites);
+					fflush(this->csv);
+				}
+			}
+			else
+			{
+				cerr << "*** Replaying " << trace->GetName() << " failed with " << this->policies[p]
+					 << " and " << poolSize << " frames\n";
+			}
+		}
+	}
+
+	if (INVALID_PAGE != firstPid)
+	{
+		MINIBASE_DB->DeallocatePage(firstPid, numOfPages);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::GetPoolSize
+//
+// Input    : trace - the trace replayed
+//            index - of the pool size
+// Output   : None
+// Return   : The number of frames of the pool size for the trace.
+//--------------------------------------------------------------------
+
+int TraceBenchmark::GetPoolSize(Trace* trace, int index)
+{
+	int poolSize = this->poolSizes[index];
+
+	if (this->relative[index])
+	{
+		poolSize = (int)((long)trace->GetNumOfPages() * poolSize / 100);
+	}
+
+	return (poolSize > TRACE_MIN_POOL_SIZE) ? poolSize : TRACE_MIN_POOL_SIZE;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::Replay
+//
+// Input    : trace    - the accesses to replay
+//            firstPid - the page trace page 0 is mapped to
+//            policy   - replacement policy of the pool
+//            poolSize - frames of the pool
+// Output   : result - what was measured
+// Purpose  : Pin and unpin the pages of the trace in turn, in a new
+//            buffer manager, timing each pin.
+// Return   : OK, or the status of the pin or unpin that failed.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::Replay(Trace* trace, PageID firstPid, const char* policy, int poolSize, TraceResult& result)
+{
+	Status status = OK;
+	TraceEntry* entries = trace->GetEntries();
+	int count = trace->GetCount();
+	long* latencies = new long[count];
+	long pinNo, missNo, foreground, background;
+	Page* pg;
+
+	BufMgr* bufMgr = new BufMgr(poolSize, policy);
+
+	long start = NowInNanoseconds();
+
+	for (int i = 0; OK == status && i < count; i++)
+	{
+		PageID pid = firstPid + entries[i].page;
+		long pinStart = NowInNanoseconds();
+
+		status = bufMgr->PinPage(pid, pg, false, entries[i].pageClass);
+		latencies[i] = NowInNanoseconds() - pinStart;
+
+		if (OK == status)
+		{
+			status = bufMgr->UnpinPage(pid, entries[i].write);
+		}
+	}
+
+	result.elapsed = NowInNanoseconds() - start;
+
+	// The writes made by FlushAllPages when the pool is deleted are
+	// not counted
+	bufMgr->GetStat(pinNo, missNo);
+	bufMgr->GetWriteStat(foreground, background);
+	delete bufMgr;
+
+	if (OK == status)
+	{
+		qsort(latencies, count, sizeof(long), CompareLatencies);
+
+		result.accesses = count;
+		result.pinLatencyP50 = latencies[(count - 1) / 2];
+		result.pinLatencyP99 = latencies[(int)((count - 1) * 0.99)];
+		result.misses = missNo;
+		result.dirtyWrites = foreground + background;
+	}
+
+	delete[] latencies;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::Simulate
+//
+// Input    : trace - the accesses to simulate
+// Output   : None
+// Purpose  : Print the miss ratio of OPT and of each policy for each
+//            pool size, and append them to the CSV file if open.
+// Return   : OK, FAIL if a pin fails.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::Simulate(Trace* trace)
+{
+	Status status = OK;
+	int count = trace->GetCount();
+	int numOfPages = trace->GetNumOfPages();
+
+	int* nextUses = new int[count];
+	TraceBenchmark::GetNextUses(trace, nextUses);
+
+	cout << "\n  Miss ratio curve of " << trace->GetName() << ": " << count << " accesses to "
+		 << numOfPages << " pages\n";
+	cout << "    frames        OPT";
+	for (int p = 0; p < this->numOfPolicies; p++)
+	{
+		printf("  %9s", this->policies[p]);
+	}
+	cout << "\n";
+
+	for (int s = 0; OK == status && s < this->numOfPoolSizes; s++)
+	{
+		int poolSize = this->GetPoolSize(trace, s);
+		long misses = TraceBenchmark::SimulateOPT(trace, nextUses, poolSize);
+
+		printf("    %-6d  %8.1f%%", poolSize, 100.0 * misses / count);
+
+		for (int p = -1; OK == status && p < this->numOfPolicies; p++)
+		{
+			const char* policy = (p < 0) ? "OPT" : this->policies[p];
+
+			if (p >= 0)
+			{
+				status = this->SimulatePolicy(trace, policy, poolSize, misses);
+
+				if (OK == status)
+				{
+					printf("  %8.1f%%", 100.0 * misses / count);
+				}
+			}
+
+			if (OK == status && NULL != this->csv)
+			{
+				fprintf(this->csv, "%s,simulate,%d,%d,%s,%d,%d,,,,,%.6f,%ld,\n", trace->GetName(), numOfPages,
+					MINIBASE_PAGESIZE, policy, poolSize, count, 1.0 - (double)misses / count, misses);
+			}
+		}
+
+		cout << "\n";
+	}
+
+	if (NULL != this->csv)
+	{
+		fflush(this->csv);
+	}
+
+	if (OK != status)
+	{
+		cerr << "*** Simulating " << trace->GetName() << " failed\n";
+	}
+
+	delete[] nextUses;
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::GetNextUses
+//
+// Input    : trace    - the accesses
+// Output   : nextUses - for each access, when its page is accessed
+//                       next; the count of accesses if never
+// Purpose  : Scan the trace backwards, remembering the last access
+//            seen of each page.
+//--------------------------------------------------------------------
+
+void TraceBenchmark::GetNextUses(Trace* trace, int* nextUses)
+{
+	TraceEntry* entries = trace->GetEntries();
+	int count = trace->GetCount();
+	int numOfPages = trace->GetNumOfPages();
+	int* lastUses = new int[numOfPages];
+
+	for (int page = 0; page < numOfPages; page++)
+	{
+		lastUses[page] = count;
+	}
+
+	for (int i = count - 1; i >= 0; i--)
+	{
+		nextUses[i] = lastUses[entries[i].page];
+		lastUses[entries[i].page] = i;
+	}
+
+	delete[] lastUses;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::SimulateOPT
+//
+// Input    : trace    - the accesses to simulate
+//            nextUses - for each access, when its page is used next
+//            poolSize - frames of the pool
+// Output   : None
+// Purpose  : Run Belady's OPT over the trace. The resident pages are
+//            kept in a max-heap by next use; an access pushes a new
+//            entry for its page, leaving the old one stale, to be
+//            skipped when it comes to the top.
+// Return   : The number of misses.
+//--------------------------------------------------------------------
+
+long TraceBenchmark::SimulateOPT(Trace* trace, int* nextUses, int poolSize)
+{
+	TraceEntry* entries = trace->GetEntries();
+	int count = trace->GetCount();
+	int numOfPages = trace->GetNumOfPages();
+
+	int* heapUses = new int[count];
+	int* heapPages = new int[count];
+	int heapSize = 0;
+
+	// The next use of each resident page, -1 if not resident
+	int* nextUseOf = new int[numOfPages];
+	int numOfResident = 0;
+	long misses = 0;
+
+	for (int page = 0; page < numOfPages; page++)
+	{
+		nextUseOf[page] = -1;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		int page = entries[i].page;
+
+		if (nextUseOf[page] < 0)
+		{
+			misses++;
+
+			// Evict the resident page used furthest in the future
+			while (numOfResident == poolSize)
+			{
+				int victim = heapPages[0];
+				bool current = (heapUses[0] == nextUseOf[victim]);
+
+				// Move the last entry down from the top
+				int lastUse = heapUses[--heapSize];
+				int lastPage = heapPages[heapSize];
+				int hole = 0;
+
+				while (2 * hole + 1 < heapSize)
+				{
+					int child = 2 * hole + 1;
+
+					if (child + 1 < heapSize && heapUses[child + 1] > heapUses[child])
+					{
+						child++;
+					}
+
+					if (heapUses[child] <= lastUse)
+					{
+						break;
+					}
+
+					heapUses[hole] = heapUses[child];
+					heapPages[hole] = heapPages[child];
+					hole = child;
+				}
+
+				heapUses[hole] = lastUse;
+				heapPages[hole] = lastPage;
+
+				if (current)
+				{
+					nextUseOf[victim] = -1;
+					numOfResident--;
+				}
+			}
+
+			numOfResident++;
+		}
+
+		// Push the page with its next use
+		int hole = heapSize++;
+		while (hole > 0 && heapUses[(hole - 1) / 2] < nextUses[i])
+		{
+			heapUses[hole] = heapUses[(hole - 1) / 2];
+			heapPages[hole] = heapPages[(hole - 1) / 2];
+			hole = (hole - 1) / 2;
+		}
+
+		heapUses[hole] = nextUses[i];
+		heapPages[hole] = page;
+		nextUseOf[page] = nextUses[i];
+	}
+
+	delete[] heapUses;
+	delete[] heapPages;
+	delete[] nextUseOf;
+
+	return misses;
+}
+
+
+//--------------------------------------------------------------------
+// TraceBenchmark::SimulatePolicy
+//
+// Input    : trace    - the accesses to simulate
+//            policy   - replacement policy of the pool
+//            poolSize - frames of the pool
+// Output   : misses - the misses of the pool over the trace
+// Purpose  : Pin and unpin the pages of the trace in turn, as empty
+//            pages, in a new buffer manager without read-ahead.
+// Return   : OK, or the status of the pin or unpin that failed.
+//--------------------------------------------------------------------
+
+Status TraceBenchmark::SimulatePolicy(Trace* trace, const char* policy, int poolSize, long& misses)
+{
+	Status status = OK;
+	TraceEntry* entries = trace->GetEntries();
+	int count = trace->GetCount();
+	long pinNo;
+	Page* pg;
+
+	BufMgr* bufMgr = new BufMgr(poolSize, policy);
+	bufMgr->SetReadAhead(0);
+
+	for (int i = 0; OK == status && i < count; i++)
+	{
+		status = bufMgr->PinPage(entries[i].page, pg, true, entries[i].pageClass);
+
+		if (OK == status)
+		{
+			status = bufMgr->UnpinPage(entries[i].page);
+		}
+	}
+
+	bufMgr->GetStat(pinNo, misses);
+	delete bufMgr;
+
+	return status;
+}
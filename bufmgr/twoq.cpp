@@ -0,0 +1,127 @@
+#include "../include/twoq.h"
+
+TwoQ::TwoQ(int numOfBuf, Frame** frames) : Replacer(numOfBuf, frames)
+{
+	// Kin = 25% and Kout = 50% of the buffer pool, as recommended in the paper
+	this->maxA1inSize = (numOfBuf / 4 > 0) ? numOfBuf / 4 : 1;
+	this->queues = new IndexLists(numOfBuf, 3);
+	this->a1out = new GhostList(numOfBuf / 2);
+
+	for (int i = 0; i < numOfBuf; i++)
+	{
+		this->queues->PushBack(FREE, i);
+	}
+}
+
+
+TwoQ::~TwoQ()
+{
+	delete this->queues;
+	delete this->a1out;
+}
+
+
+int TwoQ::PickVictim()
+{
+	int victimFrameIndex = this->FirstUnpinned(FREE);
+
+	if (INVALID_FRAME == victimFrameIndex)
+	{
+		// Reclaim from A1in while it is over its share, from Am otherwise
+		int first = (this->queues->Size(A1IN) > this->maxA1inSize) ? A1IN : AM;
+		int second = (A1IN == first) ? AM : A1IN;
+
+		victimFrameIndex = this->FirstUnpinned(first);
+
+		if (INVALID_FRAME == victimFrameIndex)
+		{
+			victimFrameIndex = this->FirstUnpinned(second);
+		}
+	}
+
+	return victimFrameIndex;
+}
+
+
+int TwoQ::NextVictims(int* frameIds, int max)
+{
+	int first = (this->queues->Size(A1IN) > this->maxA1inSize) ? A1IN : AM;
+	int second = (A1IN == first) ? AM : A1IN;
+
+	int count = this->AddUnpinned(FREE, frameIds, 0, max);
+	count = this->AddUnpinned(first, frameIds, count, max);
+
+	return this->AddUnpinned(second, frameIds, count, max);
+}
+
+
+void TwoQ::OnLoad(int frameId)
+{
+	PageID pid = (*this->frames)[frameId].GetPageID();
+
+	if (INVALID_INDEX != this->a1out->Find(pid))
+	{
+		// Second reference within the A1out window: the page is hot
+		this->a1out->Remove(pid);
+		this->queues->MoveToBack(AM, frameId);
+	}
+	else
+	{
+		this->queues->MoveToBack(A1IN, frameId);
+	}
+}
+
+
+void TwoQ::OnPin(int frameId)
+{
+	// A1in is a FIFO; hits there are deliberately ignored
+	if (AM == this->queues->ListOf(frameId))
+	{
+		this->queues->MoveToBack(AM, frameId);
+	}
+}
+
+
+void TwoQ::OnEvict(int frameId)
+{
+	if (A1IN == this->queues->ListOf(frameId))
+	{
+		this->a1out->Insert((*this->frames)[frameId].GetPageID());
+	}
+}
+
+
+void TwoQ::OnFree(int frameId)
+{
+	this->queues->MoveToBack(FREE, frameId);
+}
+
+
+int TwoQ::FirstUnpinned(int queue)
+{
+	for (int i = this->queues->Front(queue); INVALID_INDEX != i; i = this->queues->Next(i))
+	{
+		this->numOfExamined++;
+
+		if ((*this->frames)[i].NotPinned() && this->Accept(i))
+		{
+			return i;
+		}
+	}
+
+	return INVALID_FRAME;
+}
+
+
+int TwoQ::AddUnpinned(int queue, int* frameIds, int count, int max)
+{
+	for (int i = this->queues->Front(queue); INVALID_INDEX != i && count < max; i = this->queues->Next(i))
+	{
+		if ((*this->frames)[i].NotPinned())
+		{
+			frameIds[count++] = i;
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,766 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/wal.h"
+
+struct LogHeader
+{
+	int  magic;
+	int  pageSize;
+	long capacity;
+	LSN  startLSN;
+};
+
+
+//--------------------------------------------------------------------
+// LogRecord::GetSize
+//
+// Input    : None
+// Output   : None
+// Return   : The size of the record in the log, header included.
+//--------------------------------------------------------------------
+
+int LogRecord::GetSize()
+{
+	int size = sizeof(LogRecord);
+
+	if (LOG_UPDATE == this->type)
+	{
+		size += 2 * this->length;
+	}
+	else if (LOG_COMPENSATE == this->type)
+	{
+		size += this->length;
+	}
+
+	return size;
+}
+
+
+//--------------------------------------------------------------------
+// Constructor for LogManager
+//
+// Input   : fileName   - the log file, created if it does not exist
+//           maxLogSize - the most bytes of records the log may hold,
+//                        if it is created
+// Output  : status - OK if the log could be opened
+// PostCond: The records already in the log are kept, up to the first
+//           one that was not completely written.
+//--------------------------------------------------------------------
+
+LogManager::LogManager(const char* fileName, long maxLogSize, Status& status)
+{
+	this->capacity = maxLogSize;
+	this->failed = false;
+	this->startLSN = 1;
+	this->nextLSN = 1;
+	this->flushedLSN = 1;
+	this->buffers[0] = new char[LOG_BUFFER_SIZE];
+	this->buffers[1] = new char[LOG_BUFFER_SIZE];
+	this->current = 0;
+	this->used = 0;
+	this->bufferStart = 1;
+	this->flushing = false;
+	this->reserved = 0;
+	this->numOfTxns = 0;
+	this->nextTxnId = 1;
+	this->numOfCommits = 0;
+	this->numOfSyncs = 0;
+
+	pthread_mutex_init(&this->latch, NULL);
+	pthread_cond_init(&this->flushed, NULL);
+
+	this->fd = open(fileName, O_RDWR | O_CREAT, 0644);
+
+	status = (this->fd < 0) ? FAIL : this->Open(maxLogSize);
+}
+
+
+//--------------------------------------------------------------------
+// Destructor for LogManager
+//
+// Input   : None
+// Output  : None
+// PostCond: The records appended are written out.
+//--------------------------------------------------------------------
+
+LogManager::~LogManager()
+{
+	if (this->fd >= 0)
+	{
+		this->Flush(this->GetEndLSN());
+		close(this->fd);
+	}
+
+	pthread_mutex_destroy(&this->latch);
+	pthread_cond_destroy(&this->flushed);
+	delete[] this->buffers[0];
+	delete[] this->buffers[1];
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Open
+//
+// Input    : maxLogSize - the room for records of a new log
+// Output   : None
+// Purpose  : Start a new log in an empty (or unrecognized) file, or
+//            find the end of the records in an existing one. An
+//            existing log keeps the size it was created with.
+// Return   : OK if successful. FAIL if the log is from a build with a
+//            different page size, or on an I/O error.
+//--------------------------------------------------------------------
+
+Status LogManager::Open(long maxLogSize)
+{
+	Status status = OK;
+	LogHeader header;
+	char* zeros = this->buffers[1];
+
+	memset(zeros, 0, LOG_BUFFER_SIZE);
+
+	if (pread(this->fd, &header, sizeof(header), 0) != sizeof(header) || LOG_MAGIC != header.magic)
+	{
+		this->capacity = maxLogSize;
+
+		if (0 != ftruncate(this->fd, LOG_HEADER_SIZE))
+		{
+			status = FAIL;
+		}
+
+		for (long done = 0; OK == status && done < this->capacity; done += LOG_BUFFER_SIZE)
+		{
+			int size = (this->capacity - done < LOG_BUFFER_SIZE) ? this->capacity - done : LOG_BUFFER_SIZE;
+			status = this->Transfer(this->startLSN + done, zeros, size, true);
+		}
+
+		if (OK == status)
+		{
+			status = this->WriteHeader();
+		}
+	}
+	else if (MINIBASE_PAGESIZE != header.pageSize || header.capacity <= 0)
+	{
+		status = FAIL;
+	}
+	else
+	{
+		this->capacity = header.capacity;
+		this->startLSN = header.startLSN;
+
+		LSN lsn = this->startLSN;
+		LogRecord record;
+		char* data = NULL;
+
+		while (lsn - this->startLSN < this->capacity && OK == this->ReadRecord(lsn, record, data))
+		{
+			if (record.txnId >= this->nextTxnId)
+			{
+				this->nextTxnId = record.txnId + 1;
+			}
+
+			lsn += record.GetSize();
+			delete[] data;
+		}
+
+		this->nextLSN = lsn;
+		this->flushedLSN = lsn;
+		this->bufferStart = lsn;
+
+		// The last write before a crash may have left records after
+		// the first one it did not complete, which would pass for
+		// records once new ones have been written up to them
+		long room = this->capacity - (lsn - this->startLSN);
+		status = this->Transfer(lsn, zeros, (room < LOG_BUFFER_SIZE) ? room : LOG_BUFFER_SIZE, true);
+
+		if (OK == status && 0 != fdatasync(this->fd))
+		{
+			status = FAIL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::WriteHeader
+//
+// Input    : None
+// Output   : None
+// Purpose  : Write and sync the header, for a log starting at
+//            startLSN. Records left before it no longer count, and are
+//            written over as the log wraps around.
+// Return   : OK if successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status LogManager::WriteHeader()
+{
+	Status status = OK;
+	char block[LOG_HEADER_SIZE];
+	LogHeader header;
+
+	header.magic = LOG_MAGIC;
+	header.pageSize = MINIBASE_PAGESIZE;
+	header.capacity = this->capacity;
+	header.startLSN = this->startLSN;
+
+	memset(block, 0, sizeof(block));
+	memcpy(block, &header, sizeof(header));
+
+	if (pwrite(this->fd, block, sizeof(block), 0) != sizeof(block) || 0 != fdatasync(this->fd))
+	{
+		status = FAIL;
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Transfer
+//
+// Input    : lsn   - where the bytes go (or come from) in the log
+//            data  - the bytes
+//            size  - their number, at most the capacity
+//            write - true to write, false to read
+// Output   : None
+// Purpose  : Write (or read) the bytes at their place in the file,
+//            wrapping around its end.
+// Return   : OK if successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status LogManager::Transfer(LSN lsn, char* data, int size, bool write)
+{
+	Status status = OK;
+	int done = 0;
+
+	while (OK == status && done < size)
+	{
+		long position = (lsn + done) % this->capacity;
+		long count = (this->capacity - position < size - done) ? this->capacity - position : size - done;
+
+		ssize_t result = write ? pwrite(this->fd, data + done, count, LOG_HEADER_SIZE + position)
+			: pread(this->fd, data + done, count, LOG_HEADER_SIZE + position);
+
+		if (result > 0)
+		{
+			done += result;
+		}
+		else if (0 == result || EINTR != errno)
+		{
+			status = FAIL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Checksum
+//
+// Input    : record - a record header; its checksum is not included
+//            data   - the images following it
+//            size   - the number of bytes of images
+// Output   : None
+// Return   : The FNV-1a hash of the record.
+//--------------------------------------------------------------------
+
+unsigned int LogManager::Checksum(LogRecord* record, const char* data, int size)
+{
+	LogRecord header = *record;
+	header.checksum = 0;
+
+	unsigned int hash = 2166136261u;
+	const unsigned char* bytes = (const unsigned char*)&header;
+
+	for (unsigned int i = 0; i < sizeof(header); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	bytes = (const unsigned char*)data;
+	for (int i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::FindTransaction
+//
+// Input    : txnId - a transaction id
+// Output   : None
+// Purpose  : Look the transaction up among the active ones; under
+//            latch.
+// Return   : Its index in txnIds, or -1 if it is not active.
+//--------------------------------------------------------------------
+
+int LogManager::FindTransaction(int txnId)
+{
+	int index = -1;
+
+	for (int i = 0; i < this->numOfTxns && index < 0; i++)
+	{
+		if (this->txnIds[i] == txnId)
+		{
+			index = i;
+		}
+	}
+
+	return index;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Begin
+//
+// Input    : None
+// Output   : txnId - the id of the new transaction
+// Purpose  : Start a transaction, keeping room for its end record.
+// Return   : OK if successful. FAIL if too many are active, or the log
+//            is full.
+//--------------------------------------------------------------------
+
+Status LogManager::Begin(int& txnId)
+{
+	Status status = OK;
+	long room = sizeof(LogRecord);
+
+	pthread_mutex_lock(&this->latch);
+	if (LOG_MAX_TRANSACTIONS == this->numOfTxns
+		|| this->nextLSN - this->startLSN + this->reserved + room > this->capacity)
+	{
+		status = FAIL;
+	}
+	else
+	{
+		txnId = this->nextTxnId++;
+		this->txnIds[this->numOfTxns] = txnId;
+		this->firstLSNs[this->numOfTxns] = INVALID_LSN;
+		this->lastLSNs[this->numOfTxns] = INVALID_LSN;
+		this->reservedBytes[this->numOfTxns] = room;
+		this->reserved += room;
+		this->numOfTxns++;
+	}
+	pthread_mutex_unlock(&this->latch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Append
+//
+// Input    : txnId  - an active transaction
+//            type   - LOG_UPDATE, LOG_COMPENSATE, LOG_COMMIT or
+//                     LOG_ABORT
+//            pid    - the page changed
+//            offset - where the change starts in the page
+//            length - the number of bytes changed
+//            before - the bytes before the change, for an update
+//            after  - the bytes after the change
+// Output   : lsn - the LSN of the record
+// Purpose  : Add a record to the log buffer, writing the buffer out if
+//            it is full. An update keeps room for the compensation
+//            record that would undo it; compensation and end records
+//            take the room kept for them.
+// Return   : OK if successful. FAIL if the transaction is not active,
+//            an update does not fit in the log, or the log could not
+//            be written.
+//--------------------------------------------------------------------
+
+Status LogManager::Append(int txnId, int type, PageID pid, int offset, int length, const char* before, const char* after, LSN& lsn)
+{
+	Status status = OK;
+	LogRecord record;
+	bool appended = false;
+
+	record.txnId = txnId;
+	record.type = type;
+	record.pid = pid;
+	record.offset = offset;
+	record.length = length;
+
+	int size = record.GetSize();
+	long room = (LOG_UPDATE == type) ? sizeof(LogRecord) + length : 0;
+
+	pthread_mutex_lock(&this->latch);
+
+	while (OK == status && !appended)
+	{
+		// Found again each time, as the latch is let go while waiting
+		int index = this->FindTransaction(txnId);
+
+		if (this->failed || index < 0)
+		{
+			status = FAIL;
+		}
+		else if (LOG_UPDATE == type && this->nextLSN - this->startLSN + this->reserved + size + room > this->capacity)
+		{
+			status = FAIL;
+		}
+		else if (this->used + size > LOG_BUFFER_SIZE)
+		{
+			if (this->flushing)
+			{
+				pthread_cond_wait(&this->flushed, &this->latch);
+			}
+			else
+			{
+				status = this->WriteBuffer();
+			}
+		}
+		else
+		{
+			record.lsn = this->nextLSN;
+			record.prevLSN = this->lastLSNs[index];
+
+			char* data = this->buffers[this->current] + this->used + sizeof(LogRecord);
+			int imageSize = size - sizeof(LogRecord);
+
+			if (LOG_UPDATE == type)
+			{
+				memcpy(data, before, length);
+				memcpy(data + length, after, length);
+			}
+			else if (LOG_COMPENSATE == type)
+			{
+				memcpy(data, after, length);
+			}
+
+			record.checksum = Checksum(&record, data, imageSize);
+			memcpy(this->buffers[this->current] + this->used, &record, sizeof(LogRecord));
+
+			this->used += size;
+			this->nextLSN += size;
+
+			if (INVALID_LSN == this->firstLSNs[index])
+			{
+				this->firstLSNs[index] = record.lsn;
+			}
+			this->lastLSNs[index] = record.lsn;
+
+			if (LOG_UPDATE != type)
+			{
+				room = -((size < this->reservedBytes[index]) ? size : this->reservedBytes[index]);
+			}
+			this->reservedBytes[index] += room;
+			this->reserved += room;
+
+			lsn = record.lsn;
+			appended = true;
+		}
+	}
+
+	pthread_mutex_unlock(&this->latch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::End
+//
+// Input    : txnId - an active transaction
+//            type  - LOG_COMMIT or LOG_ABORT
+// Output   : lsn - the LSN of the commit or abort record
+// Purpose  : Log the end of a transaction, which is no longer active
+//            afterwards, and give up the room kept for it. The record
+//            is not flushed.
+// Return   : OK if successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status LogManager::End(int txnId, int type, LSN& lsn)
+{
+	Status status = this->Append(txnId, type, INVALID_PAGE, 0, 0, NULL, NULL, lsn);
+
+	if (OK == status)
+	{
+		pthread_mutex_lock(&this->latch);
+		int index = this->FindTransaction(txnId);
+		int last = this->numOfTxns - 1;
+
+		this->reserved -= this->reservedBytes[index];
+		this->txnIds[index] = this->txnIds[last];
+		this->firstLSNs[index] = this->firstLSNs[last];
+		this->lastLSNs[index] = this->lastLSNs[last];
+		this->reservedBytes[index] = this->reservedBytes[last];
+		this->numOfTxns--;
+
+		if (LOG_COMMIT == type)
+		{
+			this->numOfCommits++;
+		}
+		pthread_mutex_unlock(&this->latch);
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::WriteBuffer
+//
+// Input    : None
+// Output   : None
+// Purpose  : Write out and sync the records in the current buffer,
+//            while further records go to the other one. Called under
+//            latch, when no other thread is writing; the latch is let
+//            go during the write.
+// Return   : OK if successful. FAIL otherwise.
+//--------------------------------------------------------------------
+
+Status LogManager::WriteBuffer()
+{
+	Status status = OK;
+	char* data = this->buffers[this->current];
+	int size = this->used;
+	LSN from = this->bufferStart;
+
+	this->flushing = true;
+	this->current = 1 - this->current;
+	this->used = 0;
+	this->bufferStart = this->nextLSN;
+
+	pthread_mutex_unlock(&this->latch);
+
+	status = this->Transfer(from, data, size, true);
+
+	if (OK == status && 0 != fdatasync(this->fd))
+	{
+		status = FAIL;
+	}
+
+	pthread_mutex_lock(&this->latch);
+
+	if (OK == status)
+	{
+		this->flushedLSN = from + size;
+		this->numOfSyncs++;
+	}
+	else
+	{
+		this->failed = true;
+	}
+
+	this->flushing = false;
+	pthread_cond_broadcast(&this->flushed);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Flush
+//
+// Input    : lsn - the LSN of a record
+// Output   : None
+// Purpose  : Make the log durable up to and including the record. If
+//            another thread is writing the log, wait for it, then write
+//            whatever it did not cover, with the records other threads
+//            appended meanwhile.
+// Return   : OK if successful. FAIL if the log could not be written.
+//--------------------------------------------------------------------
+
+Status LogManager::Flush(LSN lsn)
+{
+	Status status = OK;
+
+	pthread_mutex_lock(&this->latch);
+
+	if (lsn >= this->nextLSN)
+	{
+		lsn = this->nextLSN - 1;
+	}
+
+	while (OK == status && this->flushedLSN <= lsn)
+	{
+		if (this->failed)
+		{
+			status = FAIL;
+		}
+		else if (this->flushing)
+		{
+			pthread_cond_wait(&this->flushed, &this->latch);
+		}
+		else
+		{
+			status = this->WriteBuffer();
+		}
+	}
+
+	pthread_mutex_unlock(&this->latch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::Truncate
+//
+// Input    : newStartLSN - the LSN of a record, or the end of the log
+// Output   : None
+// Purpose  : Give up the records before newStartLSN, which no longer
+//            need to be redone or undone, so that their room can be
+//            reused. The log never moves back.
+// Return   : OK if successful. FAIL if newStartLSN is beyond the end
+//            of the log, or the header could not be written.
+//--------------------------------------------------------------------
+
+Status LogManager::Truncate(LSN newStartLSN)
+{
+	Status status = OK;
+
+	pthread_mutex_lock(&this->latch);
+
+	if (this->failed || newStartLSN > this->nextLSN)
+	{
+		status = FAIL;
+	}
+	else if (newStartLSN > this->startLSN)
+	{
+		// Nothing is written over the records given up before the
+		// header saying so is on disk, as the latch is held meanwhile
+		LSN oldStartLSN = this->startLSN;
+		this->startLSN = newStartLSN;
+		status = this->WriteHeader();
+
+		if (OK != status)
+		{
+			this->startLSN = oldStartLSN;
+		}
+	}
+
+	pthread_mutex_unlock(&this->latch);
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::ReadRecord
+//
+// Input    : lsn - the LSN of a flushed record
+// Output   : record - its header
+//            data   - its images, in a new array (NULL on failure)
+// Purpose  : Read a record back from the log file.
+// Return   : OK if successful. FAIL if there is no complete record at
+//            lsn.
+//--------------------------------------------------------------------
+
+Status LogManager::ReadRecord(LSN lsn, LogRecord& record, char*& data)
+{
+	Status status = this->Transfer(lsn, (char*)&record, sizeof(record), false);
+
+	data = NULL;
+
+	if (OK == status && (record.lsn != lsn || record.type < LOG_UPDATE || record.type > LOG_ABORT
+		|| record.offset < 0 || record.length < 0 || record.offset + record.length > MINIBASE_PAGESIZE))
+	{
+		status = FAIL;
+	}
+
+	if (OK == status)
+	{
+		int imageSize = record.GetSize() - sizeof(LogRecord);
+		data = new char[imageSize + 1];
+
+		if (OK != this->Transfer(lsn + sizeof(record), data, imageSize, false)
+			|| Checksum(&record, data, imageSize) != record.checksum)
+		{
+			status = FAIL;
+			delete[] data;
+			data = NULL;
+		}
+	}
+
+	return status;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::GetStartLSN, GetEndLSN
+//
+// Input    : None
+// Output   : None
+// Return   : The LSN of the first record in the log, and the LSN the
+//            next record will get.
+//--------------------------------------------------------------------
+
+LSN LogManager::GetStartLSN()
+{
+	pthread_mutex_lock(&this->latch);
+	LSN lsn = this->startLSN;
+	pthread_mutex_unlock(&this->latch);
+
+	return lsn;
+}
+
+LSN LogManager::GetEndLSN()
+{
+	pthread_mutex_lock(&this->latch);
+	LSN lsn = this->nextLSN;
+	pthread_mutex_unlock(&this->latch);
+
+	return lsn;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::GetLastLSN
+//
+// Input    : txnId - a transaction id
+// Output   : None
+// Return   : The LSN of the last record of the transaction, or
+//            INVALID_LSN if it has none or is not active.
+//--------------------------------------------------------------------
+
+LSN LogManager::GetLastLSN(int txnId)
+{
+	LSN lsn = INVALID_LSN;
+
+	pthread_mutex_lock(&this->latch);
+	int index = this->FindTransaction(txnId);
+	if (index >= 0)
+	{
+		lsn = this->lastLSNs[index];
+	}
+	pthread_mutex_unlock(&this->latch);
+
+	return lsn;
+}
+
+
+//--------------------------------------------------------------------
+// LogManager::GetOldestActiveLSN
+//
+// Input    : None
+// Output   : None
+// Return   : The LSN of the first record of the oldest active
+//            transaction, which an abort may have to read back; the
+//            end of the log if no transaction has logged anything.
+//--------------------------------------------------------------------
+
+LSN LogManager::GetOldestActiveLSN()
+{
+	pthread_mutex_lock(&this->latch);
+	LSN lsn = this->nextLSN;
+
+	for (int i = 0; i < this->numOfTxns; i++)
+	{
+		if (INVALID_LSN != this->firstLSNs[i] && this->firstLSNs[i] < lsn)
+		{
+			lsn = this->firstLSNs[i];
+		}
+	}
+	pthread_mutex_unlock(&this->latch);
+
+	return lsn;
+}
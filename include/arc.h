@@ -0,0 +1,52 @@
+#ifndef _ARC_H
+#define _ARC_H
+
+#include "replacer.h"
+#include "indexlist.h"
+#include "ghostlist.h"
+
+//--------------------------------------------------------------------
+// ARC
+//
+// Adaptive Replacement Cache (Megiddo & Modha). Resident pages are
+// kept in T1 (seen once recently) and T2 (seen at least twice), both
+// in LRU order; B1 and B2 remember the ids of pages recently evicted
+// from T1 and T2. A miss that hits B1 means T1 was too small and grows
+// the target size p of T1; a miss that hits B2 shrinks it. Victims are
+// taken from T1 while it is larger than p, from T2 otherwise.
+//
+// PickVictim is not told which page is about to be read, so the case
+// of the original algorithm where |T1| == p and the missing page is in
+// B2 takes the victim from T2.
+//--------------------------------------------------------------------
+
+class ARC : public Replacer
+{
+	private :
+
+		enum { FREE, T1, T2 };
+
+		int         target;    // p, the target size of T1
+		IndexLists* lists;
+		GhostList*  b1;
+		GhostList*  b2;
+
+		int FirstUnpinned(int list);
+		int AddUnpinned(int list, int* frameIds, int count, int max);
+
+	public :
+
+		ARC(int numOfBuf, Frame** frames);
+		~ARC();
+
+		int  PickVictim();
+		int  NextVictims(int* frameIds, int max);
+		void OnLoad(int frameId);
+		void OnPin(int frameId);
+		void OnEvict(int frameId);
+		void OnFree(int frameId);
+
+		const char* GetName() { return "ARC"; }
+};
+
+#endif // _ARC_H
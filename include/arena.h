@@ -0,0 +1,45 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include "page.h"
+
+// Transparent huge pages are 2MB on the platforms we care about
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+//--------------------------------------------------------------------
+// BufferArena
+//
+// The page images of a buffer pool, allocated as one page-aligned
+// slab instead of one heap object per frame. Page i lives at a fixed
+// offset from the start of the slab, so a large pool covers as few
+// TLB entries as possible; with hugePages set the slab is aligned to
+// and advised for transparent huge pages, where the system supports
+// them.
+//
+// Address space is reserved for maxNumOfPages pages, so that the slab
+// can be resized without moving the pages in use. The pages beyond the
+// current size use no memory.
+//--------------------------------------------------------------------
+
+class BufferArena
+{
+	private:
+
+		char* base;
+		char* mapping;
+		unsigned long mappingSize;
+		int   numOfPages;
+		int   maxNumOfPages;
+
+	public:
+
+		BufferArena(int numOfPages, int maxNumOfPages, bool hugePages);
+		~BufferArena();
+
+		void  Resize(int numOfPages);
+
+		Page* GetPage(int i) { return (Page*)(this->base + (unsigned long)i * MINIBASE_PAGESIZE); }
+		int   GetNumOfPages() { return this->numOfPages; }
+};
+
+#endif // _ARENA_H
@@ -0,0 +1,51 @@
+#ifndef _BMBENCH_H_
+#define _BMBENCH_H_
+
+#include "minirel.h"
+
+//--------------------------------------------------------------------
+// BMBenchmark
+//
+// Micro-benchmarks for the buffer manager. Unlike BMTester, which
+// checks correctness against the global MINIBASE_BM, each benchmark
+// builds its own buffer managers so that it can vary the pool size.
+// The global SystemDefs (and thus MINIBASE_DB) must exist before the
+// benchmarks are run.
+//--------------------------------------------------------------------
+
+class BMBenchmark
+{
+	public:
+
+		BMBenchmark();
+		~BMBenchmark();
+
+		// Run the benchmark with the given name, or all of them if
+		// name is NULL.
+		Status RunBenchmarks(const char* name = NULL);
+
+	private:
+
+		Status PinHitLatency();
+		Status PinMissLatency();
+		Status ConcurrentThroughput();
+		Status SequentialScan();
+		Status BackgroundWriter();
+		Status FlushDirtyPool();
+		Status PinRunLatency();
+		Status ScanResistance();
+		Status PoolIsolation();
+		Status OnlineResize();
+		Status CompressedTier();
+		Status WarmUpRestart();
+		Status PageSizeThroughput();
+		Status MappedScan();
+		Status IOEngineThroughput();
+		Status EmptyPoolMisses();
+		Status PageGuardLatency();
+		Status GroupCommit();
+		Status MissRatioEstimates();
+		Status EvictionPriorities();
+};
+
+#endif // _BMBENCH_H_
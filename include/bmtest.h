@@ -24,6 +24,14 @@ class BMTester : public TestDriver
 		int Test4();
 		int Test5();
 		int Test6();
+		int Test7();
+		int Test8();
+
+		typedef int (BMTester::*workloadFunction)(long& pinRequests, long& pinMisses);
+		int Test4Workload(long& pinRequests, long& pinMisses);
+		int Test5Workload(long& pinRequests, long& pinMisses);
+		int RunWithEachPolicy(workloadFunction workload);
+
 		const char* TestName();
 		void RunTest( Status& status, testFunction test );
 		Status RunAllTests();
@@ -1,42 +1,429 @@
 #ifndef _BUF_H
 #define _BUF_H
 
+#include <pthread.h>
+
 #include "db.h"
 #include "page.h"
 #include "frame.h"
-#include "lru.h"
+#include "replacer.h"
+#include "hash.h"
+#include "indexlist.h"
+#include "arena.h"
+#include "histogram.h"
+#include "bufring.h"
+#include "compcache.h"
+#include "mappeddb.h"
+#include "ioengine.h"
+#include "pageguard.h"
+#include "wal.h"
+#include "trace.h"
+#include "mrc.h"
+
+// Number of independently latched page table partitions, and of the
+// latches threads block on while waiting for a page to be read in.
+#define BUF_PARTITIONS  64
+#define BUF_IO_LATCHES  64
+
+// Read-ahead: once BUF_READ_AHEAD_TRIGGER consecutive pages have been
+// read in by PinPage, the following pages are prefetched, up to
+// BUF_READ_AHEAD_PAGES (or a quarter of the pool) ahead of the last
+// one. Prefetch requests beyond BUF_PREFETCH_QUEUE pending ones are
+// dropped.
+#define BUF_READ_AHEAD_TRIGGER  4
+#define BUF_READ_AHEAD_PAGES    16
+#define BUF_PREFETCH_QUEUE      256
+
+// The prefetcher reads up to BUF_PREFETCH_BATCH queued pages (and no
+// more than an eighth of the pool) at once, so that an I/O engine can
+// have them all in flight together.
+#define BUF_PREFETCH_BATCH      32
+
+// The background writer keeps the next BUF_CLEAN_PERCENT of the pool's
+// frames to be replaced clean. When there is nothing to write it
+// sleeps for BUF_WRITER_DELAY_MS milliseconds.
+#define BUF_CLEAN_PERCENT       25
+#define BUF_WRITER_DELAY_MS     10
+
+// The time a frame stays pinned is measured for one in BUF_PIN_SAMPLE
+// pins (a power of two), as reading the clock costs more than a hit.
+#define BUF_PIN_SAMPLE          64
+
+// A pool can be resized while in use, up to BUF_MAX_GROWTH times the
+// number of frames it was created with. Address space for that many
+// page images is reserved up front; memory is only used as it grows.
+#define BUF_MAX_GROWTH  4
+
+// How long Resize waits for the frames that go away to be unpinned.
+#define BUF_RESIZE_WAIT_MS  100
+
+// A buffer manager can own up to BUF_MAX_POOLS further named pools,
+// each with its own frames and replacer, see BufMgr::AddPool.
+#define BUF_MAX_POOLS   8
+
+// Warm-up lists start with this number, then the number of entries.
+#define BUF_WARM_UP_MAGIC  0x4d57424d
+
+// Back the page images of a pool with transparent huge pages where the
+// system supports them. Build with -DBUF_HUGE_PAGES=0 to turn it off.
+#ifndef BUF_HUGE_PAGES
+#define BUF_HUGE_PAGES  1
+#endif
+
+// What a pinned page holds, as far as the caller tells PinPage. Used
+// to break the statistics down, and to choose the eviction priority of
+// the frame, see BufMgr::SetPriority.
+enum PageClass
+{
+	PAGE_CLASS_OTHER,
+	PAGE_CLASS_DATA,        // heap file data pages
+	PAGE_CLASS_DIRECTORY,   // heap file directory pages
+	PAGE_CLASS_INDEX,       // B+ tree index (inner) pages
+	PAGE_CLASS_LEAF,        // B+ tree leaf pages
+	PAGE_CLASS_SPACE_MAP,   // database header and space map pages
+	NUM_OF_PAGE_CLASSES
+};
+
+//--------------------------------------------------------------------
+// BufStats
+//
+// The statistics of a buffer pool, as returned by BufMgr::GetStats.
+// Counters cover the time since the pool was created or ResetStat was
+// last called; the occupancy figures describe the pool at the time of
+// the call. Durations are in nanoseconds.
+//--------------------------------------------------------------------
+
+struct BufStats
+{
+	// Pin requests and misses, by page class
+	long pins[NUM_OF_PAGE_CLASSES];
+	long misses[NUM_OF_PAGE_CLASSES];
+
+	long evictions;           // pages replaced to make room for a miss
+	long dirtyEvictions;      // of those, the ones written back first
+	long victimSearches;      // victims asked of the replacer
+	long victimSearchLength;  // frames the replacer looked at meanwhile
+	long foregroundWrites;    // pages written by the threads using the pool
+	long backgroundWrites;    // pages written by the background writer
+	long prefetches;          // pages read in by the prefetcher
+	long compressedHits;      // misses served by the compressed cache
+	long compressedMisses;    // misses it could not serve, read from disk
+
+	Histogram readLatency;    // per read request, single or multi-page
+	Histogram writeLatency;   // per write request, single or multi-page
+	Histogram pinHoldTime;    // from a (sampled) pin to the last unpin
+
+	int numOfFrames;
+	int numOfValidFrames;
+	int numOfPinnedFrames;
+	int numOfDirtyFrames;
+	int numOfCompressedPages;
+	int numOfCompressedBytes;
+
+	// Since the log was enabled
+	long commits;             // transactions committed
+	long logSyncs;            // times the log was written and synced
+
+	// Estimated hit ratios of an LRU pool of mrcSizes frames: half,
+	// once, twice and four times the pool size (see MRCEstimator)
+	int    mrcSizes[MRC_POINTS];
+	double mrcHitRatios[MRC_POINTS];
+	long   mrcSamples;        // pins the estimates are drawn from
+
+	long GetPins();
+	long GetMisses();
+	long GetHits(int pageClass) { return this->pins[pageClass] - this->misses[pageClass]; }
+};
+
+//--------------------------------------------------------------------
+// BufMgr
+//
+// PinPage and UnpinPage may be called concurrently from any number of
+// threads. The page table is split into BUF_PARTITIONS partitions by
+// page id, each with its own latch, so lookups of different pages
+// rarely contend. Pin counts are atomic, and the replacer is protected
+// by a single latch that is only held for the duration of a hook. Hits
+// and unpins do without it when the policy allows (Clock does, see
+// Replacer), taking only the partition latch of the page.
+// Latches are always taken in the order: partition latches (lower
+// index first), then the replacer latch.
+//
+// A page that is being read in is already in the page table, marked
+// as I/O in progress; threads pinning it meanwhile wait for the read
+// to finish instead of reading the page again. Prefetched pages are
+// read in the same way by a background I/O thread, started on the
+// first prefetch request.
+//
+// A background writer thread, started when the first page is unpinned
+// dirty, writes dirty unpinned frames ahead of replacement, and misses
+// prefer clean victims, so that PinPage rarely has to write a page
+// before it can read one.
+//
+// Scans pin through a BufferRing, so that they recycle a few frames of
+// their own instead of flushing the pool.
+//
+// The buffer manager can also own named pools of their own size (say
+// "index", "heap" and "temp"), to which pages are bound with BindPages
+// or BindFile, or by being allocated while the pool is selected with
+// UsePool. Calls for a bound page are forwarded to its pool, so that
+// callers keep using MINIBASE_BM and pages of different pools never
+// evict each other. Pages that are not bound stay in this pool.
+//
+// Resize grows or shrinks a pool while it is in use, so that memory
+// can be moved between the pools, or to sort and hash work areas.
+//
+// With EnableCompressedCache, clean pages leaving the pool are kept
+// compressed in a second tier of a fixed number of bytes, and a miss
+// on one of them decompresses it into the frame instead of reading it.
+//
+// With SetWarmUpFile, the ids of the resident pages and how recently
+// each was used are saved when the pool is flushed or destroyed. After
+// a restart, WarmUp has the prefetcher read them back in PageID order
+// while the pool is already in use.
+//
+// After UseMapping, the pool serves pages straight out of the database
+// file mapped into memory instead of copying them into frames: a pin
+// only counts a reference, and the operating system does the paging.
+//
+// PinPage and NewPage can also pin into a PageGuard, which unpins the
+// page when it goes out of scope, straight through the frame the page
+// was found in rather than by looking the page up again.
+//
+// With EnableLog, changes made by transactions are logged with
+// LogUpdate, and each frame remembers the LSN of the last change to
+// its page; the log is flushed up to it before the page is written.
+// The on-disk page formats belong to the access methods and have no
+// room for an LSN, so recovery replays the whole log, which Checkpoint
+// empties once the pages it changed have been written.
+//
+// StartRecording writes every PinPage and UnpinPage, of this pool and
+// its named pools, to a trace file, for Trace::Load to read back and
+// replay or simulate offline.
+//
+// Each pool also estimates, from a small sample of the pages, what its
+// hit ratio would be with half, twice or four times as many frames;
+// see GetStats.
+//
+// A pin tagged with a page class (other than PAGE_CLASS_OTHER) gives
+// the frame the eviction priority of that class, which it keeps until
+// the page is replaced or pinned with another class. By default index,
+// directory and space map pages are high priority, so that the pages
+// leading to the data survive a large scan (see Replacer).
+//--------------------------------------------------------------------
 
 class BufMgr 
 {
+	friend class PageGuard;
+
 	private:
 
-		Frame* frames;
-		LRU*   replacer;
-		int    numOfBuf;
+		struct Partition
+		{
+			pthread_mutex_t latch;
+			HashTable*      pageTable;
+		} __attribute__((aligned(64)));
+
+		struct IOLatch
+		{
+			pthread_mutex_t latch;
+			pthread_cond_t  done;
+		} __attribute__((aligned(64)));
+
+		Frame*       frames;
+		BufferArena* arena;
+		Replacer*    replacer;
+		bool         latchFreeHooks;   // see Replacer::HasLatchFreeHooks
+		int          numOfBuf;
+		int          maxNumOfBuf;
+
+		// Empty frames, taken by misses before asking the replacer for
+		// a victim; under replacerLatch. A frame emptied while still
+		// claimed may be missing, but the replacer prefers empty frames
+		// anyway. Occupancy is counted by the frames themselves.
+		enum { FREE_FRAMES };
+		IndexLists*   freeFrames;
+		FrameCounters frameCounters;
+
+		Partition*      partitions;
+		IOLatch*        ioLatches;
+		pthread_mutex_t replacerLatch;
+		pthread_mutex_t resizeLatch;
+
+		// Prefetch queue and the I/O thread serving it
+		pthread_t       prefetcher;
+		bool            prefetcherRunning;
+		bool            prefetcherStop;
+		pthread_mutex_t prefetchLatch;
+		pthread_cond_t  prefetchQueued;
+		PageID          prefetchQueue[BUF_PREFETCH_QUEUE];
+		int             prefetchHead;
+		int             prefetchCount;
+
+		// Pages to warm up with, read once the queue is empty, until
+		// the pool is full; also under prefetchLatch
+		PageID*         warmUpPids;
+		int             warmUpCount;
+		int             warmUpNext;
+		long            warmUpEvictions;
+		char*           warmUpFile;
+
+		// Sequential access detection, also under prefetchLatch
+		int             readAheadPages;
+		PageID          lastReadPid;
+		int             sequentialReads;
+		PageID          readAheadEnd;
+
+		// Background writer
+		pthread_t       writer;
+		bool            writerRunning;
+		bool            writerStop;
+		pthread_mutex_t writerLatch;
+		pthread_cond_t  writerWake;
+		int             cleanPercent;
+
+		// Second tier for clean evicted pages, NULL if not enabled
+		CompressedCache* compressedCache;
+
+		// The database file, in mapped mode; NULL otherwise
+		MappedDB*        mapping;
+
+		// Page I/O goes through DB::ReadPage and DB::WritePage if NULL
+		IOEngine*        ioEngine;
+
+		// Write-ahead log, NULL if not enabled; shared with the named
+		// pools. For the page in each frame, pageLSNs has the LSN of the
+		// last change logged, and recLSNs that of the first one since
+		// the page was last written.
+		LogManager*      log;
+		LSN*             pageLSNs;
+		LSN*             recLSNs;
+		bool             checkpointing;
+
+		// Records pins and unpins, NULL if not recording; shared with
+		// the named pools
+		TraceRecorder*   recorder;
+
+		IOEngine* GetIOEngine() { return __atomic_load_n(&this->ioEngine, __ATOMIC_ACQUIRE); }
 
 		int FindFrame(PageID pid);
+		Status PinFrame(PageID pid, bool isEmpty, int pageClass, BufferRing* ring, Page*& page, BufMgr*& pool, int& frameId);
+		Status UnpinFrame(int frameId, PageID pid, bool dirty);
+		void   MarkDirty(int frameId, PageID pid);
 		Status FlushFrame(int frameId, bool ignorePinned = false);
 
-		long totalCall;
-		long totalMiss;
-		long numDirtyPageWrites;
+		Status ForceLog(int frameId);
+		Status ForceLog(Frame** frames, int count);
+		void   StampPage(int frameId, LSN lsn);
+		Status ApplyImage(PageID pid, int offset, int length, const char* image, int txnId, LSN lsn);
+		Status Recover();
+		void   WriteDirtyFrames();
+		void   ForgetWrittenChanges(Frame** frames, int count);
+		LSN    GetOldestChangeLSN();
+
+		Partition* PartitionOf(PageID pid) { return &this->partitions[(unsigned int)pid % BUF_PARTITIONS]; }
+		void LockPartitions(PageID pid1, PageID pid2);
+		void UnlockPartitions(PageID pid1, PageID pid2);
+
+		bool ClaimFrame(int frameId);
+		void UnclaimFrame(int frameId);
+		int  ClaimVictim(BufferRing* ring);
+		Status LoadPage(PageID pid, bool isEmpty, bool prefetch, BufferRing* ring, int& frameId);
+		Status InstallPage(PageID pid, bool prefetch, BufferRing* ring, int& frameId);
+		void FinishLoad(int frameId, Status status);
+		Status DropClaimedPage(int frameId, bool& dropped);
+		void RebuildReplacer(int bufSize);
+		Status ReleaseFrame(int frameId);
+		void WaitForIO(int frameId);
+		void FinishIO(int frameId);
+
+		static void* RunPrefetcher(void* bufMgr);
+		void PrefetchPages(PageID* pids, int count);
+		void ReadAhead(PageID pid);
+		int  ListResidentPages(PageID* pids, int* ranks, int max);
+		Status PinMappedRun(PageID firstPid, int count, Page** pages, int pageClass);
+		Status QueueWarmUp(PageID* pids, int count);
+
+		static void* RunWriter(void* bufMgr);
+		void StartWriter();
+		int  CleanFrames(int* candidates, Frame** dirtyFrames);
+
+		// The EvictionPriority of each page class
+		int priorities[NUM_OF_PAGE_CLASSES];
+
+		// Statistics, updated atomically
+		BufStats stats;
+		long*    pinStart;
+		long     examinedAtReset;
+
+		// Hit ratios at other pool sizes, from the sampled pins
+		MRCEstimator* mrc;
+
+		// Named pools, and the index of the pool each bound page is in.
+		// Pages allocated by NewPage go to pools[allocationPool], or to
+		// this pool if it is INVALID_FRAME.
+		BufMgr*          pools[BUF_MAX_POOLS];
+		char*            poolNames[BUF_MAX_POOLS];
+		int              numOfPools;
+		int              allocationPool;
+		HashTable*       poolOfPage;
+		pthread_rwlock_t poolLatch;
+
+		BufMgr* PoolOf(PageID pid);
+		int     FindPool(const char* name);
+		void    Route(PageID firstPid, int count, int poolIndex);
 
 	public:
 
-		BufMgr(int bufsize);
+		BufMgr(int bufsize, const char* replacementPolicy = NULL);
 		~BufMgr();      
 		Status PinPage(PageID pid, Page*& page, Bool isEmpty = false);
+		Status PinPage(PageID pid, Page*& page, Bool isEmpty, int pageClass, BufferRing* ring = NULL);
+		Status PinPage(PageID pid, PageGuard& guard, bool isEmpty = false, int pageClass = PAGE_CLASS_OTHER, BufferRing* ring = NULL);
 		Status UnpinPage(PageID pid, Bool dirty = false);
 		Status NewPage(PageID& pid, Page*& firstpage, int howMany = 1);
+		Status NewPage(PageID& firstPid, PageGuard& guard, int howMany = 1);
+		Status PinRun(PageID firstPid, int count, Page** pages, bool isEmpty = false, int pageClass = PAGE_CLASS_OTHER);
+		Status NewRun(PageID& firstPid, Page** pages, int howMany);
 		Status FreePage(PageID pid);
 		Status FlushPage(PageID pid, bool ignorePinned = false);
 		Status FlushAllPages();
-		Status GetStat(long& pinNo, long& missNo) { pinNo = totalCall; missNo = totalMiss; return OK; }
+		Status Prefetch(PageID pid, int count = 1);
+		Status Resize(int bufSize);
+		void   SetReadAhead(int numOfPages);
+		void   SetBackgroundWriter(int cleanPercent);
+		Status SetPriority(int pageClass, int priority);
+		int    GetPriority(int pageClass) { return __atomic_load_n(&this->priorities[pageClass], __ATOMIC_RELAXED); }
+		Status EnableCompressedCache(int numOfBytes);
+		Status SetWarmUpFile(const char* fileName);
+		Status SaveWarmUpList();
+		Status WarmUp();
+		Status UseMapping();
+		Status SetIOEngine(const char* name, bool direct = true);
+		const char* GetIOEngineName();
+		Status EnableLog(const char* fileName, int maxLogSize);
+		Status BeginTransaction(int& txnId);
+		Status LogUpdate(int txnId, PageGuard& guard, int offset, int length, const char* before);
+		Status CommitTransaction(int txnId);
+		Status AbortTransaction(int txnId);
+		Status Checkpoint();
+		Status StartRecording(const char* fileName);
+		Status StopRecording();
+		Status GetStat(long& pinNo, long& missNo);
+		Status GetWriteStat(long& foreground, long& background);
+		long   GetNumOfPrefetches() { return __atomic_load_n(&stats.prefetches, __ATOMIC_RELAXED); }
+		void   GetStats(BufStats& snapshot);
+
+		Status  AddPool(const char* name, int bufSize, const char* replacementPolicy = NULL);
+		BufMgr* GetPool(const char* name);
+		Status  UsePool(const char* name);
+		Status  BindPages(PageID firstPid, int count, const char* poolName);
+		Status  BindFile(const char* fileName, const char* poolName);
 
 		unsigned int GetNumOfUnpinnedFrames();
+		const char*  GetReplacementPolicy() { return replacer->GetName(); }
 
 		void PrintStat();
-		void ResetStat() { totalMiss = 0; totalCall = 0; numDirtyPageWrites = 0; }
+		void ResetStat();
 };
 
 
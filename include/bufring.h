@@ -0,0 +1,44 @@
+#ifndef _BUFRING_H
+#define _BUFRING_H
+
+#include "page.h"
+
+// Default number of frames of a BufferRing
+#define BUF_RING_FRAMES 16
+
+//--------------------------------------------------------------------
+// BufferRing
+//
+// An access strategy for sequential, use-once readers such as a heap
+// file scan or the outer loop of a nested loop join. Passed to
+// BufMgr::PinPage, it makes misses reuse a small private ring of
+// frames instead of asking the replacer for victims: once the ring is
+// full, each miss takes the frame the ring used numOfFrames misses
+// ago, if it still holds the page read into it then and nobody else
+// has it pinned. The rest of the pool, with the index and catalog
+// pages other work depends on, is left alone.
+//
+// A ring belongs to one reader (it is not latched) and is only
+// meaningful with the buffer manager it was first used with.
+//--------------------------------------------------------------------
+
+class BufferRing
+{
+	private:
+
+		int*    frameIds;
+		PageID* pids;
+		int     numOfFrames;
+		int     current;
+
+	public:
+
+		BufferRing(int numOfFrames = BUF_RING_FRAMES);
+		~BufferRing();
+
+		int  GetNumOfFrames() { return this->numOfFrames; }
+		int  GetFrame(PageID& pid);
+		void Record(int frameId, PageID pid);
+};
+
+#endif // _BUFRING_H
@@ -0,0 +1,74 @@
+#ifndef _COMPCACHE_H
+#define _COMPCACHE_H
+
+#include <pthread.h>
+
+#include "page.h"
+#include "hash.h"
+#include "indexlist.h"
+
+// Pages that do not compress to at most COMP_CACHE_MAX_SIZE bytes are
+// not worth keeping compressed, and are not cached.
+#define COMP_CACHE_MAX_SIZE  (MINIBASE_PAGESIZE * 7 / 8)
+
+// Budget per page slot: a cache of n bytes has room for the data of
+// n / COMP_CACHE_MIN_SIZE pages at most.
+#define COMP_CACHE_MIN_SIZE  32
+
+//--------------------------------------------------------------------
+// CompressedCache
+//
+// A second tier below a buffer pool: clean pages evicted from the pool
+// are kept here compressed, so that a later miss on one of them costs
+// a decompression instead of a read. A page is in at most one of the
+// two tiers; Get hands it back to the pool and forgets it.
+//
+// Pages are compressed with a byte-oriented LZ77 scheme in the format
+// of LZ4 blocks, which decompresses at memory speed. The compressed
+// pages take at most numOfBytes bytes in all; the pages put in the
+// longest ago make room for new ones.
+//
+// All methods are latched and may be called from any thread.
+//--------------------------------------------------------------------
+
+class CompressedCache
+{
+	private:
+
+		enum { USED, UNUSED };
+
+		int         numOfBytes;
+		int         numOfUsedBytes;
+		int         numOfSlots;
+		PageID*     pids;
+		char**      data;
+		int*        sizes;
+		HashTable*  index;   // pid -> slot
+		IndexLists* order;   // oldest first
+		pthread_mutex_t latch;
+
+		void FreeSlot(int slot);
+
+	public:
+
+		CompressedCache(int numOfBytes);
+		~CompressedCache();
+
+		bool Put(PageID pid, const char* compressed, int size);
+		bool Get(PageID pid, char* page);
+		void Remove(PageID pid);
+
+		int  GetNumOfPages()     { return this->order->Size(USED); }
+		int  GetNumOfUsedBytes() { return this->numOfUsedBytes; }
+		int  GetNumOfBytes()     { return this->numOfBytes; }
+
+		// Compress a page into at most COMP_CACHE_MAX_SIZE bytes.
+		// Returns the compressed size, 0 if the page does not fit.
+		static int Compress(const char* page, char* compressed);
+
+		// Decompress into a page. Returns false if the data is not a
+		// well formed compressed page.
+		static bool Decompress(const char* compressed, int size, char* page);
+};
+
+#endif // _COMPCACHE_H
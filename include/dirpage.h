@@ -6,8 +6,8 @@
 struct PageInfo 
 {
 	PageID pid;
-	short  spaceAvailable;
-	short  numOfRecords;
+	PageOffset spaceAvailable;
+	PageOffset numOfRecords;
 };
 
 
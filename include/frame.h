@@ -1,38 +1,85 @@
 #ifndef FRAME_H
 #define FRAME_H
 
-#include <ctime>
 #include "page.h"
 
+class IOEngine;
+
+//--------------------------------------------------------------------
+// FrameCounters
+//
+// Occupancy of a set of frames, kept up to date by the frames on each
+// state change, so that it can be read without scanning them: frames
+// holding a page, frames pinned (or claimed) and frames dirty.
+//--------------------------------------------------------------------
+
+struct FrameCounters
+{
+	int numOfValid;
+	int numOfPinned;
+	int numOfDirty;
+};
+
 #define INVALID_FRAME -1
 
+//--------------------------------------------------------------------
+// Frame
+//
+// The descriptor of a buffer pool frame. The page image itself lives
+// in the pool's BufferArena; descriptors are kept small and aligned so
+// that two share a cache line and scans over all frames stay cheap.
+//
+// The pin count, the dirty flag and the I/O flag are read and written
+// atomically, so they may be inspected without holding any latch. The
+// page id only changes while the buffer manager holds the latch of the
+// page table partition the page belongs to.
+//
+// A frame given FrameCounters updates them whenever it becomes valid or
+// empty, pinned or unpinned, dirty or clean.
+//--------------------------------------------------------------------
+
 class Frame 
 {
 	private :
 		PageID  pid;
-		Page*   data;
 		int     pinCount;
 		bool    dirty;
-		clock_t timestamp;
+		bool    ioInProgress;
+		bool    prefetched;
+		Page*   data;
+		FrameCounters* counters;
+
+		void    Count(int FrameCounters::*counter, int delta);
 
 	public :
 		Frame();
 		~Frame();
+		void    SetPage(Page* page);
+		void    SetCounters(FrameCounters* counters);
 		void    Pin();
-		void    Unpin();
+		int     Unpin();
+		bool    TryClaim();
 		void    EmptyIt();
 		void    DirtyIt();
+		void    CleanIt();
 		void    SetPageID(PageID pid);
 		bool    IsDirty();
 		bool    IsValid();
-		Status  Write();
-		Status  Read(PageID pid);
+		Status  Write(IOEngine* engine = NULL);
+		Status  Read(PageID pid, IOEngine* engine = NULL);
 		Status  Free();
 		bool    NotPinned();
+		int     GetPinCount();
 		bool    HasPageID(PageID pid);
 		PageID  GetPageID();
 		Page*   GetPage();
-		clock_t GetTimestamp();
-};
+		void    SetIOInProgress(bool inProgress);
+		bool    IsIOInProgress();
+		void    SetPrefetched(bool prefetched);
+		bool    TakePrefetched();
+
+		static int    WriteFrames(Frame** frames, int count, IOEngine* engine = NULL);
+		static Status ReadFrames(Frame** frames, int count, IOEngine* engine = NULL);
+} __attribute__((aligned(32)));
 
 #endif
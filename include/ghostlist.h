@@ -0,0 +1,40 @@
+#ifndef _GHOSTLIST_H
+#define _GHOSTLIST_H
+
+#include "hash.h"
+#include "indexlist.h"
+
+//--------------------------------------------------------------------
+// GhostList
+//
+// A bounded list of page ids that are no longer in the buffer pool,
+// oldest first. Replacers use ghost lists to remember recently evicted
+// pages (2Q's A1out, ARC's B1 and B2). Each ghost occupies one of
+// capacity entries; the entry number may be used by the owner to keep
+// extra per-ghost state in a parallel array.
+//--------------------------------------------------------------------
+
+class GhostList
+{
+	private :
+
+		enum { USED, UNUSED };
+
+		int         capacity;
+		PageID*     pids;
+		HashTable*  index;   // pid -> entry
+		IndexLists* order;
+
+	public :
+
+		GhostList(int capacity);
+		~GhostList();
+
+		int  Insert(PageID pid);
+		int  Find(PageID pid);
+		void Remove(PageID pid);
+		void RemoveOldest();
+		int  Size() { return this->order->Size(USED); }
+};
+
+#endif // _GHOSTLIST_H
@@ -4,75 +4,45 @@
 #include "minirel.h"
 #include "frame.h"
 
-#define NUM_OF_BUCKETS 21
-#define HASH(k)  k % NUM_OF_BUCKETS
+//--------------------------------------------------------------------
+// HashTable
+//
+// Maps page ids to frame numbers. The table uses open addressing with
+// linear probing over a single power-of-two sized array of entries, so
+// no memory is allocated per mapping. The capacity is chosen so that
+// the load factor stays at or below 1/2 for maxEntries mappings, and
+// the array is doubled if more are inserted. This keeps the expected
+// probe length constant regardless of the buffer pool size.
+//--------------------------------------------------------------------
 
-	
-class Map
-{
-	friend class MapIterator;
-
-private :
-
-	int pid;
-	int frameNo;
-	class Map *next;
-	class Map *prev;
-
-public :
-	
-	Map(PageID p, int f);
-	~Map();
-	void AddBehind(Map *m);
-	void DeleteMe();
-	Bool HasPageID(PageID p);
-	int FrameNo();
-
-};
-
-
-class MapIterator
-{
-	Map *head;
-	Map *current;
-
-public :
-
-	MapIterator(Map *maps);
-	Map* operator() ();
-
-};
-
-
-class Bucket
+class HashTable
 {
 private:
 
-	Map *maps;
-
-public :
-
-	Bucket();
-	~Bucket();
-	void Insert(PageID pid, int frameNo);
-	Status Delete(PageID pid);
-	int Find(PageID pid);
-	void EmptyIt();
-};
+	struct Entry
+	{
+		PageID pid;     // INVALID_PAGE if the slot is empty.
+		int    frameNo;
+	};
 
+	Entry*       entries;
+	unsigned int capacity;    // Always a power of two.
+	unsigned int shift;       // 32 - log2(capacity), used by Slot().
+	int          numOfEntries;
 
-class HashTable
-{
-private:
-
-	Bucket buckets[NUM_OF_BUCKETS];
+	unsigned int Slot(PageID pid);
+	void         Grow();
 
 public :
 
-	void Insert(PageID pid, int frameNo);
+	HashTable(int maxEntries);
+	~HashTable();
+
+	void   Insert(PageID pid, int frameNo);
 	Status Delete(PageID pid);
-	int LookUp(PageID pid);
-	void EmptyIt();
+	int    LookUp(PageID pid);
+	void   EmptyIt();
+	int    Size() { return numOfEntries; }
 };
 
 
@@ -9,7 +9,7 @@ const int INVALID_SLOT =  -1;
 //
 // CHANGE this constant whenever you update the structure of HeapPage class.
 //
-const int HEAPPAGE_DATA_SIZE=(MAX_SPACE - 3*sizeof(PageID) - 6*sizeof(short));
+const int HEAPPAGE_DATA_SIZE=(MAX_SPACE - 3*sizeof(PageID) - 6*sizeof(PageOffset));
 
 class HeapPage {
 
@@ -17,19 +17,19 @@ protected :
 
 	struct Slot 
 	{
-		short offset; // offset of record from the start of dataarea.
-		short length; // length of the record.
+		PageOffset offset; // offset of record from the start of dataarea.
+		PageOffset length; // length of the record.
 	};
 
 
-	short   numOfSlots;  // Number of slots available (maybe filled or
-	                     // empty.
-	short   fillPtr;     // Offset from start of data area, where 
-	                     // the records resides.
-	short   freeSpace;   // Amount of free space in bytes in this page.
+	PageOffset numOfSlots;  // Number of slots available (maybe filled or
+	                        // empty.
+	PageOffset fillPtr;     // Offset from start of data area, where 
+	                        // the records resides.
+	PageOffset freeSpace;   // Amount of free space in bytes in this page.
 	
-	short   type;        // Not used for HeapFile assignment, but will 
-	                     // be used in B+-tree assignment.
+	PageOffset type;        // Not used for HeapFile assignment, but will 
+	                        // be used in B+-tree assignment.
 
 	PageID  pid;         // Page ID of this page  
 	PageID  nextPage;    // Page ID of the next page in a link list.
@@ -81,6 +81,14 @@ public:
 #define NEWPAGE(a, b)  if (MINIBASE_BM->NewPage((a), (Page *&)(b)) != OK) {\
 						cerr << "Unable to allocate new page " << a << endl; return FAIL;}
 
+// As PIN and NEWPAGE, pinning into a PageGuard g, which unpins the page
+// on every way out of the caller, so that there is no UNPIN to forget.
+// Call g.DirtyIt() after changing the page.
+#define PIN_GUARD(a, g)     if (MINIBASE_BM->PinPage((a), (g)) != OK) {\
+						cerr << "Unable to pin page " << a << endl; return FAIL;}
+#define NEWPAGE_GUARD(a, g) if (MINIBASE_BM->NewPage((a), (g)) != OK) {\
+						cerr << "Unable to allocate new page " << a << endl; return FAIL;}
+
 #define DIRTY TRUE
 #define CLEAN FALSE
 
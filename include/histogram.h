@@ -0,0 +1,39 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+// Values up to 2^(HISTOGRAM_BUCKETS - 2) fall in buckets of their own;
+// larger ones share the last bucket.
+#define HISTOGRAM_BUCKETS 40
+
+//--------------------------------------------------------------------
+// Histogram
+//
+// Counts non-negative values, typically durations in nanoseconds, in
+// buckets of powers of two: bucket 0 holds 0 and bucket i holds the
+// values in [2^(i-1), 2^i). Add may be called from several threads at
+// once; percentiles are only as precise as the buckets.
+//--------------------------------------------------------------------
+
+class Histogram
+{
+	private:
+
+		long buckets[HISTOGRAM_BUCKETS];
+		long count;
+		long sum;
+
+	public:
+
+		Histogram();
+
+		void Add(long value);
+		void Reset();
+		void CopyFrom(Histogram& other);
+
+		long   GetCount() { return this->count; }
+		long   GetSum()   { return this->sum; }
+		double GetMean();
+		long   GetPercentile(double percent);
+};
+
+#endif // _HISTOGRAM_H
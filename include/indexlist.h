@@ -0,0 +1,49 @@
+#ifndef _INDEXLIST_H
+#define _INDEXLIST_H
+
+#define INVALID_INDEX -1
+
+//--------------------------------------------------------------------
+// IndexLists
+//
+// A fixed set of doubly linked lists over the integers [0, n), with
+// every integer in at most one list at a time. The links are kept in
+// arrays indexed by the integer, so insertion, removal and moving an
+// entry between lists are O(1) and never allocate. Replacers use it
+// to keep frame numbers (or ghost entry numbers) in recency order:
+// the front of a list is the oldest entry, the back the newest.
+//--------------------------------------------------------------------
+
+class IndexLists
+{
+	private :
+
+		int  numOfLists;
+		int* head;     // Per list
+		int* tail;
+		int* size;
+
+		int  numOfEntries;
+		int* prev;     // Per entry
+		int* next;
+		int* owner;    // List an entry is on, INVALID_INDEX if none
+
+	public :
+
+		IndexLists(int numOfEntries, int numOfLists);
+		~IndexLists();
+
+		void PushBack(int listNo, int entry);
+		void PushFront(int listNo, int entry);
+		void Remove(int entry);
+		void MoveToBack(int listNo, int entry) { this->Remove(entry); this->PushBack(listNo, entry); }
+		void EmptyIt();
+
+		int  Front(int listNo) { return this->head[listNo]; }
+		int  Back(int listNo)  { return this->tail[listNo]; }
+		int  Next(int entry)   { return this->next[entry]; }
+		int  Size(int listNo)  { return this->size[listNo]; }
+		int  ListOf(int entry) { return this->owner[entry]; }
+};
+
+#endif // _INDEXLIST_H
@@ -0,0 +1,134 @@
+#ifndef _IOENGINE_H
+#define _IOENGINE_H
+
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "page.h"
+
+// Requests in flight at a time, in the ring or in the thread pool
+#define IO_QUEUE_DEPTH    64
+
+// Worker threads when io_uring is not available
+#define IO_NUM_OF_THREADS 4
+
+struct IOBatch;
+
+//--------------------------------------------------------------------
+// IORequest
+//
+// A run of count consecutive pages starting at pid, read into or
+// written from the given page images. The engine fills in status.
+//--------------------------------------------------------------------
+
+struct IORequest
+{
+	PageID  pid;
+	int     count;
+	Page**  pages;
+	bool    write;
+	Status  status;
+
+	// Used by the engine
+	struct iovec* iov;
+	bool       direct;
+	long       result;
+	IOBatch*   batch;
+	IORequest* next;
+};
+
+//--------------------------------------------------------------------
+// IOEngine
+//
+// Page I/O on the database file that keeps many requests in flight at
+// once, for the prefetcher and the write-back of dirty pages. DB's own
+// ReadPage and WritePage seek and transfer on one shared descriptor,
+// one page at a time; the engine opens the file itself.
+//
+// Requests go through io_uring where the kernel has it, submitted on
+// the submission queue and reaped from the completion queue by one
+// waiting thread at a time on behalf of all. Otherwise a small pool
+// of threads does them with preadv and pwritev.
+//
+// The file is opened with O_DIRECT if asked, bypassing the page cache:
+// page images come from the page-aligned buffer arena, and pages are
+// at least 1 KiB, so that transfers are suitably aligned. If the file
+// system refuses direct I/O, the engine falls back to buffered I/O for
+// good.
+//
+// The file is opened on first use, as the buffer manager may be set up
+// before the database.
+//--------------------------------------------------------------------
+
+class IOEngine
+{
+	private:
+
+		enum Kind { IO_URING, THREADS };
+
+		Kind  kind;
+		bool  direct;
+		bool  opened;
+		int   directFd;
+		int   bufferedFd;
+
+		pthread_mutex_t latch;
+		pthread_cond_t  queued;      // for the worker threads
+		pthread_cond_t  completed;   // for the submitters
+		IORequest* queueHead;        // waiting to be started
+		IORequest* queueTail;
+		int        numOfInFlight;
+		bool       stop;
+
+		// io_uring
+		int        ringFd;
+		void*      sqRing;
+		void*      cqRing;
+		size_t     sqRingSize;
+		size_t     cqRingSize;
+		void*      sqes;
+		size_t     sqesSize;
+		unsigned*  sqHead;
+		unsigned*  sqTail;
+		unsigned*  sqMask;
+		unsigned*  sqArray;
+		unsigned*  cqHead;
+		unsigned*  cqTail;
+		unsigned*  cqMask;
+		void*      cqes;
+		int        numOfUnsubmitted;
+		bool       reaping;
+
+		// Thread pool
+		pthread_t  threads[IO_NUM_OF_THREADS];
+		int        numOfThreads;
+
+		bool   SetUpRing();
+		Status Open();
+		void   Prepare(IORequest* request);
+		void   StartQueued();
+		void   ReapCompletions();
+		void   Complete(IORequest* request, long result);
+
+		static long  Transfer(int fd, IORequest* request);
+		static void* RunWorker(void* arg);
+
+	public:
+
+		IOEngine(const char* kind, bool direct);
+		~IOEngine();
+
+		// Carry out the requests, all in flight together as far as
+		// the queue depth allows, and wait for them to finish.
+		// Returns OK if all of them succeeded.
+		Status Submit(IORequest* requests, int count);
+
+		Status Read(PageID pid, Page* page);
+		Status Write(PageID pid, Page* page);
+
+		// "io_uring" or "threads"
+		const char* GetName();
+		bool IsDirect() { return __atomic_load_n(&this->direct, __ATOMIC_ACQUIRE); }
+};
+
+#endif // _IOENGINE_H
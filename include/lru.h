@@ -1,18 +1,43 @@
 #ifndef _LRU_H
 #define _LRU_H
 
-#include "frame.h"
+#include "replacer.h"
+#include "indexlist.h"
 
-class LRU
+//--------------------------------------------------------------------
+// LRU
+//
+// Keeps the unpinned frames on a list in the order in which they were
+// unpinned, with empty frames in front. The victim is the front of the
+// list, so it is found in O(1) and is exactly the least recently
+// unpinned frame.
+//
+// Low priority frames are unpinned to the front of the list instead.
+// A high priority frame found at the front goes to the back again, up
+// to REPLACER_EXTRA_CHANCES times after each unpin, so that it outlasts
+// that many more pages unpinned after it.
+//--------------------------------------------------------------------
+
+class LRU : public Replacer
 {
 	private:
-		int current;
-		int numOfBuf;
-		Frame** frames;
+		enum { UNPINNED };
+
+		IndexLists* unpinned;
+		char*       chances;      // extra chances left, per frame
 
 	public :
-		LRU(int n, Frame** f): numOfBuf(n), frames(f), current(0) { };
-		int PickVictim();
+		LRU(int n, Frame** f);
+		~LRU();
+
+		int  PickVictim();
+		int  NextVictims(int* frameIds, int max);
+		void OnLoad(int frameId)  { this->unpinned->Remove(frameId); }
+		void OnPin(int frameId)   { this->unpinned->Remove(frameId); }
+		void OnUnpin(int frameId);
+		void OnFree(int frameId);
+
+		const char* GetName() { return "LRU"; }
 };
 
 #endif // _LRU_H
@@ -0,0 +1,50 @@
+#ifndef _LRUK_H
+#define _LRUK_H
+
+#include "replacer.h"
+#include "ghostlist.h"
+
+#define LRUK_K 2
+
+//--------------------------------------------------------------------
+// LRUK
+//
+// LRU-K (O'Neil, O'Neil & Weikum): the victim is the unpinned frame
+// whose K-th most recent reference is the oldest. Pages referenced
+// fewer than K times are evicted first, in LRU order, which keeps a
+// single sequential scan from flushing pages that are reused.
+//
+// Reference times are taken from a counter incremented on each pin.
+// The history of recently evicted pages is retained in a ghost list
+// (as many ghosts as frames), so a page that is read again soon after
+// being evicted keeps its earlier references.
+//--------------------------------------------------------------------
+
+class LRUK : public Replacer
+{
+	private :
+
+		unsigned long  now;
+		unsigned long* history;       // LRUK_K reference times per frame, newest first
+		unsigned long* ghostHistory;  // The same, per ghost entry
+		GhostList*     ghosts;
+
+		unsigned long* HistoryOf(int frameId) { return this->history + frameId * LRUK_K; }
+		bool           Older(int a, int b);
+
+	public :
+
+		LRUK(int numOfBuf, Frame** frames);
+		~LRUK();
+
+		int  PickVictim();
+		int  NextVictims(int* frameIds, int max);
+		void OnLoad(int frameId);
+		void OnPin(int frameId);
+		void OnEvict(int frameId);
+		void OnFree(int frameId);
+
+		const char* GetName() { return "LRU-K"; }
+};
+
+#endif // _LRUK_H
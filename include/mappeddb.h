@@ -0,0 +1,46 @@
+#ifndef _MAPPEDDB_H
+#define _MAPPEDDB_H
+
+#include "page.h"
+
+//--------------------------------------------------------------------
+// MappedDB
+//
+// The database file mapped into memory as a whole, shared with the
+// file, for a buffer manager in mapped mode (see BufMgr::UseMapping).
+// Page pid is read and written in place at a fixed offset from the
+// start of the mapping; the operating system pages it in and writes
+// it back, and Flush forces it out. Pinning a page only counts a
+// reference, so that FreePage and FlushAllPages can tell whether the
+// page is still in use.
+//
+// All methods may be called from any thread.
+//--------------------------------------------------------------------
+
+class MappedDB
+{
+	private:
+
+		char* base;
+		unsigned long size;
+		int   numOfPages;
+		int*  pinCounts;
+		int   numOfPinnedPages;
+
+	public:
+
+		MappedDB(const char* fileName, int numOfPages, Status& status);
+		~MappedDB();
+
+		Status Pin(PageID pid, Page*& page);
+		Status Unpin(PageID pid);
+		Status Flush(PageID pid, int count = 1);
+		void   Prefetch(PageID pid, int count);
+
+		int  GetPinCount(PageID pid) { return __atomic_load_n(&this->pinCounts[pid], __ATOMIC_RELAXED); }
+		int  GetNumOfPinnedPages()   { return __atomic_load_n(&this->numOfPinnedPages, __ATOMIC_RELAXED); }
+		int  GetNumOfPages()         { return this->numOfPages; }
+		bool IsValid(PageID pid)     { return pid >= 0 && pid < this->numOfPages; }
+};
+
+#endif // _MAPPEDDB_H
@@ -76,7 +76,18 @@ struct RecordID {
 
 // typedef struct RecordID RecordID;
 
-const int MINIBASE_PAGESIZE = 1024;           // in bytes
+// The page size is fixed when Minibase is built: build everything,
+// the libraries included, with -DMINIBASE_PAGE_SIZE=n for pages of n
+// bytes. Page layouts derive from it.
+#ifndef MINIBASE_PAGE_SIZE
+#define MINIBASE_PAGE_SIZE 1024
+#endif
+
+#if MINIBASE_PAGE_SIZE < 1024 || MINIBASE_PAGE_SIZE > 65536 || (MINIBASE_PAGE_SIZE & (MINIBASE_PAGE_SIZE - 1))
+#error "MINIBASE_PAGE_SIZE must be a power of two from 1024 to 65536"
+#endif
+
+const int MINIBASE_PAGESIZE = MINIBASE_PAGE_SIZE;   // in bytes
 const int MINIBASE_BUFFER_POOL_SIZE = 1024;   // in Frames
 const int MINIBASE_DB_SIZE = 10000;           // in Pages => the DBMS Manager 
                                               // tells the DB how much disk 
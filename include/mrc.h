@@ -0,0 +1,97 @@
+#ifndef _MRC_H
+#define _MRC_H
+
+#include <pthread.h>
+
+#include "hash.h"
+#include "indexlist.h"
+
+// The pool sizes hit ratios are estimated for, as multiples of the
+// actual size: 1/2, 1, 2 and 4
+#define MRC_POINTS       4
+
+// Most page ids kept, those of the sampled pages recently used within
+// 4 times the pool size
+#define MRC_MAX_SAMPLES  4096
+
+// Sampling threshold precision: pages are sampled by comparing 24 bits
+// of a hash of their id to a threshold
+#define MRC_HASH_RANGE   (1 << 24)
+
+// At most one page in 2^MRC_RATE_SHIFT is sampled, however small the
+// pool, so that few pins pay for an update
+#define MRC_RATE_SHIFT   3
+
+//--------------------------------------------------------------------
+// MRCEstimator
+//
+// Estimates online what the hit ratio of a pool would be with half,
+// the same, twice and four times as many frames, in the manner of
+// SHARDS (Waldspurger et al., "Efficient MRC Construction with
+// SHARDS"). Only the pins of a fixed, pseudo-random sample of the
+// pages are looked at: those whose hashed page id falls below a
+// threshold, chosen so that the pages used within four pool sizes
+// number at most MRC_MAX_SAMPLES. Deciding costs a multiplication and
+// a comparison, so the hot path of the pins not sampled is untouched.
+//
+// The sampled page ids are kept in LRU order, including those that
+// have left the pool, in four segments whose sizes (in sampled pages)
+// are scaled down from the pool sizes. A pin of a page found in
+// segment i means a reuse distance below the i-th pool size, so a hit
+// at that size and the larger ones. Estimates are of an LRU pool, the
+// model reuse distances describe; comparing the estimate at the actual
+// size to the actual hit ratio tells how much the pool's own policy
+// does better or worse.
+//
+// The estimates are adjusted, as SHARDS-adj does, for the difference
+// between the pins sampled and the share of all pins the sampling rate
+// should have given.
+//--------------------------------------------------------------------
+
+class MRCEstimator
+{
+	private:
+
+		enum { UNUSED = MRC_POINTS };
+
+		pthread_mutex_t latch;
+		unsigned int    threshold;   // read without the latch
+		int             poolSize;
+		int             capacities[MRC_POINTS];
+
+		PageID*     pids;            // per entry
+		HashTable*  index;           // pid -> entry
+		IndexLists* segments;        // lists 0 .. MRC_POINTS - 1, then UNUSED
+
+		long numOfSamples;
+		long hits[MRC_POINTS];       // by the segment the page was found in
+		long pinsAtReset;
+
+	public:
+
+		MRCEstimator(int poolSize);
+		~MRCEstimator();
+
+		bool IsSampled(PageID pid)
+		{
+			return ((unsigned int)pid * 2654435761u) >> 8 < __atomic_load_n(&this->threshold, __ATOMIC_RELAXED);
+		}
+
+		// Record a pin of a sampled page
+		void Access(PageID pid);
+
+		// Start over for a pool of a new size, forgetting the pages
+		// sampled so far. numOfPins counts the pins of the pool up to
+		// now, see GetHitRatios.
+		void Reset(int poolSize, long numOfPins);
+
+		// Clear the counts, keeping the pages sampled so far
+		void ResetCounts(long numOfPins);
+
+		// Output the pool sizes and estimated hit ratios. numOfPins
+		// counts all the pins of the pool, sampled or not, in the same
+		// way as for Reset. Returns the number of pins sampled.
+		long GetHitRatios(long numOfPins, int* poolSizes, double* hitRatios);
+};
+
+#endif // _MRC_H
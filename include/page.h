@@ -7,6 +7,14 @@
 const PageID INVALID_PAGE = -1;
 const int MAX_SPACE = MINIBASE_PAGESIZE;
 
+// Offsets, sizes and counts within a page. Beyond 32 KiB they no
+// longer fit in a short.
+#if MINIBASE_PAGE_SIZE > 32768
+typedef int PageOffset;
+#else
+typedef short PageOffset;
+#endif
+
 
 class Page
 {
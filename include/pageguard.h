@@ -0,0 +1,60 @@
+#ifndef _PAGEGUARD_H
+#define _PAGEGUARD_H
+
+#include "page.h"
+
+class BufMgr;
+
+//--------------------------------------------------------------------
+// PageGuard
+//
+// A pin on a page, as taken by BufMgr::PinPage(pid, guard) or
+// BufMgr::NewPage(pid, guard). The guard remembers the frame the page
+// is in, so that giving up the pin costs no page table lookup, and
+// unpins the page when it goes out of scope, so that an early return
+// cannot leak the pin. DirtyIt marks the page to be unpinned dirty.
+//
+// Guards can be moved but not copied: there is one guard per pin.
+// Pinning into a guard that already holds a pin releases that pin
+// first. Detach hands the pin over to code that unpins by page id.
+//--------------------------------------------------------------------
+
+class PageGuard
+{
+	friend class BufMgr;
+
+	private:
+
+		BufMgr* bufMgr;    // the pool the page is pinned in; NULL if none
+		PageID  pid;
+		int     frameId;   // INVALID_FRAME in mapped mode
+		Page*   page;
+		bool    dirty;
+
+		void Reset();
+
+		PageGuard(const PageGuard&);
+		PageGuard& operator=(const PageGuard&);
+
+	public:
+
+		PageGuard();
+		PageGuard(PageGuard&& other);
+		PageGuard& operator=(PageGuard&& other);
+		~PageGuard();
+
+		// Unpin the page now. Returns FAIL if the guard holds no pin
+		// or the unpin failed.
+		Status Release();
+
+		// Give up the guard without unpinning. Returns the page, which
+		// is then unpinned with BufMgr::UnpinPage.
+		Page*  Detach();
+
+		void   DirtyIt()   { this->dirty = true; }
+		bool   IsPinned()  { return NULL != this->bufMgr; }
+		PageID GetPageID() { return this->pid; }
+		Page*  GetPage()   { return this->page; }
+};
+
+#endif // _PAGEGUARD_H
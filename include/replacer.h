@@ -1,28 +1,156 @@
+#ifndef _REPLACER_H
+#define _REPLACER_H
+
 #include "frame.h"
-#include "hash.h"
 
-class Replacer 
+// How readily a frame is replaced, as set by BufMgr from the class of
+// the pages pinned in it (see BufMgr::SetPriority)
+enum EvictionPriority
+{
+	PRIORITY_LOW,       // replaced first
+	PRIORITY_NORMAL,
+	PRIORITY_HIGH,      // survives REPLACER_EXTRA_CHANCES more sweeps
+	NUM_OF_PRIORITIES
+};
+
+// Times a high priority frame is passed over by LRU and Clock before
+// it is replaced like any other
+#define REPLACER_EXTRA_CHANCES 2
+
+//--------------------------------------------------------------------
+// Replacer
+//
+// Base class of the buffer replacement policies. BufMgr tells the
+// replacer about every state change of a frame through the On*()
+// hooks and asks it for a frame to reuse with PickVictim().
+//
+//   OnLoad  - a page has just been brought into the frame on a miss
+//             (its page id is already set) and pinned once. This is
+//             the first reference to the page.
+//   OnPin   - the frame was pinned again because of a hit.
+//   OnUnpin - the pin count of the frame dropped to zero.
+//   OnEvict - the page in the frame is about to be replaced by another
+//             one (its page id is still set). Followed by OnFree.
+//   OnFree  - the frame was emptied, either after OnEvict or because
+//             the page was freed or flushed out of the pool.
+//
+// PickVictim returns an unpinned frame, or INVALID_FRAME if every frame
+// is pinned. Empty frames are preferred. Apart from bookkeeping of its
+// own (such as a clock hand) it does not change the state of the
+// replacer; the hooks above follow if the frame is actually reused.
+//
+// NextVictims lists the unpinned frames in the order they would be
+// replaced (as far as the policy can tell without changing its state),
+// so that the background writer can clean them ahead of time.
+//
+// PickCleanVictim asks for a victim that need not be written back
+// first: among the first few candidates in replacement order, the
+// first clean one, else the first candidate. Policies support it by
+// passing each frame they would return through Accept().
+//
+// Policies add the number of frames each PickVictim looks at to
+// numOfExamined, for the buffer pool statistics.
+//
+// Each frame has an EvictionPriority, set by BufMgr before OnLoad and
+// OnPin and kept until it is set again. LRU and Clock honor it when
+// the frame is unpinned: a low priority frame is the next victim, and
+// a high priority one is passed over REPLACER_EXTRA_CHANCES times, in
+// the way of a second chance, before it can go. The other policies
+// already keep the pages that are used again from being pushed out by
+// those used once, and ignore it.
+//
+// BufMgr serializes all calls into a replacer with a latch of its own.
+// Pin counts change without that latch, however, so a frame may become
+// pinned before OnPin reaches the replacer. PickVictim must therefore
+// check NotPinned() rather than trust its own lists, and BufMgr
+// re-checks the victim when it takes it.
+//
+// A policy whose OnPin and OnUnpin only store to a byte of the frame,
+// atomically, says so with HasLatchFreeHooks. BufMgr then calls them,
+// and SetPriority on a hit, under the latch of the page table partition
+// of the page rather than the replacer latch, so that hits on pages of
+// different partitions do not contend.
+//--------------------------------------------------------------------
+
+class Replacer
 {
+	protected :
+
+		int     numOfBuf;
+		Frame** frames;
+		long    numOfExamined;
+		char*   priorities;
+
+		// State of a PickCleanVictim search
+		int     cleanSearch;
+		int     firstDirty;
+
+		bool Accept(int frameId);
+		bool PrefersClean() { return this->cleanSearch >= 0; }
+
 	public :
 
-		Replacer();
-		~Replacer();
+		Replacer(int numOfBuf, Frame** frames);
+		virtual ~Replacer();
+
+		virtual int  PickVictim() = 0;
+		int          PickCleanVictim(int searchLimit);
+		virtual int  NextVictims(int* frameIds, int max) = 0;
+		virtual void OnLoad(int frameId)  { }
+		virtual void OnPin(int frameId)   { }
+		virtual void OnUnpin(int frameId) { }
+		virtual void OnEvict(int frameId) { }
+		virtual void OnFree(int frameId)  { }
 
-		virtual int PickVictim() = 0;
+		void SetPriority(int frameId, int priority) { __atomic_store_n(&this->priorities[frameId], (char)priority, __ATOMIC_RELAXED); }
+		int  GetPriority(int frameId)               { return __atomic_load_n(&this->priorities[frameId], __ATOMIC_RELAXED); }
+
+		virtual bool HasLatchFreeHooks() { return false; }
+
+		virtual const char* GetName() = 0;
+		long GetNumOfExamined() { return this->numOfExamined; }
+
+		// Create the replacer named by policy ("LRU", "Clock", "LRU-K",
+		// "2Q" or "ARC", case insensitive). Returns NULL for an unknown
+		// name; a NULL policy selects LRU.
+		static Replacer* Create(const char* policy, int numOfBuf, Frame** frames);
 };
 
+
+//--------------------------------------------------------------------
+// Clock
+//
+// Second chance replacement: each frame has a reference bit that is
+// set when the frame is pinned. The clock hand sweeps the frames,
+// clearing reference bits, and stops at the first unpinned frame
+// whose bit is already clear. The bit is a count, of the sweeps the
+// frame survives: one, REPLACER_EXTRA_CHANCES more for a high priority
+// frame, and none for a low priority one once it is unpinned. Pins and
+// unpins only store the count, so they need no latch.
+//--------------------------------------------------------------------
+
 class Clock : public Replacer
 {
 	private :
-		
-		int current;
-		int numOfBuf;
-		Frame **frames;
-		HashTable *hashTable;
+
+		int   current;
+		char* referenced;
 
 	public :
 
-		Clock(int bufSize, Frame **frames, HashTable *hashTable);
+		Clock(int numOfBuf, Frame** frames);
 		~Clock();
-		int PickVictim();
+
+		int  PickVictim();
+		int  NextVictims(int* frameIds, int max);
+		void OnLoad(int frameId) { __atomic_store_n(&this->referenced[frameId], 1, __ATOMIC_RELAXED); }
+		void OnPin(int frameId)  { __atomic_store_n(&this->referenced[frameId], 1, __ATOMIC_RELAXED); }
+		void OnUnpin(int frameId);
+		void OnFree(int frameId) { __atomic_store_n(&this->referenced[frameId], 0, __ATOMIC_RELAXED); }
+
+		bool HasLatchFreeHooks() { return true; }
+
+		const char* GetName() { return "Clock"; }
 };
+
+#endif // _REPLACER_H
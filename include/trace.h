@@ -0,0 +1,173 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include "page.h"
+
+// Longest name of a trace, including the terminating zero
+#define TRACE_NAME_LENGTH 64
+
+// Recorded trace files start with this number
+#define TRACE_MAGIC       0x5442424d
+
+// Records a TraceRecorder gathers before writing them out
+#define TRACE_RECORD_BUFFER 4096
+
+// Pages of a loaded trace are below this, so that counting them cannot
+// overflow
+#define TRACE_MAX_PAGE    (INT_MAX / 2)
+
+enum TraceRecordType
+{
+	TRACE_PIN,
+	TRACE_UNPIN
+};
+
+//--------------------------------------------------------------------
+// TraceRecord
+//
+// A PinPage or UnpinPage call as written by TraceRecorder. Timestamps
+// are in nanoseconds since recording started.
+//--------------------------------------------------------------------
+
+struct TraceRecord
+{
+	long   timestamp;
+	PageID pid;
+	short  pageClass;   // of a pin
+	char   type;        // one of TraceRecordType
+	char   dirty;       // of an unpin
+};
+
+//--------------------------------------------------------------------
+// TraceEntry
+//
+// One access of a trace: a pin of page number page (counted from the
+// first page of the trace), unpinned dirty if write is set.
+//--------------------------------------------------------------------
+
+struct TraceEntry
+{
+	int   page;
+	short pageClass;
+	short write;
+};
+
+//--------------------------------------------------------------------
+// Trace
+//
+// A sequence of page accesses to replay against a buffer manager,
+// either generated or loaded from a file. Pages are numbered from 0;
+// the trace touches pages 0 .. GetNumOfPages() - 1 at most, which
+// TraceBenchmark maps onto a run of pages in the database.
+//
+// A trace file is text, one access per line:
+//
+//     <page id> <r|w> [<page class>]
+//
+// where the page class is a number as in the PageClass enum (data if
+// left out). Blank lines and lines starting with '#' are skipped.
+//
+// Load also reads the binary files of TraceRecorder: each pin becomes
+// an access, a write if the page was unpinned dirty before it was
+// pinned again. The page ids of a loaded trace are made relative to
+// the smallest one in the file.
+//--------------------------------------------------------------------
+
+class Trace
+{
+	private:
+
+		TraceEntry* entries;
+		int  count;
+		int  capacity;
+		int  numOfPages;
+		char name[TRACE_NAME_LENGTH];
+
+		Status LoadText(FILE* file, const char* fileName);
+		Status LoadRecords(FILE* file, const char* fileName);
+
+	public:
+
+		Trace(const char* name);
+		~Trace();
+
+		void Add(int page, bool write, int pageClass);
+
+		Status Load(const char* fileName);
+		Status Save(const char* fileName);
+
+		TraceEntry* GetEntries()    { return this->entries; }
+		int         GetCount()      { return this->count; }
+		int         GetNumOfPages() { return this->numOfPages; }
+		const char* GetName()       { return this->name; }
+
+		// Synthetic workloads of count accesses over numOfPages pages,
+		// the same for the same seed.
+
+		// Zipfian popularity with skew theta (0.99 as in YCSB), the
+		// popular pages scattered over the range. One access in
+		// writeEvery is a write, none if it is 0.
+		static Trace* Zipf(int numOfPages, int count, double theta, int writeEvery, unsigned int seed);
+
+		// The same sequential scan of all the pages, over and over:
+		// the worst case of LRU whenever the pool is smaller.
+		static Trace* Loop(int numOfPages, int count);
+
+		// B+ tree point lookups (root, inner, leaf, then data page,
+		// Zipfian over the keys) interleaved with sequential scans of
+		// the data pages, one scanned page per lookup.
+		static Trace* ScanPoint(int numOfPages, int count, unsigned int seed);
+
+		// A TPC-C-like mix of transactions over tables laid out one
+		// after the other: new order, payment, order status, delivery
+		// and stock level in the proportions of the standard, with
+		// its non-uniform customer and item choices and the orders
+		// appended at the end of their tables.
+		static Trace* TPCC(int numOfPages, int count, unsigned int seed);
+};
+
+//--------------------------------------------------------------------
+// TraceRecorder
+//
+// Writes a TraceRecord for every call to Record to a binary file: a
+// header (the magic number, page size and record size), then the
+// records in the order they were made. Records are gathered in memory
+// and written TRACE_RECORD_BUFFER at a time, so that recording costs
+// a latch and a clock reading per call. The remaining ones are written
+// by Flush, or when the recorder is deleted.
+//--------------------------------------------------------------------
+
+class TraceRecorder
+{
+	private:
+
+		int  fd;
+		bool failed;        // a write failed; records are dropped
+		long start;
+		long numOfRecords;
+
+		TraceRecord*    records;
+		int             used;
+		pthread_mutex_t latch;
+
+		void WriteRecords();
+
+	public:
+
+		TraceRecorder(const char* fileName, Status& status);
+		~TraceRecorder();
+
+		void   Record(int type, PageID pid, int pageClass, bool dirty);
+
+		// Write out the records gathered so far. FAIL if a write of
+		// the trace has failed, now or before.
+		Status Flush();
+
+		long GetNumOfRecords() { return this->numOfRecords; }
+};
+
+#endif // _TRACE_H
@@ -0,0 +1,109 @@
+#ifndef _TRACEBENCH_H
+#define _TRACEBENCH_H
+
+#include <stdio.h>
+
+#include "trace.h"
+
+// Replacement policies and pool sizes a TraceBenchmark can compare
+#define TRACE_MAX_POLICIES   8
+#define TRACE_MAX_POOL_SIZES 16
+
+// Pools are never made smaller than this, whatever the trace
+#define TRACE_MIN_POOL_SIZE  8
+
+// Longest policy name, including the terminating zero
+#define TRACE_POLICY_LENGTH  16
+
+//--------------------------------------------------------------------
+// TraceResult
+//
+// What replaying a trace once measured. Durations are in nanoseconds.
+//--------------------------------------------------------------------
+
+struct TraceResult
+{
+	long   accesses;
+	double elapsed;
+	long   pinLatencyP50;   // of PinPage alone
+	long   pinLatencyP99;
+	long   misses;
+	long   dirtyWrites;     // pages written back while replaying
+};
+
+//--------------------------------------------------------------------
+// TraceBenchmark
+//
+// Replays traces against a buffer manager of each of the selected
+// replacement policies and pool sizes, starting from an empty pool
+// every time, and reports the throughput, the median and 99th
+// percentile of the PinPage latency, the hit ratio and the number of
+// dirty pages written back. Results are printed as a table and, if a
+// CSV file is open, appended to it one row per run, so that runs of
+// different builds can be compared.
+//
+// The pages of a trace are mapped onto a run of pages allocated in
+// MINIBASE_DB for the duration of Run, which must therefore be large
+// enough for the trace.
+//
+// Simulate tells how far the policies are from the best possible one.
+// It computes the miss ratio of Belady's OPT, which evicts the page
+// next used furthest in the future, and replays the trace against each
+// policy with empty pages, pinned without being read and never dirty,
+// so that the pool does no I/O and the misses are the replacer's own.
+// Read-ahead is turned off for the same reason. Each access is taken
+// to be unpinned before the next one.
+//--------------------------------------------------------------------
+
+class TraceBenchmark
+{
+	private:
+
+		char policies[TRACE_MAX_POLICIES][TRACE_POLICY_LENGTH];
+		int  numOfPolicies;
+
+		// Frames, or percents of the pages of the trace if relative
+		int  poolSizes[TRACE_MAX_POOL_SIZES];
+		bool relative[TRACE_MAX_POOL_SIZES];
+		int  numOfPoolSizes;
+
+		FILE* csv;
+
+		int    GetPoolSize(Trace* trace, int index);
+		Status Replay(Trace* trace, PageID firstPid, const char* policy, int poolSize, TraceResult& result);
+		Status SimulatePolicy(Trace* trace, const char* policy, int poolSize, long& misses);
+
+	public:
+
+		TraceBenchmark();
+		~TraceBenchmark();
+
+		// A comma separated list of policy names (see
+		// Replacer::Create). By default all of them.
+		Status SetPolicies(const char* list);
+
+		// A comma separated list of frame counts, or of percents of the
+		// pages of the trace when followed by '%'. By default 5%, 10%,
+		// 25% and 50%.
+		Status SetPoolSizes(const char* list);
+
+		// Append the results to fileName, writing the column names
+		// first if the file is new or empty.
+		Status OpenCSV(const char* fileName);
+
+		Status Run(Trace* trace);
+
+		// Compute the miss ratio curve of the trace for Belady's OPT
+		// and each policy, over the pool sizes, without any I/O.
+		Status Simulate(Trace* trace);
+
+		// For each access of the trace, the index of the next access
+		// to the same page, the count of accesses if there is none.
+		static void GetNextUses(Trace* trace, int* nextUses);
+
+		// The misses of Belady's OPT over the trace with poolSize
+		// frames, given the next uses of its accesses.
+		static long SimulateOPT(Trace* trace, int* nextUses, int poolSize);
+};
+
+#endif // _TRACEBENCH_H
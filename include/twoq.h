@@ -0,0 +1,48 @@
+#ifndef _TWOQ_H
+#define _TWOQ_H
+
+#include "replacer.h"
+#include "indexlist.h"
+#include "ghostlist.h"
+
+//--------------------------------------------------------------------
+// TwoQ
+//
+// The full version of 2Q (Johnson & Shasha). Pages seen for the first
+// time enter A1in, a FIFO holding about a quarter of the frames. When
+// they are evicted from A1in their ids are remembered in the A1out
+// ghost list (half as many entries as frames). Only a page that is
+// read again while in A1out is admitted to Am, which is managed as
+// LRU. Pages touched once, such as those of a sequential scan, thus
+// never displace the Am working set.
+//--------------------------------------------------------------------
+
+class TwoQ : public Replacer
+{
+	private :
+
+		enum { FREE, A1IN, AM };
+
+		int         maxA1inSize;
+		IndexLists* queues;
+		GhostList*  a1out;
+
+		int FirstUnpinned(int queue);
+		int AddUnpinned(int queue, int* frameIds, int count, int max);
+
+	public :
+
+		TwoQ(int numOfBuf, Frame** frames);
+		~TwoQ();
+
+		int  PickVictim();
+		int  NextVictims(int* frameIds, int max);
+		void OnLoad(int frameId);
+		void OnPin(int frameId);
+		void OnEvict(int frameId);
+		void OnFree(int frameId);
+
+		const char* GetName() { return "2Q"; }
+};
+
+#endif // _TWOQ_H
@@ -0,0 +1,146 @@
+#ifndef _WAL_H
+#define _WAL_H
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "page.h"
+
+// Log sequence number: the position of a record in the log, counted in
+// bytes from the creation of the log, so that it keeps growing as the
+// log wraps around its file. 0 stands for none.
+typedef long LSN;
+#define INVALID_LSN  0
+
+// Appended records are gathered in one of two buffers of this size
+// while the other one is written; the largest record (an update of a
+// whole page, with both images) has to fit.
+#define LOG_BUFFER_SIZE   (256 * 1024)
+
+// Transactions that may be active at once
+#define LOG_MAX_TRANSACTIONS  64
+
+// The log file starts with a header of this size
+#define LOG_HEADER_SIZE   512
+#define LOG_MAGIC         0x4c57424d
+
+enum LogRecordType
+{
+	LOG_UPDATE,      // before and after image of a range of a page
+	LOG_COMPENSATE,  // after image written when undoing an update
+	LOG_COMMIT,
+	LOG_ABORT
+};
+
+//--------------------------------------------------------------------
+// LogRecord
+//
+// The header of a log record. An update is followed by length bytes of
+// before image and length bytes of after image, a compensation record
+// by the after image only, commits and aborts by nothing.
+//--------------------------------------------------------------------
+
+struct LogRecord
+{
+	LSN          lsn;
+	LSN          prevLSN;    // previous record of the same transaction
+	int          txnId;
+	int          type;
+	PageID       pid;
+	int          offset;
+	int          length;
+	unsigned int checksum;   // of the header and the images
+
+	int GetSize();
+};
+
+//--------------------------------------------------------------------
+// LogManager
+//
+// A write-ahead log of physical page changes. Records are appended to
+// an in-memory buffer and only written out when a transaction commits
+// or a page changed by them is about to be written (see Flush).
+//
+// Commits are grouped: while one thread writes and syncs the log, the
+// others append to the second buffer and wait. The next one to find the
+// log idle writes everything appended meanwhile, so that one fdatasync
+// makes many commits durable at once.
+//
+// The file has room for a fixed number of bytes of records, which wrap
+// around it. It is filled with zeros when created, so that syncing the
+// log never has to sync the size of the file as well. Truncate gives
+// up the records before a given LSN once a checkpoint has made them
+// unnecessary. Updates are refused while the log is full; room for the
+// records that finish (or roll back) the active transactions is kept
+// aside.
+//--------------------------------------------------------------------
+
+class LogManager
+{
+	private:
+
+		int  fd;
+		long capacity;     // bytes of records the file holds
+		bool failed;       // a write failed; nothing more is durable
+
+		LSN  startLSN;     // of the first record still needed
+		LSN  nextLSN;      // of the next record to be appended
+		LSN  flushedLSN;   // the records before it are durable
+
+		// Records from bufferStart on are in buffers[current]
+		char* buffers[2];
+		int   current;
+		int   used;
+		LSN   bufferStart;
+		bool  flushing;
+
+		pthread_mutex_t latch;
+		pthread_cond_t  flushed;
+
+		// Active transactions, their first and last records, and the
+		// room kept for their compensation and end records
+		int  txnIds[LOG_MAX_TRANSACTIONS];
+		LSN  firstLSNs[LOG_MAX_TRANSACTIONS];
+		LSN  lastLSNs[LOG_MAX_TRANSACTIONS];
+		long reservedBytes[LOG_MAX_TRANSACTIONS];
+		long reserved;
+		int  numOfTxns;
+		int  nextTxnId;
+
+		long numOfCommits;
+		long numOfSyncs;
+
+		Status Open(long maxLogSize);
+		Status WriteHeader();
+		Status WriteBuffer();
+		Status Transfer(LSN lsn, char* data, int size, bool write);
+		int    FindTransaction(int txnId);
+
+		static unsigned int Checksum(LogRecord* record, const char* data, int size);
+
+	public:
+
+		LogManager(const char* fileName, long maxLogSize, Status& status);
+		~LogManager();
+
+		Status Begin(int& txnId);
+		Status Append(int txnId, int type, PageID pid, int offset, int length, const char* before, const char* after, LSN& lsn);
+		Status End(int txnId, int type, LSN& lsn);
+		Status Flush(LSN lsn);
+		Status Truncate(LSN newStartLSN);
+
+		// Reads back a record that has been flushed. data gets the
+		// images, in a new array the caller deletes.
+		Status ReadRecord(LSN lsn, LogRecord& record, char*& data);
+
+		LSN  GetStartLSN();
+		LSN  GetEndLSN();
+		LSN  GetLastLSN(int txnId);
+		LSN  GetOldestActiveLSN();
+		long GetSize() { return this->GetEndLSN() - this->GetStartLSN(); }
+		long GetCapacity() { return this->capacity; }
+		long GetNumOfCommits() { return __atomic_load_n(&this->numOfCommits, __ATOMIC_RELAXED); }
+		long GetNumOfSyncs() { return __atomic_load_n(&this->numOfSyncs, __ATOMIC_RELAXED); }
+};
+
+#endif // _WAL_H
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <unistd.h>
 #include <iostream>
 
 using namespace std;
@@ -9,13 +10,22 @@ using namespace std;
 
 int MINIBASE_RESTART_FLAG = 0;
 
+// The log of the database, and the most pages' worth of bytes it takes
+#define MINIBASE_LOG_NAME     "MINIBASE.WAL"
+#define MINIBASE_MAX_LOG_SIZE 500
+
+// Usage: minibase-bufmgr [trace file]
+//
+// Runs the buffer manager tests. Given a file name, records the pins
+// and unpins of the shared buffer pool in it, for minibase-bufmgr-trace
+// to replay or simulate.
 int main (int argc, char **argv)
 {
 	BMTester tester;
 	Status status;
 
 	int bufSize = NUMBUF; 
-	minibase_globals = new SystemDefs(status, "MINIBASE.DB", 2000, bufSize, "Clock");
+	minibase_globals = new SystemDefs(status, "MINIBASE.DB", MINIBASE_LOG_NAME, 2000, MINIBASE_MAX_LOG_SIZE, bufSize, "Clock");
 
 	if (status != OK)
 	{
@@ -23,6 +33,34 @@ int main (int argc, char **argv)
 		exit(2);
 	}
 
+	// The database is created afresh unless restarting, and its old
+	// log with it
+	if (!MINIBASE_RESTART_FLAG)
+	{
+		unlink(minibase_globals->GlobalLogName);
+	}
+
+	// Log page changes, and recover from the log on a restart
+	if (MINIBASE_BM->EnableLog(minibase_globals->GlobalLogName, MINIBASE_MAX_LOG_SIZE) != OK)
+	{
+		cerr << "Error opening the log.\n";
+		exit(2);
+	}
+
+	// Save the pages in use on the way out, and read them back in on
+	// a restart
+	MINIBASE_BM->SetWarmUpFile("MINIBASE.DB.warm");
+	if (MINIBASE_RESTART_FLAG)
+	{
+		MINIBASE_BM->WarmUp();
+	}
+
+	if (argc > 1 && MINIBASE_BM->StartRecording(argv[1]) != OK)
+	{
+		cerr << "Error creating the trace.\n";
+		exit(2);
+	}
+
 //	Page* pg;
 //	int pid;
 //	status = MINIBASE_BM->NewPage(pid, pg, 51);
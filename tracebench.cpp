@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+
+using namespace std;
+
+#include "include/tracebench.h"
+#include "include/bufmgr.h"
+
+int MINIBASE_RESTART_FLAG = 0;
+
+// The most traces one run replays
+#define MAX_TRACES 32
+
+static void Usage()
+{
+	cerr << "Usage: minibase-bufmgr-trace [-m] [-p policies] [-s sizes] [-g pages] [-n accesses]\n"
+		 << "                             [-o results.csv] [trace ...]\n"
+		 << "\n"
+		 << "  -m  simulate: miss ratio curves of OPT and the policies, without I/O\n"
+		 << "  -p  comma separated replacement policies (default: all)\n"
+		 << "  -s  comma separated pool sizes, in frames or in percents of the\n"
+		 << "      pages of a trace (default: 5%,10%,25%,50%; with -m, 1% to 100%)\n"
+		 << "  -g  pages of the synthetic traces (default: 1000)\n"
+		 << "  -n  accesses of the synthetic traces (default: 200000)\n"
+		 << "  -o  CSV file to append the results to\n"
+		 << "\n"
+		 << "  A trace is zipf, loop, scanpoint, tpcc or the name of a trace file,\n"
+		 << "  text or recorded (see trace.h). By default the four synthetic ones\n"
+		 << "  are replayed.\n";
+}
+
+
+// Usage: see above
+//
+// Replays page access traces against the buffer manager with each of
+// the given replacement policies and pool sizes, or simulates them.
+int main (int argc, char **argv)
+{
+	TraceBenchmark benchmark;
+	Status status = OK;
+	int numOfPages = 1000;
+	int count = 200000;
+	bool simulate = false;
+	bool sizesGiven = false;
+	int option;
+
+	while (OK == status && -1 != (option = getopt(argc, argv, "mp:s:g:n:o:")))
+	{
+		switch (option)
+		{
+			case 'm': simulate = true; break;
+			case 'p': status = benchmark.SetPolicies(optarg); break;
+			case 's': status = benchmark.SetPoolSizes(optarg); sizesGiven = true; break;
+			case 'g': numOfPages = atoi(optarg); break;
+			case 'n': count = atoi(optarg); break;
+			case 'o': status = benchmark.OpenCSV(optarg); break;
+			default:  status = FAIL; break;
+		}
+	}
+
+	if (OK != status || numOfPages < 40 || count < 1 || argc - optind > MAX_TRACES)
+	{
+		Usage();
+		exit(2);
+	}
+
+	if (simulate && !sizesGiven)
+	{
+		benchmark.SetPoolSizes("1%,2%,5%,10%,20%,30%,50%,75%,100%");
+	}
+
+	const char* defaultTraces[] = { "zipf", "loop", "scanpoint", "tpcc" };
+	const char** names = (optind < argc) ? (const char**)&argv[optind] : defaultTraces;
+	int numOfTraces = (optind < argc) ? argc - optind : 4;
+	Trace* traces[MAX_TRACES];
+	int dbPages = 0;
+
+	for (int i = 0; OK == status && i < numOfTraces; i++)
+	{
+		if (0 == strcmp(names[i], "zipf"))
+		{
+			traces[i] = Trace::Zipf(numOfPages, count, 0.99, 10, 12345);
+		}
+		else if (0 == strcmp(names[i], "loop"))
+		{
+			traces[i] = Trace::Loop(numOfPages, count);
+		}
+		else if (0 == strcmp(names[i], "scanpoint"))
+		{
+			traces[i] = Trace::ScanPoint(numOfPages, count, 12345);
+		}
+		else if (0 == strcmp(names[i], "tpcc"))
+		{
+			traces[i] = Trace::TPCC(numOfPages, count, 12345);
+		}
+		else
+		{
+			const char* slash = strrchr(names[i], '/');
+
+			traces[i] = new Trace((NULL != slash) ? slash + 1 : names[i]);
+			if (OK != traces[i]->Load(names[i]))
+			{
+				delete traces[i];
+				traces[i] = NULL;
+			}
+		}
+
+		if (NULL == traces[i])
+		{
+			numOfTraces = i;
+			status = FAIL;
+		}
+		else if (traces[i]->GetNumOfPages() > dbPages)
+		{
+			dbPages = traces[i]->GetNumOfPages();
+		}
+	}
+
+	// Room for the largest trace, besides the space map
+	if (OK == status)
+	{
+		minibase_globals = new SystemDefs(status, "BMTRACE.DB", dbPages + 100, NUMBUF, "Clock");
+
+		if (status != OK)
+		{
+			cerr << "Error initializing Minibase.\n";
+		}
+	}
+
+	for (int i = 0; OK == status && i < numOfTraces; i++)
+	{
+		status = simulate ? benchmark.Simulate(traces[i]) : benchmark.Run(traces[i]);
+	}
+
+	for (int i = 0; i < numOfTraces; i++)
+	{
+		delete traces[i];
+	}
+
+	if (status != OK)
+	{
+		cout << "Error replaying traces\n";
+		minibase_errors.show_errors();
+		return 1;
+	}
+
+	delete minibase_globals;
+	cout << endl;
+	return 0;
+}